@@ -14,34 +14,73 @@
 #include <unistd.h>
 
 #include "bsl.h"
+#include "checksum.h"
 #include "serial.h"
+#include "transport.h"
 
 #define BSL_TIMEOUT (1.0)
-#define BSL_REQUEST_SIZE (10)
-#define BSL_DATA_RESPONSE_SIZE (6)
-#define BSL_ACK_RESPONSE_SIZE (1)
+#define BSL_MIN_TIMEOUT_MARGIN (0.02)
+#define BSL_BITS_PER_BYTE (11)
+#define BSL_WORD_WRITE_TIME (150e-6)
+#define BSL_SEGMENT_ERASE_TIME (0.05)
+#define BSL_MASS_ERASE_TIME (0.5)
+#define BSL_ERASE_CHECK_BYTE_TIME (1e-6)
 #define BSL_PASSWORD_SIZE (32)
-
-static int bsl_write_request(bsl_object_t * object_p, unsigned char * data, size_t size);
+#define BSL_LATENCY_ROUND_TRIPS (16)
+#define BSL_ENTRY_CALIBRATION_MARGIN (2)
+#define BSL_SYNC (0x80)
+#define BSL_DATA_ACK (0x90)
+#define BSL_DATA_NAK (0xA0)
+
+static int bsl_write_request(bsl_object_t * object_p, unsigned char command, unsigned short address,
+		unsigned short length, const unsigned char * payload, size_t payload_size);
+static void bsl_build_request(unsigned char * frame, unsigned char * checksum_data, unsigned char command,
+		unsigned short address, unsigned short length, const unsigned char * payload, size_t payload_size);
+static int bsl_send_request(bsl_object_t * object_p, unsigned char * frame, unsigned char * checksum_data,
+		const unsigned char * payload, size_t payload_size);
+static int bsl_add_operation(bsl_transaction_t * transaction_p, bsl_operation_type type, unsigned char command,
+		unsigned short address, unsigned short length, const unsigned char * payload, unsigned char * data, size_t size);
 static int bsl_read_data_response(bsl_object_t * object_p, unsigned char * data, size_t size);
+static double bsl_get_operation_time(unsigned char command, unsigned short length, size_t payload_size);
 static int bsl_read_ack_response(bsl_object_t * object_p);
+static int bsl_read_acknowledge(bsl_object_t * object_p, bool * ack_p);
+static int bsl_read_response_bytes(bsl_object_t * object_p, unsigned char * data, size_t size);
 static int bsl_send_synchronization_sequence(bsl_object_t * object_p);
-static unsigned short bsl_calculate_checksum(const unsigned char * data, size_t size);
+static int bsl_read_synchronization_ack(bsl_object_t * object_p);
+static void bsl_update_link_state(bsl_object_t * object_p, int error, bsl_link_state link_state);
+static int bsl_run_entry_steps(bsl_object_t * object_p, const bsl_entry_step_t * steps, size_t step_count, unsigned int settle_time);
+
+// Heap allocations made by this module, frames are built in the buffers of the BSL object.
+static unsigned long bsl_allocation_count = 0;
 
-bsl_object_t * bsl_construct(int fd)
+bsl_object_t * bsl_construct(transport_t * transport_p)
 {
 	bsl_object_t * object_p;
 
 	// Allocate memory for the BSL object.
 	object_p = malloc(sizeof(bsl_object_t));
+	bsl_allocation_count++;
 
 	if (object_p == NULL) {
 		// Could not allocate memory.
 		fprintf(stderr, "Failed to allocate memory for the BSL object.\n");
 	}
 	else {
-		// Store the file descriptor.
-		object_p->fd = fd;
+		// Store the transport.
+		object_p->transport_p = transport_p;
+
+		// Use the standard entry sequence.
+		bsl_get_default_entry_sequence(&object_p->entry_sequence);
+
+		// Synchronize before every command, as every ROM BSL requires.
+		object_p->sync_mode = bsl_sync_separate;
+		object_p->link_state = bsl_link_unsynchronized;
+		object_p->link_failed = false;
+		bsl_clear_statistics(object_p);
+
+		// Nothing is known about the latency of the link yet.
+		memset(&object_p->timing, 0, sizeof(object_p->timing));
+		object_p->timing.baudrate = 9600;
 	}
 
 	return object_p;
@@ -53,50 +92,352 @@ void bsl_destroy(bsl_object_t * object_p)
 	free(object_p);
 }
 
-int bsl_initialize(bsl_object_t * object_p)
+unsigned long bsl_get_allocation_count(void)
 {
-//	// Set ~RST to high and TEST to low.
-//	serial_set_dtr(object_p->fd, true);
-//	serial_set_rts(object_p->fd, false);
+	return bsl_allocation_count;
+}
+
+const char * bsl_get_error_name(int error)
+{
+	const char * name = "unknown";
+
+	switch (error)
+	{
+	case bsl_error_none:
+		name = "none";
+		break;
+	case bsl_error_failed:
+		name = "failed";
+		break;
+	case bsl_error_timeout:
+		name = "timeout";
+		break;
+	case bsl_error_nak:
+		name = "NAK";
+		break;
+	case bsl_error_header:
+		name = "bad header";
+		break;
+	case bsl_error_length:
+		name = "bad length";
+		break;
+	case bsl_error_checksum:
+		name = "bad checksum";
+		break;
+	case bsl_error_skipped:
+		name = "skipped";
+		break;
+	}
+
+	return name;
+}
+
+void bsl_get_default_entry_sequence(bsl_entry_sequence_t * sequence_p)
+{
+	static const bsl_entry_step_t steps[] =
+	{
+		{bsl_pin_reset, false, 0},		// Set ~RST and TEST to low.
+		{bsl_pin_test, false, 1000},
+		{bsl_pin_test, true, 1000},		// Pulse TEST twice.
+		{bsl_pin_test, false, 1000},
+		{bsl_pin_test, true, 1000},
+		{bsl_pin_reset, true, 1000},	// Set ~RST to high while TEST is high.
+		{bsl_pin_test, false, 0},		// Set TEST to low.
+	};
+
+	// DTR drives ~RST and RTS drives TEST, both through an inverting level shifter.
+	sequence_p->wiring.reset_line = SERIAL_LINE_DTR;
+	sequence_p->wiring.reset_inverted = true;
+	sequence_p->wiring.test_line = SERIAL_LINE_RTS;
+	sequence_p->wiring.test_inverted = true;
+
+	memcpy(sequence_p->steps, steps, sizeof(steps));
+	sequence_p->step_count = sizeof(steps) / sizeof(steps[0]);
+
+	// Give the BSL time to start.
+	sequence_p->settle_time = 250000;
+}
+
+void bsl_set_entry_sequence(bsl_object_t * object_p, const bsl_entry_sequence_t * sequence_p)
+{
+	object_p->entry_sequence = *sequence_p;
+}
+
+int bsl_calibrate_entry_sequence(bsl_object_t * object_p, unsigned int attempts, unsigned int * settle_time_p)
+{
+	int error = 0;
+	bsl_entry_sequence_t original = object_p->entry_sequence;
+	bsl_entry_sequence_t reliable = original;
+	bsl_entry_sequence_t candidate;
+	bool shorten_steps = true;
+	unsigned int attempt;
+	size_t i;
+
+	if (attempts == 0) {
+		// Without a trial every candidate would pass.
+		fprintf(stderr, "Calibrating the entry sequence needs at least one attempt.\n");
+		error = 1;
+	}
+	else {
+		// The current sequence must work to begin with.
+		for (attempt = 0; (attempt < attempts) && !error; attempt++) {
+			error = bsl_initialize(object_p);
+		}
+		if (error) {
+			fprintf(stderr, "The entry sequence does not work, calibration aborted.\n");
+		}
+	}
+
+	// Halve the hold times, then the settle time, while entry stays reliable.
+	while (!error) {
+		bool changed = false;
+
+		candidate = reliable;
+		if (shorten_steps) {
+			for (i = 0; i < candidate.step_count; i++) {
+				if (candidate.steps[i].hold > 1) {
+					candidate.steps[i].hold /= 2;
+					changed = true;
+				}
+			}
+		}
+		else if (candidate.settle_time > 1) {
+			candidate.settle_time /= 2;
+			changed = true;
+		}
+
+		if (!changed) {
+			if (!shorten_steps) {
+				break;
+			}
+			shorten_steps = false;
+			continue;
+		}
+
+		object_p->entry_sequence = candidate;
+		for (attempt = 0; attempt < attempts; attempt++) {
+			if (bsl_initialize(object_p)) {
+				break;
+			}
+		}
+
+		if (attempt == attempts) {
+			reliable = candidate;
+		}
+		else if (shorten_steps) {
+			shorten_steps = false;
+		}
+		else {
+			break;
+		}
+	}
 
-	// Set ~RST and TEST to low.
-	serial_set_dtr(object_p->fd, false);
-	serial_set_rts(object_p->fd, false);
+	if (!error) {
+		// Keep a safety margin on top of the shortest reliable times.
+		for (i = 0; i < reliable.step_count; i++) {
+			reliable.steps[i].hold *= BSL_ENTRY_CALIBRATION_MARGIN;
+		}
+		reliable.settle_time *= BSL_ENTRY_CALIBRATION_MARGIN;
+		object_p->entry_sequence = reliable;
 
-	// Set TEST to high.
-	serial_set_rts(object_p->fd, true);
+		// The last trial may have been rejected, end with a synchronized BSL and a verified sequence.
+		for (attempt = 0; (attempt < attempts) && !error; attempt++) {
+			error = bsl_initialize(object_p);
+		}
+		if (error) {
+			fprintf(stderr, "The calibrated entry sequence does not work, the original sequence is kept.\n");
+		}
+	}
 
-	// Set TEST to low.
-	serial_set_rts(object_p->fd, false);
+	if (error) {
+		object_p->entry_sequence = original;
+	}
+	else {
+		*settle_time_p = reliable.settle_time;
+	}
 
-	// Set TEST to high.
-	serial_set_rts(object_p->fd, true);
+	return error;
+}
 
-	// Set ~RST to high.
-	serial_set_dtr(object_p->fd, true);
+int bsl_run_entry_sequence(bsl_object_t * object_p)
+{
+	// Nothing is known about the BSL until it answers, it starts at 9600 baud.
+	object_p->link_state = bsl_link_unsynchronized;
+	object_p->link_failed = false;
+	object_p->timing.baudrate = 9600;
+
+	// Drive the pins through the entry sequence and wait for the BSL to start.
+	return bsl_run_entry_steps(object_p, object_p->entry_sequence.steps,
+			object_p->entry_sequence.step_count, object_p->entry_sequence.settle_time);
+}
 
-	// Set TEST to low.
-	serial_set_rts(object_p->fd, false);
+int bsl_initialize(bsl_object_t * object_p)
+{
+	int error = 0;
+
+	error = bsl_run_entry_sequence(object_p);
 
-	// Wait at least 100 microseconds.
-	usleep(250000);
+	if (!error) {
+		error = bsl_send_synchronization_sequence(object_p);
+	}
 
-	return bsl_send_synchronization_sequence(object_p);
+	return error;
 }
 
 void bsl_terminate(bsl_object_t * object_p)
 {
-	// Set ~RST to low.
-	serial_set_dtr(object_p->fd, false);
+	static const bsl_entry_step_t steps[] =
+	{
+		{bsl_pin_reset, false, 0},	// Set ~RST to low.
+		{bsl_pin_reset, true, 0},	// Set ~RST high.
+	};
+
+	bsl_run_entry_steps(object_p, steps, sizeof(steps) / sizeof(steps[0]), 0);
+	object_p->link_state = bsl_link_unsynchronized;
+}
 
-	// Set ~RST high.
-	serial_set_dtr(object_p->fd, true);
+void bsl_set_sync_mode(bsl_object_t * object_p, bsl_sync_mode sync_mode)
+{
+	object_p->sync_mode = sync_mode;
+}
+
+void bsl_get_statistics(bsl_object_t * object_p, bsl_statistics_t * statistics_p)
+{
+	*statistics_p = object_p->statistics;
+}
+
+void bsl_clear_statistics(bsl_object_t * object_p)
+{
+	memset(&object_p->statistics, 0, sizeof(object_p->statistics));
+}
+
+void bsl_resynchronize(bsl_object_t * object_p)
+{
+	unsigned char data[64];
+	int read_size;
+
+	// Discard the rest of an answer that came too late, until the line stays quiet.
+	do {
+		read_size = transport_read(object_p->transport_p, data, sizeof(data), bsl_get_timeout_margin(object_p));
+	} while (read_size > 0);
+
+	// The next command starts with a separate synchronization.
+	bsl_update_link_state(object_p, 1, bsl_link_unsynchronized);
+}
+
+void bsl_start_deadline(bsl_object_t * object_p, size_t request_size, size_t response_size, double operation_time)
+{
+	bsl_timing_t * timing_p = &object_p->timing;
+
+	// The request and the response both take their character times at the current rate.
+	timing_p->start = transport_get_time(object_p->transport_p);
+	timing_p->wire_time = (double) (request_size + response_size) * BSL_BITS_PER_BYTE / timing_p->baudrate;
+	timing_p->deadline = timing_p->start + timing_p->wire_time + operation_time + bsl_get_timeout_margin(object_p)
+			+ transport_get_latency_margin(object_p->transport_p);
+
+	// Flash operation times are upper bounds, only commands without one tell the latency.
+	timing_p->sample = (operation_time == 0);
+}
+
+double bsl_get_remaining_time(bsl_object_t * object_p)
+{
+	double remaining = object_p->timing.deadline - transport_get_time(object_p->transport_p);
+
+	return (remaining > 0) ? remaining : 0;
+}
+
+void bsl_sample_round_trip(bsl_object_t * object_p)
+{
+	bsl_timing_t * timing_p = &object_p->timing;
+	double latency;
+
+	if (timing_p->sample) {
+		latency = transport_get_time(object_p->transport_p) - timing_p->start - timing_p->wire_time;
+		if (latency < 0) {
+			latency = 0;
+		}
+
+		// Smooth the latency and its deviation as TCP does for its retransmission timer.
+		if (!timing_p->latency_known) {
+			timing_p->latency = latency;
+			timing_p->latency_deviation = latency / 2;
+			timing_p->latency_known = true;
+		}
+		else {
+			double deviation = (latency > timing_p->latency) ? latency - timing_p->latency : timing_p->latency - latency;
+
+			timing_p->latency_deviation = 0.75 * timing_p->latency_deviation + 0.25 * deviation;
+			timing_p->latency = 0.875 * timing_p->latency + 0.125 * latency;
+		}
+
+		timing_p->sample = false;
+	}
+}
+
+double bsl_get_timeout_margin(bsl_object_t * object_p)
+{
+	const bsl_timing_t * timing_p = &object_p->timing;
+	double margin = BSL_TIMEOUT;
+
+	if (timing_p->latency_known) {
+		margin = timing_p->latency + 4 * timing_p->latency_deviation;
+		if (margin < BSL_MIN_TIMEOUT_MARGIN) {
+			margin = BSL_MIN_TIMEOUT_MARGIN;
+		}
+		else if (margin > BSL_TIMEOUT) {
+			margin = BSL_TIMEOUT;
+		}
+	}
+
+	return margin;
+}
+
+int bsl_measure_latency(bsl_object_t * object_p, unsigned int count, double * latency_p)
+{
+	int error = 0;
+	unsigned int i;
+	double start;
+	double end;
+
+	start = transport_get_time(object_p->transport_p);
+
+	// Every synchronization is one complete half-duplex round trip.
+	for (i = 0; (i < count) && !error; i++) {
+		error = bsl_send_synchronization_sequence(object_p);
+	}
+
+	end = transport_get_time(object_p->transport_p);
+
+	if (!error && (count > 0)) {
+		*latency_p = (end - start) / count;
+	}
+
+	return error;
+}
+
+int bsl_enable_low_latency(bsl_object_t * object_p, double * latency_before_p, double * latency_after_p)
+{
+	int error = 0;
+
+	// Measure the current round trip latency.
+	error = bsl_measure_latency(object_p, BSL_LATENCY_ROUND_TRIPS, latency_before_p);
+
+	if (!error) {
+		// Switch the link to the low latency profile.
+		error = transport_set_low_latency(object_p->transport_p, true);
+	}
+
+	if (!error) {
+		// Measure the round trip latency again.
+		error = bsl_measure_latency(object_p, BSL_LATENCY_ROUND_TRIPS, latency_after_p);
+	}
+
+	return error;
 }
 
 int bsl_rx_data_block(bsl_object_t * object_p, unsigned short address, const unsigned char * data, size_t size)
 {
 	int error = 0;
-	unsigned char * write_data;
 
 	if (address % 2)
 	{
@@ -104,36 +445,14 @@ int bsl_rx_data_block(bsl_object_t * object_p, unsigned short address, const uns
 		error = 1;
 	}
 
-	if ((size % 2) && (size < 250)) {
-		fprintf(stderr, "Number of registers should be multiple of 1 and less than 250.\n");
+	if ((size % 2) || (size > BSL_MAX_BLOCK_SIZE) || (size == 0)) {
+		fprintf(stderr, "Number of registers should be a multiple of 2, more than 0 and at most 250.\n");
 		error = 1;
 	}
 
 	if (!error) {
-		// Allocate memory for the request data.
-		write_data = malloc(BSL_REQUEST_SIZE + size);
-		if (write_data == NULL) {
-			fprintf(stderr, "Failed to allocate memory for the request data.\n");
-			error = 1;
-		}
-	}
-
-	if (!error) {
-		// Form the package.
-		write_data[0] = 0x80;
-		write_data[1] = 0x12;
-		write_data[2] = 4 + size;
-		write_data[3] = write_data[2];
-		write_data[4] = address % 256;
-		write_data[5] = address / 256;
-		write_data[6] = size;
-		write_data[7] = 0x00;
-
-		// Copy the data.
-		memcpy(&(write_data[8]), data, size);
-
-		// Write the package.
-		error = bsl_write_request(object_p, write_data, 8);
+		// Write the package, the data is sent from the buffer of the caller.
+		error = bsl_write_request(object_p, 0x12, address, size, data, size);
 	}
 
 	if (!error) {
@@ -141,34 +460,15 @@ int bsl_rx_data_block(bsl_object_t * object_p, unsigned short address, const uns
 		error = bsl_read_ack_response(object_p);
 	}
 
-	// Free the read_data (if possible).
-	if (write_data != NULL) {
-		free(write_data);
-	}
-
 	return error;
 }
 
 int bsl_rx_password(bsl_object_t * object_p, const unsigned char * password)
 {
 	int error = 0;
-	unsigned char write_data[BSL_REQUEST_SIZE + BSL_PASSWORD_SIZE];
-
-	// Form the package.
-	write_data[0] = 0x80;
-	write_data[1] = 0x10;
-	write_data[2] = 24;
-	write_data[3] = write_data[2];
-	write_data[4] = 0x00;
-	write_data[5] = 0x00;
-	write_data[6] = 0x00;
-	write_data[7] = 0x00;
-
-	// Copy the password.
-	memcpy(&(write_data[8]), password, BSL_PASSWORD_SIZE);
 
 	// Write the package.
-	error = bsl_write_request(object_p, write_data, 8 + BSL_PASSWORD_SIZE);
+	error = bsl_write_request(object_p, 0x10, 0x0000, 0x0000, password, BSL_PASSWORD_SIZE);
 
 	if (!error) {
 		// Read the package.
@@ -181,7 +481,6 @@ int bsl_rx_password(bsl_object_t * object_p, const unsigned char * password)
 int bsl_erase_segment(bsl_object_t * object_p, unsigned short address)
 {
 	int error = 0;
-	unsigned char write_data[BSL_REQUEST_SIZE];
 
 	if (address % 2)
 	{
@@ -191,18 +490,8 @@ int bsl_erase_segment(bsl_object_t * object_p, unsigned short address)
 
 	if (!error)
 	{
-		// Form the package.
-		write_data[0] = 0x80;
-		write_data[1] = 0x16;
-		write_data[2] = 4;
-		write_data[3] = write_data[2];
-		write_data[4] = address % 256;
-		write_data[5] = address / 256;
-		write_data[6] = 0x02;
-		write_data[7] = 0xA5;
-
 		// Write the package.
-		error = bsl_write_request(object_p, write_data, 8);
+		error = bsl_write_request(object_p, 0x16, address, 0xA502, NULL, 0);
 	}
 
 	if (!error) {
@@ -216,7 +505,6 @@ int bsl_erase_segment(bsl_object_t * object_p, unsigned short address)
 int bsl_erase_main_info(bsl_object_t * object_p, unsigned short address)
 {
 	int error = 0;
-	unsigned char write_data[BSL_REQUEST_SIZE];
 
 	if (address % 2)
 	{
@@ -226,18 +514,8 @@ int bsl_erase_main_info(bsl_object_t * object_p, unsigned short address)
 
 	if (!error)
 	{
-		// Form the package.
-		write_data[0] = 0x80;
-		write_data[1] = 0x16;
-		write_data[2] = 4;
-		write_data[3] = write_data[2];
-		write_data[4] = address % 256;
-		write_data[5] = address / 256;
-		write_data[6] = 0x04;
-		write_data[7] = 0xA5;
-
 		// Write the package.
-		error = bsl_write_request(object_p, write_data, 8);
+		error = bsl_write_request(object_p, 0x16, address, 0xA504, NULL, 0);
 	}
 
 	if (!error) {
@@ -251,27 +529,37 @@ int bsl_erase_main_info(bsl_object_t * object_p, unsigned short address)
 int bsl_mass_erase(bsl_object_t * object_p)
 {
 	int error = 0;
-	unsigned char write_data[BSL_REQUEST_SIZE];
 
-	if (!error)
+	// Write the package.
+	error = bsl_write_request(object_p, 0x18, 0x0000, 0xA504, NULL, 0);
+
+	if (!error) {
+		// Read the package.
+		error = bsl_read_ack_response(object_p);
+	}
+
+	return error;
+}
+
+int bsl_erase_check(bsl_object_t * object_p, unsigned short address, unsigned short length, bool * blank_p)
+{
+	int error = 0;
+
+	if ((address % 2) || (length % 2) || (length == 0))
 	{
-		// Form the package.
-		write_data[0] = 0x80;
-		write_data[1] = 0x18;
-		write_data[2] = 4;
-		write_data[3] = write_data[2];
-		write_data[4] = 0x00;
-		write_data[5] = 0x00;
-		write_data[6] = 0x04;
-		write_data[7] = 0xA5;
+		fprintf(stderr, "Erase check address and length should be multiples of 2.\n");
+		error = 1;
+	}
 
+	if (!error)
+	{
 		// Write the package.
-		error = bsl_write_request(object_p, write_data, 8);
+		error = bsl_write_request(object_p, 0x1C, address, length, NULL, 0);
 	}
 
 	if (!error) {
-		// Read the package.
-		error = bsl_read_ack_response(object_p);
+		// The BSL answers a range with a byte other than 0xFF with a NAK.
+		error = bsl_read_acknowledge(object_p, blank_p);
 	}
 
 	return error;
@@ -280,49 +568,46 @@ int bsl_mass_erase(bsl_object_t * object_p)
 int bsl_change_baudrate(bsl_object_t * object_p, bsl_baudrate_settings baudrate_settings)
 {
 	int error = 0;
-	unsigned char write_data[BSL_REQUEST_SIZE];
+	unsigned short clock_registers;
+	unsigned short baudrate = 0x0000;
 
-	if (!error)
-	{
-		// Form the package.
-		write_data[0] = 0x80;
-		write_data[1] = 0x20;
-		write_data[2] = 4;
-		write_data[3] = write_data[2];
-		write_data[4] = baudrate_settings.clock_register_0;
-		write_data[5] = baudrate_settings.clock_register_1;
-		write_data[7] = 0x00;
-
-		// Set the baud rate parameter.
-		switch (baudrate_settings.bsl_baudrate)
-		{
-		case bsl_baudrate_9600:
-			write_data[6] = 0x00;
-			break;
-		case bsl_baudrate_19200:
-			write_data[6] = 0x01;
-			break;
-		case bsl_baudrate_38400:
-			write_data[6] = 0x02;
-			break;
-		}
+	// The clock registers take the place of the address.
+	clock_registers = baudrate_settings.clock_register_0 + baudrate_settings.clock_register_1 * 256;
 
-		// Write the package.
-		error = bsl_write_request(object_p, write_data, 8);
+	// Set the baud rate parameter.
+	switch (baudrate_settings.bsl_baudrate)
+	{
+	case bsl_baudrate_9600:
+		baudrate = 0x0000;
+		break;
+	case bsl_baudrate_19200:
+		baudrate = 0x0001;
+		break;
+	case bsl_baudrate_38400:
+		baudrate = 0x0002;
+		break;
 	}
 
+	// Write the package.
+	error = bsl_write_request(object_p, 0x20, clock_registers, baudrate, NULL, 0);
+
 	if (!error) {
-		// Read the package.
+		// Read the package, the acknowledge still comes at the old rate.
 		error = bsl_read_ack_response(object_p);
 	}
 
+	if (!error) {
+		static const unsigned int rates[] = {9600, 19200, 38400};
+
+		object_p->timing.baudrate = rates[baudrate];
+	}
+
 	return error;
 }
 
 int bsl_set_mem_offset(bsl_object_t * object_p, unsigned short offset)
 {
 	int error = 0;
-	unsigned char write_data[BSL_REQUEST_SIZE];
 
 	if (offset % 2)
 	{
@@ -332,18 +617,8 @@ int bsl_set_mem_offset(bsl_object_t * object_p, unsigned short offset)
 
 	if (!error)
 	{
-		// Form the package.
-		write_data[0] = 0x80;
-		write_data[1] = 0x21;
-		write_data[2] = 4;
-		write_data[3] = write_data[2];
-		write_data[4] = 0x00;
-		write_data[5] = 0x00;
-		write_data[6] = offset % 256;
-		write_data[7] = offset / 256;
-
 		// Write the package.
-		error = bsl_write_request(object_p, write_data, 8);
+		error = bsl_write_request(object_p, 0x21, 0x0000, offset, NULL, 0);
 	}
 
 	if (!error) {
@@ -357,7 +632,6 @@ int bsl_set_mem_offset(bsl_object_t * object_p, unsigned short offset)
 int bsl_load_pc(bsl_object_t * object_p, unsigned short address)
 {
 	int error = 0;
-	unsigned char write_data[BSL_REQUEST_SIZE];
 
 	if (address % 2)
 	{
@@ -367,18 +641,8 @@ int bsl_load_pc(bsl_object_t * object_p, unsigned short address)
 
 	if (!error)
 	{
-		// Form the package.
-		write_data[0] = 0x80;
-		write_data[1] = 0x1A;
-		write_data[2] = 4;
-		write_data[3] = write_data[2];
-		write_data[4] = address % 256;
-		write_data[5] = address / 256;
-		write_data[6] = 0x00;
-		write_data[7] = 0x00;
-
 		// Write the package.
-		error = bsl_write_request(object_p, write_data, 8);
+		error = bsl_write_request(object_p, 0x1A, address, 0x0000, NULL, 0);
 	}
 
 	if (!error) {
@@ -392,8 +656,6 @@ int bsl_load_pc(bsl_object_t * object_p, unsigned short address)
 int bsl_tx_data_block(bsl_object_t * object_p, unsigned short address, unsigned char * data, size_t size)
 {
 	int error = 0;
-	unsigned char write_data[BSL_REQUEST_SIZE];
-	unsigned char * read_data;
 
 	if (address % 2)
 	{
@@ -407,7 +669,7 @@ int bsl_tx_data_block(bsl_object_t * object_p, unsigned short address, unsigned
 		error = 1;
 	}
 
-	if (size > 250)
+	if (size > BSL_MAX_BLOCK_SIZE)
 	{
 		fprintf(stderr, "Number of registers should be less than 250.\n");
 		error = 1;
@@ -419,193 +681,526 @@ int bsl_tx_data_block(bsl_object_t * object_p, unsigned short address, unsigned
 		error = 1;
 	}
 
-	if (!error)
-	{
-		// Allocate memory for the response and the data.
-		read_data = malloc(BSL_DATA_RESPONSE_SIZE + size);
-		if (read_data == NULL) {
-			fprintf(stderr, "Failed to allocate memory for the response data.\n");
-			error = 1;
-		}
+	if (!error) {
+		// Write the package.
+		error = bsl_write_request(object_p, 0x14, address, size, NULL, 0);
 	}
 
 	if (!error) {
-		// Form the package.
-		write_data[0] = 0x80;
-		write_data[1] = 0x14;
-		write_data[2] = 4;
-		write_data[3] = write_data[2];
-		write_data[4] = address % 256;
-		write_data[5] = address / 256;
-		write_data[6] = (unsigned char) size;
-		write_data[7] = 0x00;
+		// Read the package, the data is received into the buffer of the caller.
+		error = bsl_read_data_response(object_p, data, size);
+	}
 
-		// Write the package.
-		error = bsl_write_request(object_p, write_data, 8);
+	return error;
+}
+
+void bsl_transaction_init(bsl_transaction_t * transaction_p, bsl_operation_t * operations, size_t capacity)
+{
+	transaction_p->operations = operations;
+	transaction_p->capacity = capacity;
+	transaction_p->count = 0;
+}
+
+int bsl_transaction_rx_data_block(bsl_transaction_t * transaction_p, unsigned short address, const unsigned char * data, size_t size)
+{
+	int error = 0;
+
+	if ((size % 2) || (size > BSL_MAX_BLOCK_SIZE) || (size == 0)) {
+		fprintf(stderr, "Number of registers should be a multiple of 2, more than 0 and at most 250.\n");
+		error = 1;
 	}
 
 	if (!error) {
-		// Read the package.
-		error = bsl_read_data_response(object_p, read_data, BSL_DATA_RESPONSE_SIZE + size);
+		error = bsl_add_operation(transaction_p, bsl_operation_rx_data_block, 0x12, address, size, data, NULL, size);
+	}
+
+	return error;
+}
+
+int bsl_transaction_tx_data_block(bsl_transaction_t * transaction_p, unsigned short address, unsigned char * data, size_t size)
+{
+	int error = 0;
+
+	if ((size % 2) || (size > BSL_MAX_BLOCK_SIZE) || (size == 0)) {
+		fprintf(stderr, "Number of registers should be a multiple of 2, more than 0 and at most 250.\n");
+		error = 1;
 	}
 
 	if (!error) {
-		// Copy the register data.
-		memcpy(data, &read_data[4], size);
+		error = bsl_add_operation(transaction_p, bsl_operation_tx_data_block, 0x14, address, size, NULL, data, size);
 	}
 
-	// Free the read_data (if possible).
-	if (read_data != NULL) {
-		free(read_data);
+	return error;
+}
+
+int bsl_transaction_erase_segment(bsl_transaction_t * transaction_p, unsigned short address)
+{
+	return bsl_add_operation(transaction_p, bsl_operation_erase_segment, 0x16, address, 0xA502, NULL, NULL, 0);
+}
+
+int bsl_transaction_erase_main_info(bsl_transaction_t * transaction_p, unsigned short address)
+{
+	return bsl_add_operation(transaction_p, bsl_operation_erase_main_info, 0x16, address, 0xA504, NULL, NULL, 0);
+}
+
+int bsl_transaction_mass_erase(bsl_transaction_t * transaction_p)
+{
+	return bsl_add_operation(transaction_p, bsl_operation_mass_erase, 0x18, 0x0000, 0xA504, NULL, NULL, 0);
+}
+
+int bsl_transaction_set_mem_offset(bsl_transaction_t * transaction_p, unsigned short offset)
+{
+	int error = 0;
+
+	if (offset % 2)
+	{
+		fprintf(stderr, "Register offset should be a multiple of 2.\n");
+		error = 1;
+	}
+
+	if (!error) {
+		error = bsl_add_operation(transaction_p, bsl_operation_set_mem_offset, 0x21, 0x0000, offset, NULL, NULL, 0);
+	}
+
+	return error;
+}
+
+int bsl_transaction_load_pc(bsl_transaction_t * transaction_p, unsigned short address)
+{
+	return bsl_add_operation(transaction_p, bsl_operation_load_pc, 0x1A, address, 0x0000, NULL, NULL, 0);
+}
+
+int bsl_execute_transaction(bsl_object_t * object_p, bsl_transaction_t * transaction_p)
+{
+	int error = 0;
+	size_t i;
+
+	// The frames are ready, only the answers of the BSL separate the commands.
+	for (i = 0; i < transaction_p->count; i++) {
+		bsl_operation_t * operation_p = &(transaction_p->operations[i]);
+
+		if (error) {
+			// The rest of the sequence depends on what failed.
+			operation_p->result = bsl_error_skipped;
+		}
+		else {
+			operation_p->result = bsl_send_request(object_p, operation_p->frame, operation_p->checksum,
+					operation_p->payload, (operation_p->payload != NULL) ? operation_p->size : 0);
+
+			if (!operation_p->result && (operation_p->type == bsl_operation_tx_data_block)) {
+				operation_p->result = bsl_read_data_response(object_p, operation_p->data, operation_p->size);
+			}
+			else if (!operation_p->result) {
+				operation_p->result = bsl_read_ack_response(object_p);
+			}
+
+			error = operation_p->result;
+		}
 	}
 
 	return error;
 }
 
-static int bsl_write_request(bsl_object_t * object_p, unsigned char * data, size_t size)
+static int bsl_write_request(bsl_object_t * object_p, unsigned char command, unsigned short address,
+		unsigned short length, const unsigned char * payload, size_t payload_size)
 {
+	// Form the frame in the buffers of the BSL object.
+	bsl_build_request(object_p->request_header, object_p->request_checksum, command, address, length, payload, payload_size);
+
+	return bsl_send_request(object_p, object_p->request_header, object_p->request_checksum, payload, payload_size);
+}
+
+static void bsl_build_request(unsigned char * frame, unsigned char * checksum_data, unsigned char command,
+		unsigned short address, unsigned short length, const unsigned char * payload, size_t payload_size)
+{
+	unsigned char * header = &(frame[1]);
 	unsigned short checksum;
+
+	// Form the header in place, behind the room for a merged synchronization character.
+	frame[0] = BSL_SYNC;
+	header[0] = 0x80;
+	header[1] = command;
+	header[2] = 4 + payload_size;
+	header[3] = header[2];
+	header[4] = address % 256;
+	header[5] = address / 256;
+	header[6] = length % 256;
+	header[7] = length / 256;
+
+	// The checksum covers the header and the payload where they are.
+	checksum = checksum_xor16(0, header, BSL_HEADER_SIZE);
+	checksum = ~checksum_xor16(checksum, payload, payload_size);
+	checksum_data[0] = checksum % 256;
+	checksum_data[1] = checksum / 256;
+}
+
+static int bsl_send_request(bsl_object_t * object_p, unsigned char * frame, unsigned char * checksum_data,
+		const unsigned char * payload, size_t payload_size)
+{
+	unsigned char * header = &(frame[1]);
+	unsigned char command = header[1];
+	unsigned short length = header[6] + header[7] * 256;
+	size_t request_size = BSL_HEADER_SIZE + payload_size + BSL_CHECKSUM_SIZE;
+	size_t response_size = (command == 0x14) ? BSL_RESPONSE_HEADER_SIZE + length + BSL_CHECKSUM_SIZE : 1;
+	double operation_time = bsl_get_operation_time(command, length, payload_size);
+	struct iovec vectors[3];
 	int error = 0;
 
-	// Calculate the checksum.
-	checksum = bsl_calculate_checksum(data, size);
+	// Header, payload and checksum go out in a single write.
+	vectors[0].iov_base = header;
+	vectors[0].iov_len = BSL_HEADER_SIZE;
+	vectors[1].iov_base = (void *) payload;
+	vectors[1].iov_len = payload_size;
+	vectors[2].iov_base = checksum_data;
+	vectors[2].iov_len = BSL_CHECKSUM_SIZE;
+
+	object_p->statistics.commands++;
+
+	if (object_p->link_state == bsl_link_synchronized) {
+		// The BSL is already waiting for a frame, skip the synchronization.
+		object_p->statistics.syncs_elided++;
+		object_p->statistics.round_trips++;
+		bsl_start_deadline(object_p, request_size, response_size, operation_time);
+		if (transport_writev(object_p->transport_p, vectors, 3) != (int) request_size) {
+			error = bsl_error_failed;
+		}
+	}
+	else if ((object_p->link_state == bsl_link_idle) && (object_p->sync_mode == bsl_sync_merged)) {
+		// Send the synchronization character and the command at once, its ACK precedes the response.
+		vectors[0].iov_base = frame;
+		vectors[0].iov_len = 1 + BSL_HEADER_SIZE;
+
+		object_p->statistics.syncs_merged++;
+		object_p->statistics.round_trips++;
+		bsl_start_deadline(object_p, 1 + request_size, 1 + response_size, operation_time);
+		if (transport_writev(object_p->transport_p, vectors, 3) != (int) (1 + request_size)) {
+			error = bsl_error_failed;
+		}
+		else {
+			error = bsl_read_synchronization_ack(object_p);
+		}
+	}
+	else {
+		if (object_p->link_failed) {
+			object_p->statistics.resyncs++;
+		}
+
+		// Send the synchronization sequence.
+		error = bsl_send_synchronization_sequence(object_p);
+
+		if (!error) {
+			// Write the command.
+			object_p->statistics.round_trips++;
+			bsl_start_deadline(object_p, request_size, response_size, operation_time);
+			if (transport_writev(object_p->transport_p, vectors, 3) != (int) request_size) {
+				error = bsl_error_failed;
+			}
+		}
+	}
+
+	// Until the response is read, the BSL is busy with the command.
+	object_p->link_state = bsl_link_unsynchronized;
+
+	return error;
+}
+
+static int bsl_add_operation(bsl_transaction_t * transaction_p, bsl_operation_type type, unsigned char command,
+		unsigned short address, unsigned short length, const unsigned char * payload, unsigned char * data, size_t size)
+{
+	int error = 0;
+	bsl_operation_t * operation_p = NULL;
 
-	// Add the checksum to the data.
-	data[size] = checksum % 256;
-	size++;
-	data[size] = checksum / 256;
-	size++;
+	if (address % 2)
+	{
+		fprintf(stderr, "Register address should be a multiple of 2.\n");
+		error = 1;
+	}
 
-	// Send the synchronization sequence.
-	error = bsl_send_synchronization_sequence(object_p);
+	if (transaction_p->count >= transaction_p->capacity)
+	{
+		fprintf(stderr, "The transaction is full.\n");
+		error = 1;
+	}
 
 	if (!error) {
-		// Write the command.
-		serial_write(object_p->fd, (char*) data, size);
+		operation_p = &(transaction_p->operations[transaction_p->count++]);
+		operation_p->type = type;
+		operation_p->payload = payload;
+		operation_p->data = data;
+		operation_p->size = size;
+		operation_p->result = bsl_error_skipped;
+
+		// Build the frame now, executing it only sends it.
+		bsl_build_request(operation_p->frame, operation_p->checksum, command, address, length, payload,
+				(payload != NULL) ? size : 0);
 	}
 
 	return error;
 }
 
+static double bsl_get_operation_time(unsigned char command, unsigned short length, size_t payload_size)
+{
+	double operation_time = 0;
+
+	switch (command)
+	{
+	case 0x12:
+		// RX data block, word by word.
+		operation_time = (payload_size / 2) * BSL_WORD_WRITE_TIME;
+		break;
+	case 0x16:
+		// Erase segment or erase main/info.
+		operation_time = (length == 0xA502) ? BSL_SEGMENT_ERASE_TIME : BSL_MASS_ERASE_TIME;
+		break;
+	case 0x18:
+		// Mass erase.
+		operation_time = BSL_MASS_ERASE_TIME;
+		break;
+	case 0x1C:
+		// Erase check, the BSL reads the range.
+		operation_time = length * BSL_ERASE_CHECK_BYTE_TIME;
+		break;
+	}
+
+	return operation_time;
+}
+
 static int bsl_read_ack_response(bsl_object_t * object_p)
+{
+	int error = 0;
+	bool ack = false;
+
+	error = bsl_read_acknowledge(object_p, &ack);
+
+	if (!error && !ack) {
+		fprintf(stderr, "Received DATA_NACK.\n");
+		error = bsl_error_nak;
+	}
+
+	return error;
+}
+
+static int bsl_read_acknowledge(bsl_object_t * object_p, bool * ack_p)
 {
 	int error = 0;
 	unsigned char data;
-	size_t read_size = 0;
 
 	// Read the package.
-	read_size = serial_read(object_p->fd, (char *) &data, 1, BSL_TIMEOUT);
-	if (read_size == 0) {
-		fprintf(stderr, "Could not read the data response.\n");
-		error = 1;
-	}
+	error = bsl_read_response_bytes(object_p, &data, 1);
 
 	if (!error) {
-		// Validate the package.
-		if (data == 0xA0) {
-			// Header incorrect.
-			fprintf(stderr, "Received DATA_NACK.\n");
-			error = 1;
+		// Validate the package, a NAK is an answer as well.
+		if (data == BSL_DATA_NAK) {
+			*ack_p = false;
+		}
+		else if (data == BSL_DATA_ACK) {
+			*ack_p = true;
 		}
 		else {
-			if (data != 0x90) {
-				// Header incorrect.
-				fprintf(stderr, "Incorrect header, received header: 0x%2x.\n", data);
-				error = 1;
-			}
+			// Header incorrect.
+			fprintf(stderr, "Incorrect header, received header: 0x%2x.\n", data);
+			error = bsl_error_header;
 		}
 	}
 
+	if (!error) {
+		bsl_sample_round_trip(object_p);
+	}
+
+	bsl_update_link_state(object_p, error, bsl_link_idle);
+
 	return error;
 }
 
 static int bsl_read_data_response(bsl_object_t * object_p, unsigned char * data, size_t size)
 {
 	int error = 0;
-	size_t read_size = 0;
+	unsigned char * header = object_p->response_header;
+	unsigned char * checksum_data = &(object_p->response_header[BSL_RESPONSE_HEADER_SIZE]);
 
-	// Read the package.
-	read_size = serial_read(object_p->fd, (char *) data, size, BSL_TIMEOUT);
-	if (read_size == 0) {
-		fprintf(stderr, "Could not read the data response.\n");
-		error = 1;
-	}
+	// Read the first byte on its own, a NAK is complete after it.
+	error = bsl_read_response_bytes(object_p, header, 1);
 
 	if (!error) {
-		// Validate the package.
-		if (data[0] == 0xA0) {
-			// Header incorrect.
+		if (header[0] == BSL_DATA_NAK) {
 			fprintf(stderr, "Received DATA_NACK.\n");
-			error = 1;
+			error = bsl_error_nak;
 		}
-		else if (data[0] != 0x80) {
+		else if (header[0] != BSL_SYNC) {
 			// Header incorrect.
-			fprintf(stderr, "Incorrect header, received header: 0x%2x.\n", data[0]);
-			error = 1;
+			fprintf(stderr, "Incorrect header, received header: 0x%2x.\n", header[0]);
+			error = bsl_error_header;
 		}
-		else if (data[2] != data[3]) {
+	}
+
+	if (!error) {
+		// Read the rest of the header, the length fields tell whether the frame is the one asked for.
+		error = bsl_read_response_bytes(object_p, &header[1], BSL_RESPONSE_HEADER_SIZE - 1);
+	}
+
+	if (!error) {
+		if (header[2] != header[3]) {
 			// Length fields unequal.
 			fprintf(stderr, "Length fields do not match.\n");
-			error = 1;
+			error = bsl_error_length;
 		}
-		else if (data[2] != size - 6) {
+		else if (header[2] != size) {
 			// Length field incorrect.
 			fprintf(stderr, "Incorrect length.\n");
-			error = 1;
+			error = bsl_error_length;
 		}
-		else {
-			// Check the checksum.
-			unsigned short checksum;
+	}
 
-			checksum = bsl_calculate_checksum(data, size - 2);
-			if (((checksum % 256) != data[size - 2]) || ((checksum / 256) != data[size - 1])) {
-				fprintf(stderr, "Incorrect checksum.\n");
-				error = 1;
-			}
+	if (!error) {
+		// Read the data straight into the buffer of the caller, then the checksum.
+		error = bsl_read_response_bytes(object_p, data, size);
+		if (!error) {
+			error = bsl_read_response_bytes(object_p, checksum_data, BSL_CHECKSUM_SIZE);
+		}
+	}
+
+	if (!error) {
+		// Check the checksum.
+		unsigned short checksum;
+
+		checksum = checksum_xor16(0, header, BSL_RESPONSE_HEADER_SIZE);
+		checksum = ~checksum_xor16(checksum, data, size);
+		if (((checksum % 256) != checksum_data[0]) || ((checksum / 256) != checksum_data[1])) {
+			fprintf(stderr, "Incorrect checksum.\n");
+			error = bsl_error_checksum;
 		}
 	}
 
+	if (!error) {
+		bsl_sample_round_trip(object_p);
+	}
+
+	bsl_update_link_state(object_p, error, bsl_link_idle);
+
+	return error;
+}
+
+static int bsl_read_response_bytes(bsl_object_t * object_p, unsigned char * data, size_t size)
+{
+	int error = 0;
+	int read_size;
+
+	// Only ask for what is known to follow, so the read returns as soon as it is there.
+	read_size = transport_read(object_p->transport_p, data, size, bsl_get_remaining_time(object_p));
+	if ((read_size < 0) || ((size_t) read_size != size)) {
+		fprintf(stderr, "Could not read the response.\n");
+		error = bsl_error_timeout;
+	}
+
 	return error;
 }
 
 static int bsl_send_synchronization_sequence(bsl_object_t * object_p)
 {
 	int error = 0;
-	unsigned char write_data = 0x80;
-	unsigned char read_data;
-	size_t read_size;
+	unsigned char write_data = BSL_SYNC;
 
 	// Send the 0x80 synchronisation character.
-	serial_write(object_p->fd, (char *) &write_data, 1);
+	object_p->statistics.round_trips++;
+	bsl_start_deadline(object_p, 1, 1, 0);
+	if (transport_write(object_p->transport_p, &write_data, 1) != 1) {
+		// Nothing will answer a character that was not sent, do not wait for it.
+		error = bsl_error_failed;
+	}
+	else {
+		error = bsl_read_synchronization_ack(object_p);
+	}
+
+	if (!error) {
+		bsl_sample_round_trip(object_p);
+	}
+
+	return error;
+}
+
+static int bsl_read_synchronization_ack(bsl_object_t * object_p)
+{
+	int error = 0;
+	unsigned char read_data;
+	size_t read_size;
 
 	// Read the 0x90 ACK character.
-	read_size = serial_read(object_p->fd, (char *) &read_data, 1, BSL_TIMEOUT);
+	read_size = transport_read(object_p->transport_p, &read_data, 1, bsl_get_remaining_time(object_p));
 
-	if ((read_size != 1) || (read_data != 0x90))
+	if (read_size != 1)
+	{
+		fprintf(stderr, "No return for synchronisation sequence.\n");
+		error = bsl_error_timeout;
+	}
+	else if (read_data != BSL_DATA_ACK)
 	{
 		fprintf(stderr, "Incorrect return for synchronisation sequence.\n");
-		error = 1;
+		error = (read_data == BSL_DATA_NAK) ? bsl_error_nak : bsl_error_header;
 	}
 
+	bsl_update_link_state(object_p, error, bsl_link_synchronized);
+
 	return error;
 }
 
-static unsigned short bsl_calculate_checksum(const unsigned char * data, size_t size)
+static void bsl_update_link_state(bsl_object_t * object_p, int error, bsl_link_state link_state)
+{
+	if (error) {
+		// Start over with a separate synchronization.
+		object_p->link_state = bsl_link_unsynchronized;
+		object_p->link_failed = true;
+	}
+	else {
+		object_p->link_state = link_state;
+		object_p->link_failed = false;
+	}
+}
+
+static int bsl_run_entry_steps(bsl_object_t * object_p, const bsl_entry_step_t * steps, size_t step_count, unsigned int settle_time)
 {
+	int error = 0;
+	const bsl_wiring_t * wiring_p = &object_p->entry_sequence.wiring;
+	unsigned int set_lines = 0;
+	unsigned int clear_lines = 0;
+	double deadline;
 	size_t i;
-	unsigned short checksum;
 
-	// Seed the checksum.
-	checksum = data[0] + data[1] * 256;
+	deadline = transport_get_time(object_p->transport_p);
 
-	// XOR all unsigned short pairs.
-	for (i = 2; i < size; i += 2)
-	{
-		checksum ^= data[i] + data[i + 1] * 256;
-	}
+	for (i = 0; (i < step_count) && !error; i++) {
+		unsigned int line;
+		bool asserted;
 
-	// Invert the checksum.
-	checksum = ~checksum;
+		// Translate the pin level to the adapter line.
+		if (steps[i].pin == bsl_pin_reset) {
+			line = wiring_p->reset_line;
+			asserted = steps[i].level != wiring_p->reset_inverted;
+		}
+		else {
+			line = wiring_p->test_line;
+			asserted = steps[i].level != wiring_p->test_inverted;
+		}
+
+		if (asserted) {
+			set_lines |= line;
+			clear_lines &= ~line;
+		}
+		else {
+			clear_lines |= line;
+			set_lines &= ~line;
+		}
+
+		// Steps without a hold time are batched with the next one.
+		if ((steps[i].hold > 0) || (i == step_count - 1)) {
+			error = transport_set_lines(object_p->transport_p, set_lines, clear_lines);
+			set_lines = 0;
+			clear_lines = 0;
+
+			// Deadlines are absolute, so the time spent in the ioctl calls counts towards the hold time.
+			deadline += ((i == step_count - 1) ? steps[i].hold + settle_time : steps[i].hold) / 1e6;
+			transport_sleep_until(object_p->transport_p, deadline);
+		}
+	}
 
-	return checksum;
+	return error;
 }
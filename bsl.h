@@ -9,12 +9,138 @@
 #ifndef BSL_H_
 #define BSL_H_
 
+#include <stdbool.h>
 #include <stddef.h>
 
+#include "transport.h"
+
+#define BSL_ENTRY_MAX_STEPS (16)
+#define BSL_HEADER_SIZE (8)
+#define BSL_RESPONSE_HEADER_SIZE (4)
+#define BSL_CHECKSUM_SIZE (2)
+#define BSL_MAX_BLOCK_SIZE (250)
+
+/**
+ * @brief Error classes returned by the BSL commands, 0 is success.
+ */
+typedef enum
+{
+	bsl_error_none = 0,		/**< Success.											*/
+	bsl_error_failed,		/**< Any other failure, such as an invalid argument.	*/
+	bsl_error_timeout,		/**< The response did not arrive in time.				*/
+	bsl_error_nak,			/**< The BSL rejected the command.						*/
+	bsl_error_header,		/**< The response does not start with a valid header.	*/
+	bsl_error_length,		/**< The length fields of the response are wrong.		*/
+	bsl_error_checksum,		/**< The checksum of the response is wrong.				*/
+	bsl_error_skipped		/**< Not executed, an earlier command failed.			*/
+} bsl_error;
+
+/**
+ * @brief Target pins driven by the entry sequence.
+ */
+typedef enum
+{
+	bsl_pin_reset,	/**< The ~RST/NMI pin.	*/
+	bsl_pin_test	/**< The TEST pin.		*/
+} bsl_pin;
+
+/**
+ * @brief One step of the entry sequence.
+ *
+ * Steps with a hold time of 0 are applied together with the next step.
+ */
+typedef struct
+{
+	bsl_pin			pin;	/**< Pin to drive.									*/
+	bool			level;	/**< Level on the target pin: TRUE = high.			*/
+	unsigned int	hold;	/**< Time to hold this state, in microseconds.		*/
+} bsl_entry_step_t;
+
+/**
+ * @brief Adapter wiring of the target pins.
+ */
+typedef struct
+{
+	unsigned int	reset_line;		/**< SERIAL_LINE_* connected to ~RST.						*/
+	bool			reset_inverted;	/**< TRUE if an asserted line drives the pin low.			*/
+	unsigned int	test_line;		/**< SERIAL_LINE_* connected to TEST.						*/
+	bool			test_inverted;	/**< TRUE if an asserted line drives the pin low.			*/
+} bsl_wiring_t;
+
+/**
+ * @brief Declarative BSL entry sequence.
+ */
+typedef struct
+{
+	bsl_wiring_t		wiring;							/**< Adapter wiring.								*/
+	bsl_entry_step_t	steps[BSL_ENTRY_MAX_STEPS];		/**< Pin changes, executed in order.				*/
+	size_t				step_count;						/**< Number of steps.								*/
+	unsigned int		settle_time;					/**< Time before synchronizing, in microseconds.	*/
+} bsl_entry_sequence_t;
+
+/**
+ * @brief How the synchronization character is sent before a command.
+ */
+typedef enum
+{
+	bsl_sync_separate,	/**< Wait for the ACK before sending the frame (ROM BSLs with a software UART).	*/
+	bsl_sync_merged		/**< Send it together with the frame and read both answers.						*/
+} bsl_sync_mode;
+
+/**
+ * @brief What the BSL is known to be waiting for.
+ */
+typedef enum
+{
+	bsl_link_unsynchronized,	/**< Unknown, after the entry sequence or an error.	*/
+	bsl_link_synchronized,		/**< A command frame, the sync was acknowledged.	*/
+	bsl_link_idle				/**< A sync, the last command completed.			*/
+} bsl_link_state;
+
+/**
+ * @brief Timeout model of the link.
+ *
+ * A command may take the time its bytes need on the wire, the time of its
+ * flash operation and a margin for the latency of the link. The margin is the
+ * smoothed round trip latency plus four times its mean deviation, measured on
+ * commands without a flash operation.
+ */
+typedef struct
+{
+	unsigned int	baudrate;				/**< Current line rate of the BSL.						*/
+	double			deadline;				/**< Time by which the current command must complete.	*/
+	double			start;					/**< Time the current command was sent.					*/
+	double			wire_time;				/**< Time the current command spends on the wire.		*/
+	bool			sample;					/**< TRUE if the current command measures the latency.	*/
+	bool			latency_known;			/**< TRUE once the latency has been measured.			*/
+	double			latency;				/**< Smoothed round trip latency.						*/
+	double			latency_deviation;		/**< Mean deviation of the round trip latency.			*/
+} bsl_timing_t;
+
+/**
+ * @brief Protocol statistics.
+ */
 typedef struct
 {
-	int fd;
+	unsigned long	commands;		/**< Command frames sent.								*/
+	unsigned long	round_trips;	/**< Writes the host waited on an answer for.			*/
+	unsigned long	syncs_elided;	/**< Commands sent without a sync.						*/
+	unsigned long	syncs_merged;	/**< Commands sent in one write with their sync.		*/
+	unsigned long	resyncs;		/**< Separate sync exchanges forced by an earlier error.	*/
+} bsl_statistics_t;
 
+typedef struct
+{
+	transport_t * transport_p;
+	bsl_entry_sequence_t entry_sequence;
+	bsl_sync_mode sync_mode;
+	bsl_link_state link_state;
+	bool link_failed;
+	bsl_statistics_t statistics;
+	bsl_timing_t timing;
+	unsigned char request_header[1 + BSL_HEADER_SIZE];
+	unsigned char request_checksum[BSL_CHECKSUM_SIZE];
+	unsigned char response_header[BSL_RESPONSE_HEADER_SIZE + BSL_CHECKSUM_SIZE];
 } bsl_object_t;
 
 typedef struct
@@ -29,20 +155,90 @@ typedef struct
 	}				bsl_baudrate;
 } bsl_baudrate_settings;
 
-bsl_object_t * bsl_construct(int fd);
+/**
+ * @brief Commands a transaction can hold.
+ */
+typedef enum
+{
+	bsl_operation_rx_data_block,	/**< Write a block of data.					*/
+	bsl_operation_tx_data_block,	/**< Read a block of data.					*/
+	bsl_operation_erase_segment,	/**< Erase a segment.						*/
+	bsl_operation_erase_main_info,	/**< Erase the main or information memory.	*/
+	bsl_operation_mass_erase,		/**< Erase all flash memory.				*/
+	bsl_operation_set_mem_offset,	/**< Set the memory offset.					*/
+	bsl_operation_load_pc			/**< Start the program at an address.		*/
+} bsl_operation_type;
+
+/**
+ * @brief A command of a transaction, its frame is built when it is added.
+ */
+typedef struct
+{
+	bsl_operation_type		type;								/**< The command.								*/
+	const unsigned char *	payload;							/**< Data to write, it must not change.			*/
+	unsigned char *			data;								/**< Room for the data read.					*/
+	size_t					size;								/**< Size of the payload or the data read.		*/
+	unsigned char			frame[1 + BSL_HEADER_SIZE];			/**< Header, behind room for a merged sync.		*/
+	unsigned char			checksum[BSL_CHECKSUM_SIZE];		/**< Checksum of the header and the payload.	*/
+	int						result;								/**< 0 on success, otherwise a bsl_error.		*/
+} bsl_operation_t;
+
+/**
+ * @brief A sequence of commands executed back to back.
+ */
+typedef struct
+{
+	bsl_operation_t *	operations;		/**< Room for the commands, owned by the caller.	*/
+	size_t				capacity;		/**< Number of commands that fit.					*/
+	size_t				count;			/**< Number of commands added.						*/
+} bsl_transaction_t;
+
+bsl_object_t * bsl_construct(transport_t * transport_p);
 void bsl_destroy(bsl_object_t * object_p);
+unsigned long bsl_get_allocation_count(void);
+const char * bsl_get_error_name(int error);
 
+void bsl_get_default_entry_sequence(bsl_entry_sequence_t * sequence_p);
+void bsl_set_entry_sequence(bsl_object_t * object_p, const bsl_entry_sequence_t * sequence_p);
+int bsl_calibrate_entry_sequence(bsl_object_t * object_p, unsigned int attempts, unsigned int * settle_time_p);
+
+int bsl_run_entry_sequence(bsl_object_t * object_p);
 int bsl_initialize(bsl_object_t * object_p);
 void bsl_terminate(bsl_object_t * object_p);
 
+void bsl_set_sync_mode(bsl_object_t * object_p, bsl_sync_mode sync_mode);
+void bsl_get_statistics(bsl_object_t * object_p, bsl_statistics_t * statistics_p);
+void bsl_clear_statistics(bsl_object_t * object_p);
+
+void bsl_resynchronize(bsl_object_t * object_p);
+
+void bsl_start_deadline(bsl_object_t * object_p, size_t request_size, size_t response_size, double operation_time);
+double bsl_get_remaining_time(bsl_object_t * object_p);
+void bsl_sample_round_trip(bsl_object_t * object_p);
+double bsl_get_timeout_margin(bsl_object_t * object_p);
+
+int bsl_measure_latency(bsl_object_t * object_p, unsigned int count, double * latency_p);
+int bsl_enable_low_latency(bsl_object_t * object_p, double * latency_before_p, double * latency_after_p);
+
 int bsl_rx_data_block(bsl_object_t * object_p, unsigned short address, const unsigned char * data, size_t size);
 int bsl_rx_password(bsl_object_t * object_p, const unsigned char * password);
 int bsl_erase_segment(bsl_object_t * object_p, unsigned short address);
 int bsl_erase_main_info(bsl_object_t * object_p, unsigned short address);
 int bsl_mass_erase(bsl_object_t * object_p);
+int bsl_erase_check(bsl_object_t * object_p, unsigned short address, unsigned short length, bool * blank_p);
 int bsl_change_baudrate(bsl_object_t * object_p, bsl_baudrate_settings baudrate_settings);
 int bsl_set_mem_offset(bsl_object_t * object_p, unsigned short offset);
 int bsl_load_pc(bsl_object_t * object_p, unsigned short address);
 int bsl_tx_data_block(bsl_object_t * object_p, unsigned short address, unsigned char * data, size_t size);
 
+void bsl_transaction_init(bsl_transaction_t * transaction_p, bsl_operation_t * operations, size_t capacity);
+int bsl_transaction_rx_data_block(bsl_transaction_t * transaction_p, unsigned short address, const unsigned char * data, size_t size);
+int bsl_transaction_tx_data_block(bsl_transaction_t * transaction_p, unsigned short address, unsigned char * data, size_t size);
+int bsl_transaction_erase_segment(bsl_transaction_t * transaction_p, unsigned short address);
+int bsl_transaction_erase_main_info(bsl_transaction_t * transaction_p, unsigned short address);
+int bsl_transaction_mass_erase(bsl_transaction_t * transaction_p);
+int bsl_transaction_set_mem_offset(bsl_transaction_t * transaction_p, unsigned short offset);
+int bsl_transaction_load_pc(bsl_transaction_t * transaction_p, unsigned short address);
+int bsl_execute_transaction(bsl_object_t * object_p, bsl_transaction_t * transaction_p);
+
 #endif /* BSL_H_ */
@@ -0,0 +1,669 @@
+/**
+ * @file	bsl_core.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the 5xx/6xx/FRxx core command BSL protocol.
+ *
+ * The flash BSL of the 5xx, 6xx and FRxx families wraps each core command in
+ * a 0x80/length/CRC16 packet. There is no synchronization character: the BSL
+ * acknowledges every packet with a single byte, followed by a response packet
+ * for the commands that have one. Addresses are 24 bits wide and a packet
+ * carries up to 256 bytes of data. The packets are built in the frame buffers
+ * of the BSL object, which a session uses for either protocol but not both.
+ *
+ * @see		http://www.ti.com/lit/ug/slau319i/slau319i.pdf
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bsl_core.h"
+#include "checksum.h"
+#include "transport.h"
+
+/**
+ * @defgroup bsl_core BSL Core Commands
+ * @brief 5xx/6xx/FRxx UART BSL protocol.
+ * @{
+ */
+
+#define BSL_CORE_DRAIN_TIMEOUT		(0.05)
+#define BSL_CORE_WORD_WRITE_TIME	(100e-6)
+#define BSL_CORE_SEGMENT_ERASE_TIME	(0.05)
+#define BSL_CORE_MASS_ERASE_TIME	(0.5)
+#define BSL_CORE_CRC_BYTE_TIME		(10e-6)
+#define BSL_CORE_HEADER				(0x80)
+#define BSL_CORE_ACK				(0x00)
+#define BSL_CORE_LEGACY_ACK			(0x90)
+#define BSL_CORE_DATA_RESPONSE		(0x3A)
+#define BSL_CORE_MESSAGE_RESPONSE	(0x3B)
+#define BSL_CORE_WRAPPER_SIZE		(3)
+#define BSL_CORE_ARGUMENT_SIZE		(5)
+
+_Static_assert(BSL_CORE_WRAPPER_SIZE + 1 + BSL_CORE_ARGUMENT_SIZE <= sizeof(((bsl_object_t *) 0)->request_header),
+		"The request header buffer is too small for a core command.");
+
+static int bsl_core_command(bsl_object_t * object_p, unsigned char command, const unsigned char * arguments,
+		size_t argument_size, const unsigned char * payload, size_t payload_size);
+static int bsl_core_write_packet(bsl_object_t * object_p, unsigned char command, const unsigned char * arguments,
+		size_t argument_size, const unsigned char * payload, size_t payload_size, size_t * response_size_p);
+static size_t bsl_core_estimate(unsigned char command, const unsigned char * arguments, size_t payload_size, double * operation_time_p);
+static int bsl_core_read_ack(bsl_object_t * object_p);
+static int bsl_core_read_response(bsl_object_t * object_p, unsigned char * data, size_t size);
+static int bsl_core_check_range(unsigned long address, size_t size, size_t max_size);
+static void bsl_core_put_address(unsigned char * arguments, unsigned long address);
+
+/**
+ * @brief	Check whether a core command BSL is listening, by asking for its version.
+ *
+ * Meant to be used right after the entry sequence. A 1xx/2xx/4xx BSL takes
+ * the start of the packet for a synchronization character and answers with
+ * 0x90, then rejects the length byte as a frame header with 0xA0. It has to
+ * be entered again before it is used.
+ *
+ * @param	object_p		The BSL object.
+ * @param	version			Location to store the BSL_CORE_VERSION_SIZE version bytes.
+ * @return	TRUE if a core command BSL answered.
+ */
+bool bsl_core_detect(bsl_object_t * object_p, unsigned char * version)
+{
+	bool detected = false;
+	unsigned char data[1];
+	size_t response_size;
+	size_t read_size = 0;
+
+	if (!bsl_core_write_packet(object_p, 0x19, NULL, 0, NULL, 0, &response_size)) {
+		// Read the acknowledge without complaining, any other answer is a different BSL.
+		read_size = transport_read(object_p->transport_p, data, 1, bsl_get_remaining_time(object_p));
+	}
+	if ((read_size == 1) && (data[0] == BSL_CORE_ACK)) {
+		detected = !bsl_core_read_response(object_p, version, BSL_CORE_VERSION_SIZE);
+	}
+	else if ((read_size == 1) && (data[0] == BSL_CORE_LEGACY_ACK)) {
+		// Discard the NAK of the ROM BSL, it ignores the rest of the packet.
+		transport_read(object_p->transport_p, data, 1, BSL_CORE_DRAIN_TIMEOUT);
+	}
+
+	return detected;
+}
+
+/**
+ * @brief	Write a block of data and wait for the result.
+ * @param	object_p		The BSL object.
+ * @param	address			Start address.
+ * @param	data			The data.
+ * @param	size			Size of the data, at most BSL_CORE_MAX_DATA_SIZE bytes.
+ * @return	0 on success, otherwise a bsl_error.
+ */
+int bsl_core_rx_data_block(bsl_object_t * object_p, unsigned long address, const unsigned char * data, size_t size)
+{
+	int error = 0;
+	unsigned char arguments[3];
+
+	error = bsl_core_check_range(address, size, BSL_CORE_MAX_DATA_SIZE);
+
+	if (!error) {
+		bsl_core_put_address(arguments, address);
+		error = bsl_core_command(object_p, 0x10, arguments, sizeof(arguments), data, size);
+	}
+
+	if (!error) {
+		error = bsl_core_read_response(object_p, NULL, 0);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Write a block of data without waiting for the result.
+ *
+ * The BSL only acknowledges the packet, write errors go unreported, so a
+ * stream of these is normally followed by a bsl_core_crc_check().
+ *
+ * @param	object_p		The BSL object.
+ * @param	address			Start address.
+ * @param	data			The data.
+ * @param	size			Size of the data, at most BSL_CORE_MAX_DATA_SIZE bytes.
+ * @return	0 on success, otherwise a bsl_error.
+ */
+int bsl_core_rx_data_block_fast(bsl_object_t * object_p, unsigned long address, const unsigned char * data, size_t size)
+{
+	int error = 0;
+	unsigned char arguments[3];
+
+	error = bsl_core_check_range(address, size, BSL_CORE_MAX_DATA_SIZE);
+
+	if (!error) {
+		bsl_core_put_address(arguments, address);
+		error = bsl_core_command(object_p, 0x1B, arguments, sizeof(arguments), data, size);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Unlock the BSL.
+ * @param	object_p		The BSL object.
+ * @param	password		The BSL_CORE_PASSWORD_SIZE bytes of the interrupt vector table.
+ * @return	0 on success, otherwise a bsl_error.
+ */
+int bsl_core_rx_password(bsl_object_t * object_p, const unsigned char * password)
+{
+	int error = 0;
+
+	error = bsl_core_command(object_p, 0x11, NULL, 0, password, BSL_CORE_PASSWORD_SIZE);
+
+	if (!error) {
+		error = bsl_core_read_response(object_p, NULL, 0);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Erase the flash segment containing an address.
+ * @param	object_p		The BSL object.
+ * @param	address			An address in the segment.
+ * @return	0 on success, otherwise a bsl_error.
+ */
+int bsl_core_erase_segment(bsl_object_t * object_p, unsigned long address)
+{
+	int error = 0;
+	unsigned char arguments[3];
+
+	error = bsl_core_check_range(address, 1, 1);
+
+	if (!error) {
+		bsl_core_put_address(arguments, address);
+		error = bsl_core_command(object_p, 0x12, arguments, sizeof(arguments), NULL, 0);
+	}
+
+	if (!error) {
+		error = bsl_core_read_response(object_p, NULL, 0);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Toggle the lock of information segment A.
+ * @param	object_p		The BSL object.
+ * @return	0 on success, otherwise a bsl_error.
+ */
+int bsl_core_toggle_info_lock(bsl_object_t * object_p)
+{
+	int error = 0;
+
+	error = bsl_core_command(object_p, 0x13, NULL, 0, NULL, 0);
+
+	if (!error) {
+		error = bsl_core_read_response(object_p, NULL, 0);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Erase the main memory.
+ * @param	object_p		The BSL object.
+ * @return	0 on success, otherwise a bsl_error.
+ */
+int bsl_core_mass_erase(bsl_object_t * object_p)
+{
+	int error = 0;
+
+	error = bsl_core_command(object_p, 0x15, NULL, 0, NULL, 0);
+
+	if (!error) {
+		error = bsl_core_read_response(object_p, NULL, 0);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Let the target compute the CRC16-CCITT of a memory range.
+ * @param	object_p		The BSL object.
+ * @param	address			Start address.
+ * @param	size			Size of the range, at most 0xFFFF bytes.
+ * @param	crc_p			Location to store the CRC, seeded with 0xFFFF as checksum_crc16_init() does.
+ * @return	0 on success, otherwise a bsl_error.
+ */
+int bsl_core_crc_check(bsl_object_t * object_p, unsigned long address, size_t size, unsigned short * crc_p)
+{
+	int error = 0;
+	unsigned char arguments[5];
+	unsigned char crc[2];
+
+	error = bsl_core_check_range(address, size, 0xFFFF);
+
+	if (!error) {
+		bsl_core_put_address(arguments, address);
+		arguments[3] = size % 256;
+		arguments[4] = size / 256;
+		error = bsl_core_command(object_p, 0x16, arguments, sizeof(arguments), NULL, 0);
+	}
+
+	if (!error) {
+		error = bsl_core_read_response(object_p, crc, sizeof(crc));
+	}
+
+	if (!error) {
+		*crc_p = crc[0] + crc[1] * 256;
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Start executing code, the BSL does not answer afterwards.
+ * @param	object_p		The BSL object.
+ * @param	address			Address to jump to.
+ * @return	0 on success, otherwise a bsl_error.
+ */
+int bsl_core_load_pc(bsl_object_t * object_p, unsigned long address)
+{
+	int error = 0;
+	unsigned char arguments[3];
+
+	error = bsl_core_check_range(address, 1, 1);
+
+	if (!error) {
+		bsl_core_put_address(arguments, address);
+		error = bsl_core_command(object_p, 0x17, arguments, sizeof(arguments), NULL, 0);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Read a block of memory.
+ * @param	object_p		The BSL object.
+ * @param	address			Start address.
+ * @param	data			Buffer for the data.
+ * @param	size			Size of the data, at most BSL_CORE_MAX_DATA_SIZE bytes.
+ * @return	0 on success, otherwise a bsl_error.
+ */
+int bsl_core_tx_data_block(bsl_object_t * object_p, unsigned long address, unsigned char * data, size_t size)
+{
+	int error = 0;
+	unsigned char arguments[5];
+
+	error = bsl_core_check_range(address, size, BSL_CORE_MAX_DATA_SIZE);
+
+	if (!error) {
+		bsl_core_put_address(arguments, address);
+		arguments[3] = size % 256;
+		arguments[4] = size / 256;
+		error = bsl_core_command(object_p, 0x18, arguments, sizeof(arguments), NULL, 0);
+	}
+
+	if (!error) {
+		// The data is received into the buffer of the caller.
+		error = bsl_core_read_response(object_p, data, size);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Read the version of the BSL.
+ * @param	object_p		The BSL object.
+ * @param	version			Location to store the vendor, command interpreter, API and
+ * 							peripheral interface versions, BSL_CORE_VERSION_SIZE bytes.
+ * @return	0 on success, otherwise a bsl_error.
+ */
+int bsl_core_tx_bsl_version(bsl_object_t * object_p, unsigned char * version)
+{
+	int error = 0;
+
+	error = bsl_core_command(object_p, 0x19, NULL, 0, NULL, 0);
+
+	if (!error) {
+		error = bsl_core_read_response(object_p, version, BSL_CORE_VERSION_SIZE);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Change the line rate of the BSL.
+ *
+ * The BSL switches after the acknowledge, the caller changes the rate of the
+ * transport once this returns.
+ *
+ * @param	object_p		The BSL object.
+ * @param	baudrate		The new line rate.
+ * @return	0 on success, otherwise a bsl_error.
+ */
+int bsl_core_change_baudrate(bsl_object_t * object_p, bsl_core_baudrate baudrate)
+{
+	int error = 0;
+	unsigned char argument = 0x02;
+
+	switch (baudrate)
+	{
+	case bsl_core_baudrate_9600:
+		argument = 0x02;
+		break;
+	case bsl_core_baudrate_19200:
+		argument = 0x03;
+		break;
+	case bsl_core_baudrate_38400:
+		argument = 0x04;
+		break;
+	case bsl_core_baudrate_57600:
+		argument = 0x05;
+		break;
+	case bsl_core_baudrate_115200:
+		argument = 0x06;
+		break;
+	}
+
+	error = bsl_core_command(object_p, 0x52, &argument, 1, NULL, 0);
+
+	if (!error) {
+		static const unsigned int rates[] = {9600, 19200, 38400, 57600, 115200};
+
+		object_p->timing.baudrate = rates[argument - 0x02];
+	}
+
+	return error;
+}
+
+static int bsl_core_command(bsl_object_t * object_p, unsigned char command, const unsigned char * arguments,
+		size_t argument_size, const unsigned char * payload, size_t payload_size)
+{
+	int error = 0;
+	size_t response_size;
+
+	error = bsl_core_write_packet(object_p, command, arguments, argument_size, payload, payload_size, &response_size);
+
+	if (!error) {
+		error = bsl_core_read_ack(object_p);
+	}
+
+	if (!error && (response_size == 1)) {
+		// The acknowledge completes the command.
+		bsl_sample_round_trip(object_p);
+	}
+
+	return error;
+}
+
+static int bsl_core_write_packet(bsl_object_t * object_p, unsigned char command, const unsigned char * arguments,
+		size_t argument_size, const unsigned char * payload, size_t payload_size, size_t * response_size_p)
+{
+	int error = 0;
+	unsigned char * header = object_p->request_header;
+	size_t length = 1 + argument_size + payload_size;
+	double operation_time;
+	checksum_crc16_t crc;
+	unsigned short checksum;
+	struct iovec vectors[3];
+
+	// Form the wrapper, the command and its arguments in place.
+	header[0] = BSL_CORE_HEADER;
+	header[1] = length % 256;
+	header[2] = length / 256;
+	header[3] = command;
+	if (argument_size > 0) {
+		memcpy(&header[BSL_CORE_WRAPPER_SIZE + 1], arguments, argument_size);
+	}
+
+	// The CRC covers the core command, not the wrapper.
+	checksum_crc16_init(&crc);
+	checksum_crc16_update(&crc, &header[BSL_CORE_WRAPPER_SIZE], 1 + argument_size);
+	checksum_crc16_update(&crc, payload, payload_size);
+	checksum = checksum_crc16_final(&crc);
+	object_p->request_checksum[0] = checksum % 256;
+	object_p->request_checksum[1] = checksum / 256;
+
+	// Wrapper, command, payload and CRC go out in a single write.
+	vectors[0].iov_base = header;
+	vectors[0].iov_len = BSL_CORE_WRAPPER_SIZE + 1 + argument_size;
+	vectors[1].iov_base = (void *) payload;
+	vectors[1].iov_len = payload_size;
+	vectors[2].iov_base = object_p->request_checksum;
+	vectors[2].iov_len = BSL_CHECKSUM_SIZE;
+
+	*response_size_p = bsl_core_estimate(command, arguments, payload_size, &operation_time);
+
+	object_p->statistics.commands++;
+	object_p->statistics.round_trips++;
+	bsl_start_deadline(object_p, BSL_CORE_WRAPPER_SIZE + length + BSL_CHECKSUM_SIZE, *response_size_p, operation_time);
+	if (transport_writev(object_p->transport_p, vectors, 3) != (int) (BSL_CORE_WRAPPER_SIZE + length + BSL_CHECKSUM_SIZE)) {
+		// Nothing will answer a packet that was not sent, do not wait for it.
+		error = bsl_error_failed;
+	}
+
+	return error;
+}
+
+static size_t bsl_core_estimate(unsigned char command, const unsigned char * arguments, size_t payload_size, double * operation_time_p)
+{
+	// An acknowledge, plus a message unless the command has a data response or none at all.
+	size_t response_size = 1 + BSL_CORE_WRAPPER_SIZE + 2 + BSL_CHECKSUM_SIZE;
+	double operation_time = 0;
+
+	switch (command)
+	{
+	case 0x10:
+		operation_time = ((payload_size + 1) / 2) * BSL_CORE_WORD_WRITE_TIME;
+		break;
+	case 0x1B:
+		operation_time = ((payload_size + 1) / 2) * BSL_CORE_WORD_WRITE_TIME;
+		response_size = 1;
+		break;
+	case 0x12:
+		operation_time = BSL_CORE_SEGMENT_ERASE_TIME;
+		break;
+	case 0x15:
+		operation_time = BSL_CORE_MASS_ERASE_TIME;
+		break;
+	case 0x16:
+		operation_time = (arguments[3] + arguments[4] * 256) * BSL_CORE_CRC_BYTE_TIME;
+		response_size = 1 + BSL_CORE_WRAPPER_SIZE + 1 + 2 + BSL_CHECKSUM_SIZE;
+		break;
+	case 0x17:
+	case 0x52:
+		response_size = 1;
+		break;
+	case 0x18:
+		response_size = 1 + BSL_CORE_WRAPPER_SIZE + 1 + arguments[3] + arguments[4] * 256 + BSL_CHECKSUM_SIZE;
+		break;
+	case 0x19:
+		response_size = 1 + BSL_CORE_WRAPPER_SIZE + 1 + BSL_CORE_VERSION_SIZE + BSL_CHECKSUM_SIZE;
+		break;
+	}
+
+	*operation_time_p = operation_time;
+
+	return response_size;
+}
+
+static int bsl_core_read_ack(bsl_object_t * object_p)
+{
+	int error = 0;
+	unsigned char data;
+	size_t read_size;
+
+	read_size = transport_read(object_p->transport_p, &data, 1, bsl_get_remaining_time(object_p));
+	if (read_size != 1) {
+		fprintf(stderr, "Could not read the acknowledge.\n");
+		error = bsl_error_timeout;
+	}
+	else if (data != BSL_CORE_ACK) {
+		switch (data)
+		{
+		case 0x51:
+			fprintf(stderr, "BSL reports an incorrect header.\n");
+			break;
+		case 0x52:
+			fprintf(stderr, "BSL reports an incorrect checksum.\n");
+			break;
+		case 0x53:
+			fprintf(stderr, "BSL reports a packet size of zero.\n");
+			break;
+		case 0x54:
+			fprintf(stderr, "BSL reports a packet size exceeding the buffer.\n");
+			break;
+		case 0x56:
+			fprintf(stderr, "BSL reports an unknown baud rate.\n");
+			break;
+		default:
+			fprintf(stderr, "Incorrect acknowledge, received: 0x%02x.\n", data);
+			break;
+		}
+		error = bsl_error_nak;
+	}
+
+	return error;
+}
+
+static int bsl_core_read_response(bsl_object_t * object_p, unsigned char * data, size_t size)
+{
+	int error = 0;
+	unsigned char * header = object_p->response_header;
+	unsigned char * checksum_data = &(object_p->response_header[BSL_RESPONSE_HEADER_SIZE]);
+	unsigned char message = 0;
+	unsigned char * body = NULL;
+	size_t body_size = 0;
+	size_t length = 0;
+	size_t read_size;
+
+	// Read the wrapper and the response type.
+	read_size = transport_read(object_p->transport_p, header, BSL_RESPONSE_HEADER_SIZE, bsl_get_remaining_time(object_p));
+	if (read_size != BSL_RESPONSE_HEADER_SIZE) {
+		fprintf(stderr, "Could not read the response.\n");
+		error = bsl_error_timeout;
+	}
+	else if (header[0] != BSL_CORE_HEADER) {
+		fprintf(stderr, "Incorrect header, received header: 0x%02x.\n", header[0]);
+		error = bsl_error_header;
+	}
+	else {
+		length = header[1] + header[2] * 256;
+	}
+
+	if (!error) {
+		if ((header[3] == BSL_CORE_DATA_RESPONSE) && (size > 0) && (length == 1 + size)) {
+			// The data is read straight into the buffer of the caller.
+			body = data;
+			body_size = size;
+		}
+		else if ((header[3] == BSL_CORE_MESSAGE_RESPONSE) && (length == 2)) {
+			body = &message;
+			body_size = 1;
+		}
+		else {
+			fprintf(stderr, "Unexpected response 0x%02x of length %zu.\n", header[3], length);
+			error = bsl_error_length;
+		}
+	}
+
+	if (!error) {
+		read_size = transport_read(object_p->transport_p, body, body_size, bsl_get_remaining_time(object_p));
+		if (read_size == body_size) {
+			read_size += transport_read(object_p->transport_p, checksum_data, BSL_CHECKSUM_SIZE, bsl_get_remaining_time(object_p));
+		}
+
+		if (read_size != body_size + BSL_CHECKSUM_SIZE) {
+			fprintf(stderr, "Could not read the response.\n");
+			error = bsl_error_timeout;
+		}
+	}
+
+	if (!error) {
+		unsigned short checksum;
+
+		checksum = checksum_crc16(0xFFFF, &header[3], 1);
+		checksum = checksum_crc16(checksum, body, body_size);
+		if (((checksum % 256) != checksum_data[0]) || ((checksum / 256) != checksum_data[1])) {
+			fprintf(stderr, "Incorrect checksum.\n");
+			error = bsl_error_checksum;
+		}
+	}
+
+	if (!error) {
+		bsl_sample_round_trip(object_p);
+	}
+
+	if (!error && (body == &message)) {
+		switch (message)
+		{
+		case 0x00:
+			if (size > 0) {
+				fprintf(stderr, "Expected data, received a message.\n");
+				error = 1;
+			}
+			break;
+		case 0x01:
+			fprintf(stderr, "Flash write check failed.\n");
+			error = 1;
+			break;
+		case 0x02:
+			fprintf(stderr, "Flash fail bit set.\n");
+			error = 1;
+			break;
+		case 0x03:
+			fprintf(stderr, "Voltage change during program.\n");
+			error = 1;
+			break;
+		case 0x04:
+			fprintf(stderr, "BSL locked.\n");
+			error = 1;
+			break;
+		case 0x05:
+			fprintf(stderr, "BSL password error.\n");
+			error = 1;
+			break;
+		case 0x06:
+			fprintf(stderr, "Byte write forbidden.\n");
+			error = 1;
+			break;
+		case 0x07:
+			fprintf(stderr, "Unknown command.\n");
+			error = 1;
+			break;
+		case 0x08:
+			fprintf(stderr, "Packet length exceeds buffer size.\n");
+			error = 1;
+			break;
+		default:
+			fprintf(stderr, "Unknown message 0x%02x.\n", message);
+			error = 1;
+			break;
+		}
+	}
+
+	return error;
+}
+
+static int bsl_core_check_range(unsigned long address, size_t size, size_t max_size)
+{
+	int error = 0;
+
+	if ((size == 0) || (size > max_size)) {
+		fprintf(stderr, "Size should be more than 0 and at most %zu.\n", max_size);
+		error = 1;
+	}
+	else if ((address > BSL_CORE_MAX_ADDRESS) || (size - 1 > BSL_CORE_MAX_ADDRESS - address)) {
+		fprintf(stderr, "Address range should be within 24 bits.\n");
+		error = 1;
+	}
+
+	return error;
+}
+
+static void bsl_core_put_address(unsigned char * arguments, unsigned long address)
+{
+	arguments[0] = address % 256;
+	arguments[1] = (address / 256) % 256;
+	arguments[2] = (address / 65536) % 256;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,57 @@
+/**
+ * @file	bsl_core.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the 5xx/6xx/FRxx core command BSL protocol.
+ */
+
+#ifndef BSL_CORE_H_
+#define BSL_CORE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bsl.h"
+
+/**
+ * @addtogroup bsl_core
+ * @{
+ */
+
+#define BSL_CORE_MAX_DATA_SIZE	(256)
+#define BSL_CORE_MAX_ADDRESS	(0xFFFFFF)
+#define BSL_CORE_PASSWORD_SIZE	(32)
+#define BSL_CORE_VERSION_SIZE	(4)
+
+/**
+ * @brief Line rates of the UART peripheral interface.
+ */
+typedef enum
+{
+	bsl_core_baudrate_9600,		/**< 9600 baud.		*/
+	bsl_core_baudrate_19200,	/**< 19200 baud.	*/
+	bsl_core_baudrate_38400,	/**< 38400 baud.	*/
+	bsl_core_baudrate_57600,	/**< 57600 baud.	*/
+	bsl_core_baudrate_115200	/**< 115200 baud.	*/
+} bsl_core_baudrate;
+
+bool bsl_core_detect(bsl_object_t * object_p, unsigned char * version);
+
+int bsl_core_rx_data_block(bsl_object_t * object_p, unsigned long address, const unsigned char * data, size_t size);
+int bsl_core_rx_data_block_fast(bsl_object_t * object_p, unsigned long address, const unsigned char * data, size_t size);
+int bsl_core_rx_password(bsl_object_t * object_p, const unsigned char * password);
+int bsl_core_erase_segment(bsl_object_t * object_p, unsigned long address);
+int bsl_core_toggle_info_lock(bsl_object_t * object_p);
+int bsl_core_mass_erase(bsl_object_t * object_p);
+int bsl_core_crc_check(bsl_object_t * object_p, unsigned long address, size_t size, unsigned short * crc_p);
+int bsl_core_load_pc(bsl_object_t * object_p, unsigned long address);
+int bsl_core_tx_data_block(bsl_object_t * object_p, unsigned long address, unsigned char * data, size_t size);
+int bsl_core_tx_bsl_version(bsl_object_t * object_p, unsigned char * version);
+int bsl_core_change_baudrate(bsl_object_t * object_p, bsl_core_baudrate baudrate);
+
+/**
+ * @}
+ */
+
+#endif /* BSL_CORE_H_ */
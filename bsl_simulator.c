@@ -0,0 +1,996 @@
+/**
+ * @file	bsl_simulator.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the MSP430 BSL device simulator.
+ *
+ * Models a 1xx/2xx/4xx device running the ROM BSL: the synchronization
+ * handshake, the command set used by bsl.c, a 64 KB address space with flash
+ * semantics (writes can only clear bits, erases set whole segments to 0xFF),
+ * UART character times and flash write/erase times, and optional error
+ * injection. A synchronization character that arrives on its own while a
+ * frame is expected is answered again, since the host synchronizes before
+ * every command. The simulator is a pure byte-in/byte-out model; the delay it
+ * reports is applied by whoever drives it (a pseudo-terminal, the loopback
+ * transport or a virtual clock).
+ *
+ * With the core protocol it models a 5xx/6xx device running the flash BSL
+ * instead: 0x80/length/CRC16 packets with 24-bit addresses, acknowledged with
+ * a single byte, and the core commands used by bsl_core.c.
+ *
+ * A ROM BSL load PC runs the program it points to on a small interpreter of
+ * the word-sized MSP430 two-operand and jump instructions, enough for helper
+ * routines in RAM. A program that jumps back to the BSL warm start leaves the
+ * BSL waiting for a synchronization again, characters that arrive while it
+ * runs are lost.
+ *
+ * @see		http://www.ti.com/lit/ug/slau319i/slau319i.pdf
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bsl_simulator.h"
+#include "checksum.h"
+#include "serial.h"
+
+/**
+ * @defgroup bsl_simulator BSL Simulator
+ * @brief Simulated MSP430 bootstrap loader.
+ * @{
+ */
+
+#define BSL_SIMULATOR_SYNC			(0x80)
+#define BSL_SIMULATOR_HEADER		(0x80)
+#define BSL_SIMULATOR_DATA_ACK		(0x90)
+#define BSL_SIMULATOR_DATA_NAK		(0xA0)
+#define BSL_SIMULATOR_CHIP_ID		(0x0FF0)
+#define BSL_SIMULATOR_BSL_VERSION	(0x0FFA)
+#define BSL_SIMULATOR_VECTORS		(0xFFE0)
+#define BSL_SIMULATOR_PASSWORD_SIZE	(32)
+#define BSL_SIMULATOR_CORE_CHIP_ID	(0x1A04)
+#define BSL_SIMULATOR_CORE_ACK		(0x00)
+#define BSL_SIMULATOR_CORE_MAX_SIZE	(260)
+#define BSL_SIMULATOR_CORE_DATA		(0x3A)
+#define BSL_SIMULATOR_CORE_MESSAGE	(0x3B)
+#define BSL_SIMULATOR_WARM_START	(0x0C02)
+#define BSL_SIMULATOR_MAX_STEPS		(1000000)
+
+static void bsl_simulator_peer_receive(void * peer_p, transport_t * transport_p, const unsigned char * data, size_t size);
+static void bsl_simulator_peer_set_lines(void * peer_p, transport_t * transport_p, unsigned int lines);
+static size_t bsl_simulator_process_frame(bsl_simulator_t * simulator_p, unsigned char * response, double * delay_p);
+static size_t bsl_simulator_data_response(const unsigned char * data, size_t size, unsigned char * response);
+static size_t bsl_simulator_receive_core(bsl_simulator_t * simulator_p, unsigned char data, unsigned char * response, double * delay_p);
+static size_t bsl_simulator_process_core_packet(bsl_simulator_t * simulator_p, unsigned char * response, double * delay_p);
+static size_t bsl_simulator_core_response(unsigned char type, const unsigned char * data, size_t size, unsigned char * response);
+static void bsl_simulator_write(bsl_simulator_t * simulator_p, unsigned int address, const unsigned char * data, size_t size, double * delay_p);
+static void bsl_simulator_erase(bsl_simulator_t * simulator_p, unsigned int address, bool segment, double * delay_p);
+static bool bsl_simulator_is_flash(const bsl_simulator_t * simulator_p, unsigned int address);
+static bool bsl_simulator_is_ram(const bsl_simulator_t * simulator_p, unsigned int address);
+static bool bsl_simulator_execute(bsl_simulator_t * simulator_p, unsigned int address, unsigned long * cycles_p);
+static unsigned int bsl_simulator_read_word(const bsl_simulator_t * simulator_p, unsigned int address);
+static unsigned int bsl_simulator_get_flags(unsigned int result, bool carry, bool overflow);
+static unsigned short bsl_simulator_checksum(const unsigned char * data, size_t size);
+static double bsl_simulator_random(bsl_simulator_t * simulator_p);
+
+/**
+ * @brief Loopback transport peer running a simulator, the peer pointer is the bsl_simulator_t.
+ */
+const transport_loopback_peer_t bsl_simulator_peer =
+{
+	bsl_simulator_peer_receive,
+	bsl_simulator_peer_set_lines,
+	NULL
+};
+
+/**
+ * @brief	Get the settings of a typical device (an MSP430F2274) on a clean link.
+ * @param	settings_p		Location to store the settings.
+ * @return	None.
+ */
+void bsl_simulator_get_default_settings(bsl_simulator_settings_t * settings_p)
+{
+	settings_p->protocol = bsl_simulator_protocol_legacy;
+	settings_p->chip_id = 0xF227;
+	settings_p->bsl_version = 0x0213;
+	settings_p->ram_start = 0x0200;
+	settings_p->ram_size = 0x0400;
+	settings_p->info_start = 0x1000;
+	settings_p->info_size = 0x0100;
+	settings_p->info_segment_size = 64;
+	settings_p->main_start = 0x8000;
+	settings_p->main_end = 0x10000;
+	settings_p->main_segment_size = 512;
+	settings_p->baudrate = 9600;
+	settings_p->bits_per_byte = 11;
+	settings_p->word_write_time = 75e-6;
+	settings_p->segment_erase_time = 15e-3;
+	settings_p->mass_erase_time = 30e-3;
+	settings_p->cpu_frequency = 1e6;
+	settings_p->nak_rate = 0;
+	settings_p->drop_rate = 0;
+	settings_p->corrupt_rate = 0;
+	settings_p->max_baudrate = 0;
+	settings_p->seed = 1;
+}
+
+/**
+ * @brief	Get the settings of a typical core command device (an MSP430F5529) on a clean link.
+ * @param	settings_p		Location to store the settings.
+ * @return	None.
+ */
+void bsl_simulator_get_core_settings(bsl_simulator_settings_t * settings_p)
+{
+	bsl_simulator_get_default_settings(settings_p);
+
+	settings_p->protocol = bsl_simulator_protocol_core;
+	settings_p->chip_id = 0x5529;
+	settings_p->bsl_version = 0x00060434;
+	settings_p->ram_start = 0x2400;
+	settings_p->ram_size = 0x2000;
+	settings_p->info_start = 0x1800;
+	settings_p->info_size = 0x0200;
+	settings_p->info_segment_size = 128;
+	settings_p->main_start = 0x4400;
+	settings_p->main_end = 0x24400;
+	settings_p->main_segment_size = 512;
+	settings_p->word_write_time = 64e-6;
+	settings_p->segment_erase_time = 23e-3;
+	settings_p->mass_erase_time = 32e-3;
+}
+
+/**
+ * @brief	Construct a simulator with erased flash, running the BSL.
+ * @param	settings_p		Device and link properties.
+ * @return	The simulator object, or NULL on error.
+ */
+bsl_simulator_t * bsl_simulator_construct(const bsl_simulator_settings_t * settings_p)
+{
+	bsl_simulator_t * simulator_p;
+
+	// Allocate memory for the simulator object.
+	simulator_p = malloc(sizeof(bsl_simulator_t));
+
+	if (simulator_p == NULL) {
+		// Could not allocate memory.
+		fprintf(stderr, "Failed to allocate memory for the BSL simulator object.\n");
+	}
+	else {
+		memset(simulator_p, 0, sizeof(bsl_simulator_t));
+		simulator_p->settings = *settings_p;
+		simulator_p->random = (settings_p->seed != 0) ? settings_p->seed : 1;
+
+		// Unprogrammed flash and ROM contents.
+		memset(&(simulator_p->memory[settings_p->info_start]), 0xFF, settings_p->info_size);
+		memset(&(simulator_p->memory[settings_p->main_start]), 0xFF, settings_p->main_end - settings_p->main_start);
+		if (settings_p->protocol == bsl_simulator_protocol_core) {
+			// The device ID in the TLV structure, the BSL version is reported by a command.
+			simulator_p->memory[BSL_SIMULATOR_CORE_CHIP_ID] = settings_p->chip_id / 256;
+			simulator_p->memory[BSL_SIMULATOR_CORE_CHIP_ID + 1] = settings_p->chip_id % 256;
+		}
+		else {
+			simulator_p->memory[BSL_SIMULATOR_CHIP_ID] = settings_p->chip_id / 256;
+			simulator_p->memory[BSL_SIMULATOR_CHIP_ID + 1] = settings_p->chip_id % 256;
+			simulator_p->memory[BSL_SIMULATOR_BSL_VERSION] = (settings_p->bsl_version / 256) % 256;
+			simulator_p->memory[BSL_SIMULATOR_BSL_VERSION + 1] = settings_p->bsl_version % 256;
+		}
+
+		bsl_simulator_reset(simulator_p, true);
+	}
+
+	return simulator_p;
+}
+
+/**
+ * @brief	Destroy a simulator.
+ * @param	simulator_p		The simulator object.
+ * @return	None.
+ */
+void bsl_simulator_destroy(bsl_simulator_t * simulator_p)
+{
+	free(simulator_p);
+}
+
+/**
+ * @brief	Reset the simulated device.
+ * @param	simulator_p		The simulator object.
+ * @param	enter_bsl		TRUE = start the BSL, FALSE = start the application.
+ * @return	None.
+ */
+void bsl_simulator_reset(bsl_simulator_t * simulator_p, bool enter_bsl)
+{
+	if (!enter_bsl) {
+		simulator_p->state = bsl_simulator_running;
+	}
+	else if (simulator_p->settings.protocol == bsl_simulator_protocol_core) {
+		// The core command BSL has no synchronization, it waits for a packet right away.
+		simulator_p->state = bsl_simulator_wait_frame;
+	}
+	else {
+		simulator_p->state = bsl_simulator_wait_sync;
+	}
+	simulator_p->locked = true;
+	simulator_p->baudrate = simulator_p->settings.baudrate;
+	simulator_p->mem_offset = 0;
+	simulator_p->frame_size = 0;
+	simulator_p->busy_until = 0;
+}
+
+/**
+ * @brief	Apply new modem line levels.
+ *
+ * Assumes the standard wiring: DTR drives ~RST and RTS drives TEST, both
+ * inverted. Releasing ~RST while TEST is high starts the BSL, releasing it
+ * while TEST is low starts the application.
+ *
+ * @param	simulator_p		The simulator object.
+ * @param	lines			Asserted SERIAL_LINE_* lines.
+ * @return	None.
+ */
+void bsl_simulator_set_lines(bsl_simulator_t * simulator_p, unsigned int lines)
+{
+	bool reset_released = (simulator_p->lines & SERIAL_LINE_DTR) && !(lines & SERIAL_LINE_DTR);
+	bool test_high = !(lines & SERIAL_LINE_RTS);
+
+	if (lines & SERIAL_LINE_DTR) {
+		// Held in reset.
+		simulator_p->state = bsl_simulator_running;
+	}
+	else if (reset_released) {
+		bsl_simulator_reset(simulator_p, test_high);
+	}
+
+	simulator_p->lines = lines;
+}
+
+/**
+ * @brief	Feed bytes from the host to the simulator.
+ * @param	simulator_p		The simulator object.
+ * @param	data			Bytes sent by the host.
+ * @param	size			Number of bytes.
+ * @param	response		Buffer for the bytes the device sends back.
+ * @param	response_size	Size of the response buffer, at least BSL_SIMULATOR_FRAME_SIZE.
+ * @param	delay_p			Location to store the time from the start of the data to the end of the response.
+ * @return	Number of response bytes.
+ */
+size_t bsl_simulator_receive(bsl_simulator_t * simulator_p, const unsigned char * data, size_t size,
+		unsigned char * response, size_t response_size, double * delay_p)
+{
+	size_t response_length = 0;
+	double delay = 0;
+	size_t i;
+	size_t j;
+
+	simulator_p->statistics.bytes_received += size;
+
+	for (i = 0; i < size; i++) {
+		double byte_time = (double) simulator_p->settings.bits_per_byte / simulator_p->baudrate;
+		unsigned int baudrate = simulator_p->baudrate;
+		size_t length = 0;
+		unsigned char * output = &(response[response_length]);
+
+		// Receiving the character takes one character time.
+		delay += byte_time;
+
+		if (response_size - response_length < BSL_SIMULATOR_FRAME_SIZE) {
+			fprintf(stderr, "BSL simulator response buffer too small.\n");
+			break;
+		}
+
+		switch (simulator_p->state)
+		{
+		case bsl_simulator_running:
+			break;
+		case bsl_simulator_wait_sync:
+			if (data[i] == BSL_SIMULATOR_SYNC) {
+				output[length++] = BSL_SIMULATOR_DATA_ACK;
+				simulator_p->statistics.syncs++;
+				simulator_p->state = bsl_simulator_wait_frame;
+				simulator_p->frame_size = 0;
+			}
+			break;
+		case bsl_simulator_wait_frame:
+			if (simulator_p->settings.protocol == bsl_simulator_protocol_core) {
+				length = bsl_simulator_receive_core(simulator_p, data[i], output, &delay);
+				break;
+			}
+
+			simulator_p->frame[simulator_p->frame_size++] = data[i];
+
+			if ((simulator_p->frame_size == 1) && (data[i] == BSL_SIMULATOR_SYNC) && (i == size - 1)) {
+				// A lone character while a frame is expected is a repeated synchronization.
+				output[length++] = BSL_SIMULATOR_DATA_ACK;
+				simulator_p->statistics.syncs++;
+				simulator_p->frame_size = 0;
+			}
+			else if ((simulator_p->frame_size == 1) && (data[i] != BSL_SIMULATOR_HEADER)) {
+				// Not a frame, wait for the next synchronization.
+				output[length++] = BSL_SIMULATOR_DATA_NAK;
+				simulator_p->statistics.naks++;
+				simulator_p->state = bsl_simulator_wait_sync;
+			}
+			else if ((simulator_p->frame_size >= 4) && (simulator_p->frame_size == 4u + simulator_p->frame[2] + 2u)) {
+				simulator_p->statistics.commands++;
+				simulator_p->state = bsl_simulator_wait_sync;
+				length = bsl_simulator_process_frame(simulator_p, output, &delay);
+			}
+			break;
+		}
+
+		// Inject errors in the response, every character is garbled above the rate the link sustains.
+		for (j = 0; j < length; j++) {
+			if ((simulator_p->settings.max_baudrate != 0) && (baudrate > simulator_p->settings.max_baudrate)) {
+				output[j] ^= 0x5A;
+				simulator_p->statistics.corrupted++;
+			}
+			else if (bsl_simulator_random(simulator_p) < simulator_p->settings.drop_rate) {
+				memmove(&(output[j]), &(output[j + 1]), length - j - 1);
+				length--;
+				j--;
+				simulator_p->statistics.dropped++;
+			}
+			else if (bsl_simulator_random(simulator_p) < simulator_p->settings.corrupt_rate) {
+				output[j] ^= 1 << (unsigned int) (bsl_simulator_random(simulator_p) * 8);
+				simulator_p->statistics.corrupted++;
+			}
+		}
+
+		// The response goes out at the rate in effect when it was generated.
+		delay += length * (double) simulator_p->settings.bits_per_byte / baudrate;
+		response_length += length;
+	}
+
+	simulator_p->statistics.bytes_sent += response_length;
+	simulator_p->statistics.elapsed += delay;
+	*delay_p = delay;
+
+	return response_length;
+}
+
+static void bsl_simulator_peer_receive(void * peer_p, transport_t * transport_p, const unsigned char * data, size_t size)
+{
+	bsl_simulator_t * simulator_p = peer_p;
+	unsigned char response[2 * BSL_SIMULATOR_FRAME_SIZE];
+	size_t response_length;
+	double delay;
+	double total_delay = 0;
+	double now = transport_get_time(transport_p);
+
+	if (now < simulator_p->busy_until) {
+		// The CPU runs a program, nothing listens to the UART.
+		return;
+	}
+
+	// Feed the data in pieces that fit the response buffer.
+	while (size > 0) {
+		size_t chunk_size = (size > BSL_SIMULATOR_FRAME_SIZE) ? BSL_SIMULATOR_FRAME_SIZE : size;
+
+		response_length = bsl_simulator_receive(simulator_p, data, chunk_size, response, sizeof(response), &delay);
+		total_delay += delay;
+		transport_loopback_respond(transport_p, response, response_length, total_delay);
+		data += chunk_size;
+		size -= chunk_size;
+	}
+
+	if (simulator_p->run_time > 0) {
+		// A program started after the acknowledge, the BSL is back when it ends.
+		simulator_p->busy_until = now + total_delay + simulator_p->run_time;
+		simulator_p->run_time = 0;
+	}
+}
+
+static void bsl_simulator_peer_set_lines(void * peer_p, transport_t * transport_p, unsigned int lines)
+{
+	(void) transport_p;
+
+	bsl_simulator_set_lines(peer_p, lines);
+}
+
+static size_t bsl_simulator_process_frame(bsl_simulator_t * simulator_p, unsigned char * response, double * delay_p)
+{
+	const unsigned char * frame = simulator_p->frame;
+	size_t frame_size = simulator_p->frame_size;
+	unsigned int address = frame[4] + frame[5] * 256;
+	unsigned int length = frame[6] + frame[7] * 256;
+	unsigned short checksum = bsl_simulator_checksum(frame, frame_size - 2);
+	bool ack = true;
+	size_t response_length = 0;
+	unsigned long cycles;
+	unsigned int i;
+
+	if ((frame[2] != frame[3]) ||
+		((checksum % 256) != frame[frame_size - 2]) || ((checksum / 256) != frame[frame_size - 1]))
+	{
+		// Malformed frame.
+		ack = false;
+	}
+	else if (bsl_simulator_random(simulator_p) < simulator_p->settings.nak_rate) {
+		// Injected NAK, the command is not executed.
+		ack = false;
+	}
+	else if (simulator_p->locked && (frame[1] != 0x10) && (frame[1] != 0x18)) {
+		// Only the password and mass erase commands are unprotected.
+		ack = false;
+	}
+	else {
+		switch (frame[1])
+		{
+		case 0x10:
+			// RX password, compared with the interrupt vectors.
+			ack = (frame[2] == 4 + BSL_SIMULATOR_PASSWORD_SIZE) &&
+					(memcmp(&frame[8], &(simulator_p->memory[BSL_SIMULATOR_VECTORS]), BSL_SIMULATOR_PASSWORD_SIZE) == 0);
+			if (ack) {
+				simulator_p->locked = false;
+			}
+			break;
+		case 0x12:
+			// RX data block.
+			bsl_simulator_write(simulator_p, address, &frame[8], frame[2] - 4, delay_p);
+			break;
+		case 0x14:
+			// TX data block, answered with a data frame.
+			if ((length == 0) || (length > 250) || (address + length > BSL_SIMULATOR_MEMORY_SIZE)) {
+				ack = false;
+			}
+			else {
+				response_length = bsl_simulator_data_response(&(simulator_p->memory[address]), length, response);
+			}
+			break;
+		case 0x16:
+			// Erase segment or erase main/info.
+			if ((frame[7] != 0xA5) || ((frame[6] != 0x02) && (frame[6] != 0x04))) {
+				ack = false;
+			}
+			else {
+				bsl_simulator_erase(simulator_p, address, frame[6] == 0x02, delay_p);
+			}
+			break;
+		case 0x18:
+			// Mass erase.
+			memset(&(simulator_p->memory[simulator_p->settings.info_start]), 0xFF, simulator_p->settings.info_size);
+			memset(&(simulator_p->memory[simulator_p->settings.main_start]), 0xFF,
+					simulator_p->settings.main_end - simulator_p->settings.main_start);
+			*delay_p += simulator_p->settings.mass_erase_time;
+			break;
+		case 0x1C:
+			// Erase check, a NAK if any byte of the range is not 0xFF.
+			if ((length == 0) || (address + length > BSL_SIMULATOR_MEMORY_SIZE)) {
+				ack = false;
+			}
+			else {
+				for (i = 0; (i < length) && ack; i++) {
+					ack = (simulator_p->memory[address + i] == 0xFF);
+				}
+			}
+			break;
+		case 0x1A:
+			// Load PC, the program takes over after the acknowledge. One that returns leaves the BSL locked at 9600 baud.
+			if (bsl_simulator_execute(simulator_p, address, &cycles)) {
+				bsl_simulator_reset(simulator_p, true);
+				simulator_p->run_time = cycles / simulator_p->settings.cpu_frequency;
+			}
+			else {
+				simulator_p->state = bsl_simulator_running;
+			}
+			break;
+		case 0x20:
+			// Change baudrate, takes effect after the acknowledge.
+			break;
+		case 0x21:
+			// Set memory offset.
+			simulator_p->mem_offset = length;
+			break;
+		default:
+			ack = false;
+			break;
+		}
+	}
+
+	if (!ack) {
+		response[response_length++] = BSL_SIMULATOR_DATA_NAK;
+		simulator_p->statistics.naks++;
+	}
+	else if (response_length == 0) {
+		response[response_length++] = BSL_SIMULATOR_DATA_ACK;
+
+		if (frame[1] == 0x20) {
+			static const unsigned int baudrates[] = {9600, 19200, 38400};
+
+			if (frame[6] < sizeof(baudrates) / sizeof(baudrates[0])) {
+				// The acknowledge still goes out at the old rate, the caller accounts for that.
+				simulator_p->baudrate = baudrates[frame[6]];
+			}
+		}
+	}
+
+	return response_length;
+}
+
+static size_t bsl_simulator_data_response(const unsigned char * data, size_t size, unsigned char * response)
+{
+	unsigned short checksum;
+
+	response[0] = BSL_SIMULATOR_HEADER;
+	response[1] = 0x00;
+	response[2] = (unsigned char) size;
+	response[3] = (unsigned char) size;
+	memcpy(&response[4], data, size);
+
+	checksum = bsl_simulator_checksum(response, 4 + size);
+	response[4 + size] = checksum % 256;
+	response[4 + size + 1] = checksum / 256;
+
+	return 4 + size + 2;
+}
+
+static size_t bsl_simulator_receive_core(bsl_simulator_t * simulator_p, unsigned char data, unsigned char * response, double * delay_p)
+{
+	unsigned char * frame = simulator_p->frame;
+	size_t length = 0;
+	size_t packet_size;
+
+	frame[simulator_p->frame_size++] = data;
+	packet_size = (simulator_p->frame_size >= 3) ? frame[1] + frame[2] * 256u : 0;
+
+	if ((simulator_p->frame_size == 1) && (data != BSL_SIMULATOR_HEADER)) {
+		// Header incorrect.
+		response[length++] = 0x51;
+	}
+	else if ((simulator_p->frame_size == 3) && (packet_size == 0)) {
+		// Packet size zero.
+		response[length++] = 0x53;
+	}
+	else if ((simulator_p->frame_size == 3) && (packet_size > BSL_SIMULATOR_CORE_MAX_SIZE)) {
+		// Packet size exceeds the buffer.
+		response[length++] = 0x54;
+	}
+	else if ((simulator_p->frame_size > 3) && (simulator_p->frame_size == 3 + packet_size + 2)) {
+		simulator_p->statistics.commands++;
+		length = bsl_simulator_process_core_packet(simulator_p, response, delay_p);
+		simulator_p->frame_size = 0;
+	}
+
+	if ((length > 0) && (response[0] != BSL_SIMULATOR_CORE_ACK)) {
+		// Start over with the next packet.
+		simulator_p->statistics.naks++;
+		simulator_p->frame_size = 0;
+	}
+
+	return length;
+}
+
+static size_t bsl_simulator_process_core_packet(bsl_simulator_t * simulator_p, unsigned char * response, double * delay_p)
+{
+	const unsigned char * frame = simulator_p->frame;
+	const unsigned char * core = &frame[3];
+	size_t core_size = frame[1] + frame[2] * 256;
+	unsigned int address = (core_size >= 4) ? core[1] + core[2] * 256u + core[3] * 65536u : 0;
+	unsigned int length = (core_size >= 6) ? core[4] + core[5] * 256u : 0;
+	unsigned short crc = checksum_crc16(0xFFFF, core, core_size);
+	unsigned char data[BSL_SIMULATOR_CORE_MAX_SIZE];
+	int message = 0x00;
+	size_t response_length = 0;
+
+	if (((crc % 256) != core[core_size]) || ((crc / 256) != core[core_size + 1])) {
+		// Checksum incorrect, the command is not executed.
+		response[response_length++] = 0x52;
+		return response_length;
+	}
+	else if (bsl_simulator_random(simulator_p) < simulator_p->settings.nak_rate) {
+		// Injected checksum error.
+		response[response_length++] = 0x52;
+		return response_length;
+	}
+
+	response[response_length++] = BSL_SIMULATOR_CORE_ACK;
+
+	if (simulator_p->locked && (core[0] != 0x11) && (core[0] != 0x15) && (core[0] != 0x19) && (core[0] != 0x52)) {
+		// Only the password, mass erase, version and baud rate commands are unprotected.
+		message = 0x04;
+	}
+	else if (((core[0] == 0x10) || (core[0] == 0x1B) || (core[0] == 0x12) || (core[0] == 0x17)) && (core_size < 4)) {
+		message = 0x08;
+	}
+	else if (((core[0] == 0x16) || (core[0] == 0x18)) && (core_size != 6)) {
+		message = 0x08;
+	}
+	else {
+		switch (core[0])
+		{
+		case 0x10:
+			// RX data block.
+			bsl_simulator_write(simulator_p, address, &core[4], core_size - 4, delay_p);
+			break;
+		case 0x1B:
+			// RX data block fast, only acknowledged.
+			bsl_simulator_write(simulator_p, address, &core[4], core_size - 4, delay_p);
+			message = -1;
+			break;
+		case 0x11:
+			// RX password, compared with the interrupt vectors.
+			if ((core_size == 1 + BSL_SIMULATOR_PASSWORD_SIZE) &&
+					(memcmp(&core[1], &(simulator_p->memory[BSL_SIMULATOR_VECTORS]), BSL_SIMULATOR_PASSWORD_SIZE) == 0)) {
+				simulator_p->locked = false;
+			}
+			else {
+				message = 0x05;
+			}
+			break;
+		case 0x12:
+			// Erase segment.
+			bsl_simulator_erase(simulator_p, address, true, delay_p);
+			break;
+		case 0x13:
+			// Toggle the information memory lock, not modelled.
+			break;
+		case 0x15:
+			// Mass erase, the main memory only.
+			memset(&(simulator_p->memory[simulator_p->settings.main_start]), 0xFF,
+					simulator_p->settings.main_end - simulator_p->settings.main_start);
+			*delay_p += simulator_p->settings.mass_erase_time;
+			break;
+		case 0x16:
+			// CRC check, answered with the CRC of the range.
+			if ((length == 0) || (address + length > BSL_SIMULATOR_MEMORY_SIZE)) {
+				message = 0x08;
+			}
+			else {
+				crc = checksum_crc16(0xFFFF, &(simulator_p->memory[address]), length);
+				data[0] = crc % 256;
+				data[1] = crc / 256;
+				response_length += bsl_simulator_core_response(BSL_SIMULATOR_CORE_DATA, data, 2, &response[response_length]);
+				message = -1;
+			}
+			break;
+		case 0x17:
+			// Load PC, the application takes over after the acknowledge.
+			simulator_p->state = bsl_simulator_running;
+			message = -1;
+			break;
+		case 0x18:
+			// TX data block, answered with the data.
+			if ((length == 0) || (length > BSL_SIMULATOR_CORE_MAX_SIZE - 4) || (address + length > BSL_SIMULATOR_MEMORY_SIZE)) {
+				message = 0x08;
+			}
+			else {
+				response_length += bsl_simulator_core_response(BSL_SIMULATOR_CORE_DATA, &(simulator_p->memory[address]), length,
+						&response[response_length]);
+				message = -1;
+			}
+			break;
+		case 0x19:
+			// TX BSL version.
+			data[0] = (simulator_p->settings.bsl_version >> 24) % 256;
+			data[1] = (simulator_p->settings.bsl_version >> 16) % 256;
+			data[2] = (simulator_p->settings.bsl_version >> 8) % 256;
+			data[3] = simulator_p->settings.bsl_version % 256;
+			response_length += bsl_simulator_core_response(BSL_SIMULATOR_CORE_DATA, data, 4, &response[response_length]);
+			message = -1;
+			break;
+		case 0x52:
+			// Change baud rate, only acknowledged and takes effect after that.
+			if ((core_size != 2) || (core[1] < 0x02) || (core[1] > 0x06)) {
+				response[0] = 0x56;
+			}
+			else {
+				static const unsigned int baudrates[] = {9600, 19200, 38400, 57600, 115200};
+
+				// The acknowledge still goes out at the old rate, the caller accounts for that.
+				simulator_p->baudrate = baudrates[core[1] - 0x02];
+			}
+			message = -1;
+			break;
+		default:
+			message = 0x07;
+			break;
+		}
+	}
+
+	if (message >= 0) {
+		data[0] = (unsigned char) message;
+		response_length += bsl_simulator_core_response(BSL_SIMULATOR_CORE_MESSAGE, data, 1, &response[response_length]);
+	}
+
+	return response_length;
+}
+
+static size_t bsl_simulator_core_response(unsigned char type, const unsigned char * data, size_t size, unsigned char * response)
+{
+	unsigned short crc;
+
+	response[0] = BSL_SIMULATOR_HEADER;
+	response[1] = (1 + size) % 256;
+	response[2] = (1 + size) / 256;
+	response[3] = type;
+	memcpy(&response[4], data, size);
+
+	crc = checksum_crc16(0xFFFF, &response[3], 1 + size);
+	response[4 + size] = crc % 256;
+	response[4 + size + 1] = crc / 256;
+
+	return 3 + 1 + size + 2;
+}
+
+static void bsl_simulator_write(bsl_simulator_t * simulator_p, unsigned int address, const unsigned char * data, size_t size, double * delay_p)
+{
+	size_t i;
+
+	for (i = 0; (i < size) && (address + i < BSL_SIMULATOR_MEMORY_SIZE); i++) {
+		if (bsl_simulator_is_flash(simulator_p, address + i)) {
+			// Programming can only clear bits.
+			simulator_p->memory[address + i] &= data[i];
+			if (i % 2 == 0) {
+				*delay_p += simulator_p->settings.word_write_time;
+			}
+		}
+		else if (bsl_simulator_is_ram(simulator_p, address + i)) {
+			simulator_p->memory[address + i] = data[i];
+		}
+	}
+}
+
+static void bsl_simulator_erase(bsl_simulator_t * simulator_p, unsigned int address, bool segment, double * delay_p)
+{
+	const bsl_simulator_settings_t * settings_p = &simulator_p->settings;
+	unsigned int start;
+	unsigned int end;
+
+	if ((address >= settings_p->info_start) && (address < settings_p->info_start + settings_p->info_size)) {
+		if (segment) {
+			start = address - (address - settings_p->info_start) % settings_p->info_segment_size;
+			end = start + settings_p->info_segment_size;
+		}
+		else {
+			start = settings_p->info_start;
+			end = settings_p->info_start + settings_p->info_size;
+		}
+	}
+	else if ((address >= settings_p->main_start) && (address < settings_p->main_end)) {
+		if (segment) {
+			// Segments are aligned, the first one is cut short when the main memory starts within it.
+			start = address - address % settings_p->main_segment_size;
+			end = start + settings_p->main_segment_size;
+			if (start < settings_p->main_start) {
+				start = settings_p->main_start;
+			}
+			if (end > settings_p->main_end) {
+				end = settings_p->main_end;
+			}
+		}
+		else {
+			start = settings_p->main_start;
+			end = settings_p->main_end;
+		}
+	}
+	else {
+		// Not flash, nothing happens.
+		return;
+	}
+
+	memset(&(simulator_p->memory[start]), 0xFF, end - start);
+	*delay_p += segment ? settings_p->segment_erase_time : settings_p->mass_erase_time;
+}
+
+static bool bsl_simulator_is_flash(const bsl_simulator_t * simulator_p, unsigned int address)
+{
+	const bsl_simulator_settings_t * settings_p = &simulator_p->settings;
+
+	return ((address >= settings_p->main_start) && (address < settings_p->main_end)) ||
+			((address >= settings_p->info_start) && (address < settings_p->info_start + settings_p->info_size));
+}
+
+static bool bsl_simulator_is_ram(const bsl_simulator_t * simulator_p, unsigned int address)
+{
+	return (address >= simulator_p->settings.ram_start) &&
+			(address < simulator_p->settings.ram_start + simulator_p->settings.ram_size);
+}
+
+static bool bsl_simulator_execute(bsl_simulator_t * simulator_p, unsigned int address, unsigned long * cycles_p)
+{
+	unsigned int registers[16] = {0};
+	unsigned long steps;
+	bool halted = false;
+
+	registers[0] = address;
+	registers[1] = simulator_p->settings.ram_start + simulator_p->settings.ram_size;
+	*cycles_p = 0;
+
+	// Word instructions only, anything else halts the CPU like a crashed program.
+	for (steps = 0; (steps < BSL_SIMULATOR_MAX_STEPS) && !halted && (registers[0] != BSL_SIMULATOR_WARM_START); steps++) {
+		unsigned int instruction = bsl_simulator_read_word(simulator_p, registers[0]);
+		unsigned int flags = registers[2];
+
+		registers[0] = (registers[0] + 2) & 0xFFFF;
+
+		if ((instruction & 0xE000) == 0x2000) {
+			// Jump, a signed word offset from the next instruction.
+			int offset = (instruction & 0x200) ? (int) (instruction & 0x3FF) - 0x400 : (int) (instruction & 0x3FF);
+			bool carry = flags & 0x0001;
+			bool zero = flags & 0x0002;
+			bool negative = flags & 0x0004;
+			bool overflow = flags & 0x0100;
+			bool taken = true;
+
+			switch ((instruction >> 10) & 7)
+			{
+			case 0:
+				taken = !zero;
+				break;
+			case 1:
+				taken = zero;
+				break;
+			case 2:
+				taken = !carry;
+				break;
+			case 3:
+				taken = carry;
+				break;
+			case 4:
+				taken = negative;
+				break;
+			case 5:
+				taken = (negative == overflow);
+				break;
+			case 6:
+				taken = (negative != overflow);
+				break;
+			}
+
+			if (taken) {
+				registers[0] = (registers[0] + 2 * offset) & 0xFFFF;
+			}
+			*cycles_p += 2;
+		}
+		else if ((instruction >= 0x4000) && ((instruction >> 12) != 0xA) && !(instruction & 0x0040)) {
+			unsigned int opcode = instruction >> 12;
+			unsigned int source = (instruction >> 8) & 0xF;
+			unsigned int source_mode = (instruction >> 4) & 3;
+			unsigned int destination = instruction & 0xF;
+			bool indexed = instruction & 0x0080;
+			unsigned int source_value;
+			unsigned int destination_address = 0;
+			unsigned int destination_value;
+			unsigned int result;
+
+			*cycles_p += 1;
+
+			// Source operand, R2 and R3 generate constants in some modes.
+			if (source == 3) {
+				source_value = (source_mode == 3) ? 0xFFFF : source_mode;
+			}
+			else if ((source == 2) && (source_mode >= 2)) {
+				source_value = (source_mode == 2) ? 4 : 8;
+			}
+			else if (source_mode == 0) {
+				source_value = registers[source];
+			}
+			else if (source_mode == 1) {
+				// Indexed, symbolic from R0 or absolute from R2.
+				unsigned int base = (source == 2) ? 0 : registers[source];
+				source_value = bsl_simulator_read_word(simulator_p, base + bsl_simulator_read_word(simulator_p, registers[0]));
+				registers[0] = (registers[0] + 2) & 0xFFFF;
+				*cycles_p += 2;
+			}
+			else {
+				// Indirect, the autoincrement from R0 is an immediate.
+				source_value = bsl_simulator_read_word(simulator_p, registers[source]);
+				if (source_mode == 3) {
+					registers[source] = (registers[source] + 2) & 0xFFFF;
+				}
+				*cycles_p += 1;
+			}
+
+			if (indexed) {
+				unsigned int base = (destination == 2) ? 0 : registers[destination];
+				destination_address = (base + bsl_simulator_read_word(simulator_p, registers[0])) & 0xFFFF;
+				registers[0] = (registers[0] + 2) & 0xFFFF;
+				destination_value = bsl_simulator_read_word(simulator_p, destination_address);
+				*cycles_p += 3;
+			}
+			else {
+				destination_value = registers[destination];
+			}
+
+			switch (opcode)
+			{
+			case 0x4:
+				result = source_value;
+				break;
+			case 0x5:
+			case 0x6:
+				result = destination_value + source_value + ((opcode == 0x6) ? (flags & 0x0001) : 0);
+				flags = (flags & ~0x0107u) | bsl_simulator_get_flags(result, result > 0xFFFF,
+						(source_value ^ result) & (destination_value ^ result) & 0x8000);
+				break;
+			case 0x7:
+			case 0x8:
+			case 0x9:
+				// Subtraction adds the complement.
+				source_value = ~source_value & 0xFFFF;
+				result = destination_value + source_value + ((opcode == 0x7) ? (flags & 0x0001) : 1);
+				flags = (flags & ~0x0107u) | bsl_simulator_get_flags(result, result > 0xFFFF,
+						(source_value ^ result) & (destination_value ^ result) & 0x8000);
+				break;
+			case 0xB:
+			case 0xF:
+				result = source_value & destination_value;
+				flags = (flags & ~0x0107u) | bsl_simulator_get_flags(result, result != 0, false);
+				break;
+			case 0xC:
+				result = destination_value & ~source_value;
+				break;
+			case 0xD:
+				result = destination_value | source_value;
+				break;
+			default:
+				result = source_value ^ destination_value;
+				flags = (flags & ~0x0107u) | bsl_simulator_get_flags(result, result != 0,
+						source_value & destination_value & 0x8000);
+				break;
+			}
+
+			registers[2] = flags;
+
+			// Compare and bit test only set the flags.
+			if ((opcode != 0x9) && (opcode != 0xB)) {
+				if (indexed && bsl_simulator_is_ram(simulator_p, destination_address & 0xFFFE)) {
+					// Flash needs the flash controller, peripherals are not modelled.
+					simulator_p->memory[destination_address & 0xFFFE] = result % 256;
+					simulator_p->memory[(destination_address & 0xFFFE) + 1] = (result / 256) % 256;
+				}
+				else if (destination != 3) {
+					registers[destination] = result & 0xFFFF;
+					if (destination == 0) {
+						*cycles_p += 1;
+					}
+				}
+			}
+		}
+		else {
+			halted = true;
+		}
+	}
+
+	return registers[0] == BSL_SIMULATOR_WARM_START;
+}
+
+static unsigned int bsl_simulator_read_word(const bsl_simulator_t * simulator_p, unsigned int address)
+{
+	address &= 0xFFFE;
+
+	return simulator_p->memory[address] + simulator_p->memory[address + 1] * 256;
+}
+
+static unsigned int bsl_simulator_get_flags(unsigned int result, bool carry, bool overflow)
+{
+	unsigned int flags = 0;
+
+	flags |= carry ? 0x0001 : 0;
+	flags |= ((result & 0xFFFF) == 0) ? 0x0002 : 0;
+	flags |= (result & 0x8000) ? 0x0004 : 0;
+	flags |= overflow ? 0x0100 : 0;
+
+	return flags;
+}
+
+static unsigned short bsl_simulator_checksum(const unsigned char * data, size_t size)
+{
+	// XOR all words and invert the result.
+	return ~checksum_xor16(0, data, size);
+}
+
+static double bsl_simulator_random(bsl_simulator_t * simulator_p)
+{
+	// Xorshift, deterministic for a given seed.
+	simulator_p->random ^= simulator_p->random << 13;
+	simulator_p->random ^= simulator_p->random >> 17;
+	simulator_p->random ^= simulator_p->random << 5;
+
+	return (simulator_p->random >> 8) / 16777216.0;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,125 @@
+/**
+ * @file	bsl_simulator.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the MSP430 BSL device simulator.
+ */
+
+#ifndef BSL_SIMULATOR_H_
+#define BSL_SIMULATOR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "transport_loopback.h"
+
+/**
+ * @addtogroup bsl_simulator
+ * @{
+ */
+
+#define BSL_SIMULATOR_MEMORY_SIZE	(0x30000)
+#define BSL_SIMULATOR_FRAME_SIZE	(3 + 260 + 2)
+
+/**
+ * @brief Protocol spoken by the simulated BSL.
+ */
+typedef enum
+{
+	bsl_simulator_protocol_legacy,	/**< 1xx/2xx/4xx ROM BSL.				*/
+	bsl_simulator_protocol_core		/**< 5xx/6xx/FRxx core command BSL.		*/
+} bsl_simulator_protocol;
+
+/**
+ * @brief Simulated device and link properties.
+ */
+typedef struct
+{
+	bsl_simulator_protocol	protocol;		/**< Protocol of the BSL.								*/
+	unsigned short	chip_id;				/**< Chip ID stored at 0x0FF0, or 0x1A04 for core.		*/
+	unsigned int	bsl_version;			/**< BSL version stored at 0x0FFA, or 4 bytes for core.	*/
+	unsigned int	ram_start;				/**< First RAM address.								*/
+	unsigned int	ram_size;				/**< RAM size in bytes.								*/
+	unsigned int	info_start;				/**< First information memory address.				*/
+	unsigned int	info_size;				/**< Information memory size in bytes.				*/
+	unsigned int	info_segment_size;		/**< Information memory segment size in bytes.		*/
+	unsigned int	main_start;				/**< First main memory address.						*/
+	unsigned int	main_end;				/**< Address after the main memory.					*/
+	unsigned int	main_segment_size;		/**< Main memory segment size in bytes.				*/
+	unsigned int	baudrate;				/**< Initial line rate in baud.						*/
+	unsigned int	bits_per_byte;			/**< Bits per character on the wire.				*/
+	double			word_write_time;		/**< Flash word write time in seconds.				*/
+	double			segment_erase_time;		/**< Flash segment erase time in seconds.			*/
+	double			mass_erase_time;		/**< Flash mass erase time in seconds.				*/
+	double			cpu_frequency;			/**< CPU clock of programs started by load PC, in Hz.	*/
+	double			nak_rate;				/**< Probability of answering a frame with a NAK.	*/
+	double			drop_rate;				/**< Probability of dropping a response byte.		*/
+	double			corrupt_rate;			/**< Probability of corrupting a response byte.		*/
+	unsigned int	max_baudrate;			/**< Highest rate the link sustains, 0 for any.		*/
+	unsigned int	seed;					/**< Seed for the error injection.					*/
+} bsl_simulator_settings_t;
+
+/**
+ * @brief Simulator statistics.
+ */
+typedef struct
+{
+	unsigned long	syncs;				/**< Synchronization characters answered.		*/
+	unsigned long	commands;			/**< Complete frames processed.					*/
+	unsigned long	naks;				/**< NAKs sent, including injected ones.		*/
+	unsigned long	dropped;			/**< Response bytes dropped by injection.		*/
+	unsigned long	corrupted;			/**< Response bytes corrupted by injection.		*/
+	unsigned long	bytes_received;		/**< Bytes received from the host.				*/
+	unsigned long	bytes_sent;			/**< Bytes sent to the host.					*/
+	double			elapsed;			/**< Simulated link and device time in seconds.	*/
+} bsl_simulator_statistics_t;
+
+/**
+ * @brief Simulator state.
+ */
+typedef enum
+{
+	bsl_simulator_running,		/**< Running the application, the BSL does not answer.	*/
+	bsl_simulator_wait_sync,	/**< BSL waiting for the synchronization character.		*/
+	bsl_simulator_wait_frame	/**< BSL receiving a command frame.						*/
+} bsl_simulator_state;
+
+/**
+ * @brief Simulator object.
+ */
+typedef struct
+{
+	bsl_simulator_settings_t	settings;							/**< Device and link properties.	*/
+	bsl_simulator_statistics_t	statistics;							/**< Statistics.					*/
+	bsl_simulator_state			state;								/**< Protocol state.				*/
+	bool						locked;								/**< TRUE until a valid password.	*/
+	unsigned int				baudrate;							/**< Current line rate.				*/
+	unsigned int				lines;								/**< Current SERIAL_LINE_* state.	*/
+	unsigned short				mem_offset;							/**< Set by SET_MEM_OFFSET.			*/
+	unsigned int				random;								/**< Error injection state.			*/
+	unsigned char				frame[BSL_SIMULATOR_FRAME_SIZE];	/**< Frame being received.			*/
+	size_t						frame_size;							/**< Bytes of the frame received.	*/
+	double						run_time;							/**< Time of the program started last.	*/
+	double						busy_until;							/**< Link time the CPU is back in the BSL.	*/
+	unsigned char				memory[BSL_SIMULATOR_MEMORY_SIZE];	/**< The address space.				*/
+} bsl_simulator_t;
+
+extern const transport_loopback_peer_t bsl_simulator_peer;
+
+void bsl_simulator_get_default_settings(bsl_simulator_settings_t * settings_p);
+void bsl_simulator_get_core_settings(bsl_simulator_settings_t * settings_p);
+
+bsl_simulator_t * bsl_simulator_construct(const bsl_simulator_settings_t * settings_p);
+void bsl_simulator_destroy(bsl_simulator_t * simulator_p);
+
+void bsl_simulator_reset(bsl_simulator_t * simulator_p, bool enter_bsl);
+void bsl_simulator_set_lines(bsl_simulator_t * simulator_p, unsigned int lines);
+size_t bsl_simulator_receive(bsl_simulator_t * simulator_p, const unsigned char * data, size_t size,
+		unsigned char * response, size_t response_size, double * delay_p);
+
+/**
+ * @}
+ */
+
+#endif /* BSL_SIMULATOR_H_ */
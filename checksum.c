@@ -0,0 +1,506 @@
+/**
+ * @file	checksum.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the checksum library.
+ *
+ * The XOR-16 checksum of 1xx/2xx/4xx BSL frames and the byte sum of Intel HEX
+ * records have scalar, 64-bit SWAR, SSE2 and AVX2 kernels. The fastest kernel
+ * the processor supports is selected on first use; checksum_set_kernel()
+ * overrides the choice for testing and benchmarking. The CRC16-CCITT of the
+ * 5xx/6xx BSL is table driven, its frames are too short to gain from more.
+ *
+ * The vector kernels load words in little-endian order, like the BSL sends
+ * them, so they are only built for x86; elsewhere only the scalar and, on
+ * little-endian targets, the SWAR kernels exist.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHECKSUM_X86
+#endif
+
+#include "checksum.h"
+
+/**
+ * @defgroup checksum Checksum
+ * @brief Checksums of BSL frames and Intel HEX records.
+ * @{
+ */
+
+/**
+ * @brief Words a SWAR byte sum accumulates before its 16-bit lanes could overflow.
+ */
+#define CHECKSUM_SWAR_SUM_WORDS	(128)
+
+static const char * const checksum_kernel_names[checksum_kernel_count] =
+{
+	"scalar",
+	"swar",
+	"sse2",
+	"avx2"
+};
+
+// CRC16-CCITT of every nibble value.
+static const unsigned short checksum_crc16_table[16] =
+{
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static checksum_kernel checksum_active_kernel = checksum_kernel_count;
+
+static checksum_kernel checksum_select_kernel(void);
+static unsigned short checksum_xor16_scalar(const unsigned char * data, size_t size);
+static unsigned char checksum_sum8_scalar(const unsigned char * data, size_t size);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static unsigned short checksum_xor16_swar(const unsigned char * data, size_t size);
+static unsigned char checksum_sum8_swar(const unsigned char * data, size_t size);
+#endif
+#ifdef CHECKSUM_X86
+static unsigned short checksum_xor16_sse2(const unsigned char * data, size_t size);
+static unsigned char checksum_sum8_sse2(const unsigned char * data, size_t size);
+static unsigned short checksum_xor16_avx2(const unsigned char * data, size_t size);
+static unsigned char checksum_sum8_avx2(const unsigned char * data, size_t size);
+#endif
+
+/**
+ * @brief	Check if a kernel can run on this processor.
+ * @param	kernel			The kernel.
+ * @return	TRUE when supported.
+ */
+bool checksum_kernel_supported(checksum_kernel kernel)
+{
+	bool supported = false;
+
+	switch (kernel)
+	{
+	case checksum_kernel_scalar:
+		supported = true;
+		break;
+	case checksum_kernel_swar:
+		supported = (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__);
+		break;
+#ifdef CHECKSUM_X86
+	case checksum_kernel_sse2:
+		supported = __builtin_cpu_supports("sse2");
+		break;
+	case checksum_kernel_avx2:
+		supported = __builtin_cpu_supports("avx2");
+		break;
+#endif
+	default:
+		break;
+	}
+
+	return supported;
+}
+
+/**
+ * @brief	Get the name of a kernel.
+ * @param	kernel			The kernel.
+ * @return	The name.
+ */
+const char * checksum_kernel_name(checksum_kernel kernel)
+{
+	return (kernel < checksum_kernel_count) ? checksum_kernel_names[kernel] : "unknown";
+}
+
+/**
+ * @brief	Get the kernel in use.
+ * @return	The kernel.
+ */
+checksum_kernel checksum_get_kernel(void)
+{
+	if (checksum_active_kernel == checksum_kernel_count) {
+		checksum_active_kernel = checksum_select_kernel();
+	}
+
+	return checksum_active_kernel;
+}
+
+/**
+ * @brief	Override the kernel selection.
+ * @param	kernel			The kernel to use.
+ * @return	0 on success, 1 if the kernel is not supported.
+ */
+int checksum_set_kernel(checksum_kernel kernel)
+{
+	int error = 0;
+
+	if (!checksum_kernel_supported(kernel)) {
+		fprintf(stderr, "The %s checksum kernel is not supported.\n", checksum_kernel_name(kernel));
+		error = 1;
+	}
+	else {
+		checksum_active_kernel = kernel;
+	}
+
+	return error;
+}
+
+/**
+ * @brief	XOR 16-bit little-endian words into a checksum.
+ *
+ * The data starts at the low byte of a word; a trailing odd byte counts as a
+ * low byte. The BSL frame checksum is the inverse of the result.
+ *
+ * @param	checksum		Checksum of the preceding words, 0 to start.
+ * @param	data			The data.
+ * @param	size			Amount of data.
+ * @return	The updated checksum.
+ */
+unsigned short checksum_xor16(unsigned short checksum, const unsigned char * data, size_t size)
+{
+	switch (checksum_get_kernel())
+	{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	case checksum_kernel_swar:
+		checksum ^= checksum_xor16_swar(data, size);
+		break;
+#endif
+#ifdef CHECKSUM_X86
+	case checksum_kernel_sse2:
+		checksum ^= checksum_xor16_sse2(data, size);
+		break;
+	case checksum_kernel_avx2:
+		checksum ^= checksum_xor16_avx2(data, size);
+		break;
+#endif
+	default:
+		checksum ^= checksum_xor16_scalar(data, size);
+		break;
+	}
+
+	return checksum;
+}
+
+/**
+ * @brief	Add bytes to an 8-bit sum.
+ *
+ * An Intel HEX record is valid when the sum of all its bytes, including the
+ * checksum, is 0.
+ *
+ * @param	sum				Sum of the preceding bytes, 0 to start.
+ * @param	data			The data.
+ * @param	size			Amount of data.
+ * @return	The updated sum.
+ */
+unsigned char checksum_sum8(unsigned char sum, const unsigned char * data, size_t size)
+{
+	switch (checksum_get_kernel())
+	{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	case checksum_kernel_swar:
+		sum += checksum_sum8_swar(data, size);
+		break;
+#endif
+#ifdef CHECKSUM_X86
+	case checksum_kernel_sse2:
+		sum += checksum_sum8_sse2(data, size);
+		break;
+	case checksum_kernel_avx2:
+		sum += checksum_sum8_avx2(data, size);
+		break;
+#endif
+	default:
+		sum += checksum_sum8_scalar(data, size);
+		break;
+	}
+
+	return sum;
+}
+
+/**
+ * @brief	Update a CRC16-CCITT (polynomial 0x1021, MSB first, no final XOR).
+ * @param	crc				CRC of the preceding data, 0xFFFF to start a BSL frame.
+ * @param	data			The data.
+ * @param	size			Amount of data.
+ * @return	The updated CRC.
+ */
+unsigned short checksum_crc16(unsigned short crc, const unsigned char * data, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		crc = (unsigned short) ((crc << 4) ^ checksum_crc16_table[(crc >> 12) ^ (data[i] >> 4)]);
+		crc = (unsigned short) ((crc << 4) ^ checksum_crc16_table[(crc >> 12) ^ (data[i] & 0x0F)]);
+	}
+
+	return crc;
+}
+
+/**
+ * @brief	Start an incremental XOR-16 checksum.
+ * @param	state_p			The checksum state.
+ * @return	None.
+ */
+void checksum_xor16_init(checksum_xor16_t * state_p)
+{
+	state_p->checksum = 0;
+	state_p->odd = false;
+	state_p->low_byte = 0;
+}
+
+/**
+ * @brief	Add data to an incremental XOR-16 checksum.
+ * @param	state_p			The checksum state.
+ * @param	data			The data, following the data added before.
+ * @param	size			Amount of data.
+ * @return	None.
+ */
+void checksum_xor16_update(checksum_xor16_t * state_p, const unsigned char * data, size_t size)
+{
+	if (state_p->odd && (size > 0)) {
+		// Complete the word started by the previous piece.
+		state_p->checksum ^= state_p->low_byte + data[0] * 256;
+		state_p->odd = false;
+		data++;
+		size--;
+	}
+
+	state_p->checksum = checksum_xor16(state_p->checksum, data, size & ~(size_t) 1);
+
+	if (size % 2) {
+		state_p->low_byte = data[size - 1];
+		state_p->odd = true;
+	}
+}
+
+/**
+ * @brief	Get the BSL checksum of the data added so far.
+ * @param	state_p			The checksum state.
+ * @return	The inverted XOR of all words, sent low byte first.
+ */
+unsigned short checksum_xor16_final(const checksum_xor16_t * state_p)
+{
+	unsigned short checksum = state_p->checksum;
+
+	if (state_p->odd) {
+		checksum ^= state_p->low_byte;
+	}
+
+	return (unsigned short) ~checksum;
+}
+
+/**
+ * @brief	Start an incremental CRC16-CCITT with the BSL seed 0xFFFF.
+ * @param	state_p			The checksum state.
+ * @return	None.
+ */
+void checksum_crc16_init(checksum_crc16_t * state_p)
+{
+	state_p->crc = 0xFFFF;
+}
+
+/**
+ * @brief	Add data to an incremental CRC16-CCITT.
+ * @param	state_p			The checksum state.
+ * @param	data			The data, following the data added before.
+ * @param	size			Amount of data.
+ * @return	None.
+ */
+void checksum_crc16_update(checksum_crc16_t * state_p, const unsigned char * data, size_t size)
+{
+	state_p->crc = checksum_crc16(state_p->crc, data, size);
+}
+
+/**
+ * @brief	Get the CRC of the data added so far.
+ * @param	state_p			The checksum state.
+ * @return	The CRC, sent low byte first by the BSL.
+ */
+unsigned short checksum_crc16_final(const checksum_crc16_t * state_p)
+{
+	return state_p->crc;
+}
+
+static checksum_kernel checksum_select_kernel(void)
+{
+	checksum_kernel kernel = checksum_kernel_avx2;
+
+	// Prefer the widest kernel the processor runs.
+	while ((kernel > checksum_kernel_scalar) && !checksum_kernel_supported(kernel)) {
+		kernel--;
+	}
+
+	return kernel;
+}
+
+static unsigned short checksum_xor16_scalar(const unsigned char * data, size_t size)
+{
+	unsigned short checksum = 0;
+	size_t i;
+
+	for (i = 0; i + 1 < size; i += 2) {
+		checksum ^= data[i] + data[i + 1] * 256;
+	}
+	if (size % 2) {
+		checksum ^= data[size - 1];
+	}
+
+	return checksum;
+}
+
+static unsigned char checksum_sum8_scalar(const unsigned char * data, size_t size)
+{
+	unsigned char sum = 0;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		sum += data[i];
+	}
+
+	return sum;
+}
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+static unsigned short checksum_xor16_swar(const unsigned char * data, size_t size)
+{
+	uint64_t accumulator = 0;
+	size_t i;
+
+	for (i = 0; i + 8 <= size; i += 8) {
+		uint64_t word;
+
+		memcpy(&word, &data[i], sizeof(word));
+		accumulator ^= word;
+	}
+
+	// Fold the four words of the accumulator.
+	accumulator ^= accumulator >> 32;
+	accumulator ^= accumulator >> 16;
+
+	return (unsigned short) accumulator ^ checksum_xor16_scalar(&data[i], size - i);
+}
+
+static unsigned char checksum_sum8_swar(const unsigned char * data, size_t size)
+{
+	const uint64_t mask = 0x00FF00FF00FF00FFULL;
+	uint64_t accumulator = 0;
+	unsigned int sum = 0;
+	size_t words = 0;
+	size_t i;
+
+	for (i = 0; i + 8 <= size; i += 8) {
+		uint64_t word;
+
+		// Add the even and odd bytes into four 16-bit lanes.
+		memcpy(&word, &data[i], sizeof(word));
+		accumulator += (word & mask) + ((word >> 8) & mask);
+
+		if (++words == CHECKSUM_SWAR_SUM_WORDS) {
+			sum += (unsigned int) ((accumulator & 0xFFFF) + ((accumulator >> 16) & 0xFFFF)
+					+ ((accumulator >> 32) & 0xFFFF) + (accumulator >> 48));
+			accumulator = 0;
+			words = 0;
+		}
+	}
+
+	sum += (unsigned int) ((accumulator & 0xFFFF) + ((accumulator >> 16) & 0xFFFF)
+			+ ((accumulator >> 32) & 0xFFFF) + (accumulator >> 48));
+
+	return (unsigned char) (sum + checksum_sum8_scalar(&data[i], size - i));
+}
+
+#endif
+
+#ifdef CHECKSUM_X86
+
+__attribute__((target("sse2")))
+static unsigned short checksum_xor16_sse2(const unsigned char * data, size_t size)
+{
+	__m128i accumulator = _mm_setzero_si128();
+	uint64_t folded;
+	size_t i;
+
+	for (i = 0; i + 16 <= size; i += 16) {
+		accumulator = _mm_xor_si128(accumulator, _mm_loadu_si128((const __m128i *) &data[i]));
+	}
+
+	// Fold the eight words of the accumulator.
+	accumulator = _mm_xor_si128(accumulator, _mm_srli_si128(accumulator, 8));
+	_mm_storel_epi64((__m128i *) &folded, accumulator);
+	folded ^= folded >> 32;
+	folded ^= folded >> 16;
+
+	return (unsigned short) folded ^ checksum_xor16_scalar(&data[i], size - i);
+}
+
+__attribute__((target("sse2")))
+static unsigned char checksum_sum8_sse2(const unsigned char * data, size_t size)
+{
+	__m128i accumulator = _mm_setzero_si128();
+	const __m128i zero = _mm_setzero_si128();
+	uint64_t sum;
+	uint64_t high_sum;
+	size_t i;
+
+	// The sum of absolute differences with zero adds 8 bytes into each 64-bit half.
+	for (i = 0; i + 16 <= size; i += 16) {
+		accumulator = _mm_add_epi64(accumulator, _mm_sad_epu8(_mm_loadu_si128((const __m128i *) &data[i]), zero));
+	}
+
+	_mm_storel_epi64((__m128i *) &sum, accumulator);
+	_mm_storel_epi64((__m128i *) &high_sum, _mm_srli_si128(accumulator, 8));
+	sum += high_sum;
+
+	return (unsigned char) (sum + checksum_sum8_scalar(&data[i], size - i));
+}
+
+__attribute__((target("avx2")))
+static unsigned short checksum_xor16_avx2(const unsigned char * data, size_t size)
+{
+	__m256i accumulator = _mm256_setzero_si256();
+	__m128i half;
+	uint64_t folded;
+	size_t i;
+
+	for (i = 0; i + 32 <= size; i += 32) {
+		accumulator = _mm256_xor_si256(accumulator, _mm256_loadu_si256((const __m256i *) &data[i]));
+	}
+
+	// Fold the sixteen words of the accumulator.
+	half = _mm_xor_si128(_mm256_castsi256_si128(accumulator), _mm256_extracti128_si256(accumulator, 1));
+	half = _mm_xor_si128(half, _mm_srli_si128(half, 8));
+	_mm_storel_epi64((__m128i *) &folded, half);
+	folded ^= folded >> 32;
+	folded ^= folded >> 16;
+
+	return (unsigned short) folded ^ checksum_xor16_scalar(&data[i], size - i);
+}
+
+__attribute__((target("avx2")))
+static unsigned char checksum_sum8_avx2(const unsigned char * data, size_t size)
+{
+	__m256i accumulator = _mm256_setzero_si256();
+	const __m256i zero = _mm256_setzero_si256();
+	__m128i half;
+	uint64_t sum;
+	uint64_t high_sum;
+	size_t i;
+
+	// The sum of absolute differences with zero adds 8 bytes into each 64-bit quarter.
+	for (i = 0; i + 32 <= size; i += 32) {
+		accumulator = _mm256_add_epi64(accumulator, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i *) &data[i]), zero));
+	}
+
+	half = _mm_add_epi64(_mm256_castsi256_si128(accumulator), _mm256_extracti128_si256(accumulator, 1));
+	_mm_storel_epi64((__m128i *) &sum, half);
+	_mm_storel_epi64((__m128i *) &high_sum, _mm_srli_si128(half, 8));
+	sum += high_sum;
+
+	return (unsigned char) (sum + checksum_sum8_scalar(&data[i], size - i));
+}
+
+#endif
+
+/**
+ * @}
+ */
@@ -0,0 +1,74 @@
+/**
+ * @file	checksum.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the checksum library.
+ */
+
+#ifndef CHECKSUM_H_
+#define CHECKSUM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @addtogroup checksum
+ * @{
+ */
+
+/**
+ * @brief Implementations of the XOR-16 and byte sum kernels.
+ */
+typedef enum
+{
+	checksum_kernel_scalar,		/**< One element at a time.				*/
+	checksum_kernel_swar,		/**< 64-bit words in general registers.	*/
+	checksum_kernel_sse2,		/**< 128-bit SSE2 vectors.				*/
+	checksum_kernel_avx2,		/**< 256-bit AVX2 vectors.				*/
+	checksum_kernel_count		/**< Number of kernels.					*/
+} checksum_kernel;
+
+/**
+ * @brief Incremental XOR-16 checksum of a BSL frame (1xx/2xx/4xx).
+ *
+ * Data may be added in pieces of any size, bytes keep their position in the
+ * 16-bit words of the frame.
+ */
+typedef struct
+{
+	unsigned short	checksum;	/**< XOR of the complete words so far.		*/
+	bool			odd;		/**< TRUE if a low byte is waiting.			*/
+	unsigned char	low_byte;	/**< The waiting low byte of a word.		*/
+} checksum_xor16_t;
+
+/**
+ * @brief Incremental CRC16-CCITT (polynomial 0x1021) of a 5xx/6xx BSL frame.
+ */
+typedef struct
+{
+	unsigned short	crc;	/**< CRC of the data so far.	*/
+} checksum_crc16_t;
+
+bool checksum_kernel_supported(checksum_kernel kernel);
+const char * checksum_kernel_name(checksum_kernel kernel);
+checksum_kernel checksum_get_kernel(void);
+int checksum_set_kernel(checksum_kernel kernel);
+
+unsigned short checksum_xor16(unsigned short checksum, const unsigned char * data, size_t size);
+unsigned char checksum_sum8(unsigned char sum, const unsigned char * data, size_t size);
+unsigned short checksum_crc16(unsigned short crc, const unsigned char * data, size_t size);
+
+void checksum_xor16_init(checksum_xor16_t * state_p);
+void checksum_xor16_update(checksum_xor16_t * state_p, const unsigned char * data, size_t size);
+unsigned short checksum_xor16_final(const checksum_xor16_t * state_p);
+
+void checksum_crc16_init(checksum_crc16_t * state_p);
+void checksum_crc16_update(checksum_crc16_t * state_p, const unsigned char * data, size_t size);
+unsigned short checksum_crc16_final(const checksum_crc16_t * state_p);
+
+/**
+ * @}
+ */
+
+#endif /* CHECKSUM_H_ */
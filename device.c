@@ -7,21 +7,146 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "serial.h"
 #include "device.h"
 #include "bsl.h"
+#include "bsl_core.h"
+#include "checksum.h"
 
 #define DEVICE_MAIN_MEMORY_ADDRESS			(0xFFFE)
 #define DEVICE_INFORMATION_MEMORY_ADDRESS	(0x1000)
 #define DEVICE_SEGMENT_A_ADDRESS			(0x10C0)
-#define DEVICE_SEGMENT_B_ADDRESS			(0x1080)
-#define DEVICE_SEGMENT_C_ADDRESS			(0x1040)
-#define DEVICE_SEGMENT_D_ADDRESS			(0x1000)
+#define DEVICE_INFORMATION_MEMORY_END		(0x1100)
+#define DEVICE_MAIN_MEMORY_START			(0x1100)
+#define DEVICE_MAIN_MEMORY_END				(0x10000)
 
 #define DEVICE_CHIP_ID_ADDRESS				(0x0FF0)
 #define DEVICE_BSL_VERSION_ADDRESS			(0x0FFA)
 
+#define DEVICE_CORE_INFO_A_ADDRESS			(0x1980)
+#define DEVICE_CORE_INFO_D_ADDRESS			(0x1800)
+#define DEVICE_CORE_INFO_END				(0x1A00)
+#define DEVICE_CORE_MAIN_START				(0x4400)
+#define DEVICE_CORE_MAIN_END				(0x100000)
+#define DEVICE_CORE_CHIP_ID_ADDRESS			(0x1A04)
+#define DEVICE_CORE_CRC_RANGE				(0x8000)
+#define DEVICE_CORE_DIE_RECORD_ADDRESS		(0x1A0A)
+#define DEVICE_CORE_DIE_RECORD_SIZE			(8)
+
+#define DEVICE_MAIN_SEGMENT_SIZE			(DEVICE_MAX_SEGMENT_SIZE)
+#define DEVICE_INFO_SEGMENT_SIZE			(64)
+#define DEVICE_CORE_INFO_SEGMENT_SIZE		(128)
+
+#define DEVICE_SEGMENT_ERASE_TIME			(0.05)
+#define DEVICE_REGION_ERASE_TIME			(0.5)
+#define DEVICE_MASS_ERASE_TIME				(0.5)
+#define DEVICE_ERASE_BATCH_SIZE				(8)
+#define DEVICE_ERASE_CHECK_VERSION			(0x0160)
+#define DEVICE_ERASE_CHECK_RANGE			(0x8000)
+
+#define DEVICE_RETRY_MAX_ATTEMPTS			(8)
+#define DEVICE_RETRY_INITIAL_BACKOFF		(0.01)
+#define DEVICE_RETRY_MAX_BACKOFF			(0.2)
+#define DEVICE_RETRY_RESYNC_AFTER			(2)
+#define DEVICE_RETRY_FALLBACK_AFTER			(4)
+
+#define DEVICE_MIN_FRAME_SIZE				(16)
+#define DEVICE_FRAME_OVERHEAD				(16)
+#define DEVICE_FRAME_ERROR_DECAY			(0.95)
+#define DEVICE_BITS_PER_BYTE				(11)
+
+#define DEVICE_MAX_BAUDRATE					(115200)
+#define DEVICE_CHANGE_BAUDRATE_VERSION		(0x0160)
+
+#define DEVICE_HISTORY_MAGIC				"BSLH"
+#define DEVICE_HISTORY_EXTENSION			".history"
+#define DEVICE_HISTORY_RECORD_SIZE			(6)
+#define DEVICE_HISTORY_INITIAL_SIZE			(16)
+
+#define DEVICE_HELPER_ADDRESS				(0x0220)
+#define DEVICE_HELPER_RESULT_OFFSET			(34)
+#define DEVICE_HELPER_CYCLES_PER_WORD		(7)
+#define DEVICE_HELPER_MIN_CLOCK				(750e3)
+
+typedef struct
+{
+	unsigned char			family;			/**< High byte of the chip ID.						*/
+	bsl_baudrate_settings	settings[3];	/**< DCO and BCS settings per bsl_baudrate.			*/
+} device_clock_table_t;
+
+// Line rates in the order both BSLs number them, the ROM BSL stops at 38400 baud.
+static const unsigned int device_baudrates[] = {9600, 19200, 38400, 57600, 115200};
+
+// Clock register values the ROM BSL needs for each rate, they depend on the family.
+static const device_clock_table_t device_clock_tables[] =
+{
+	{0xF1, {{0x80, 0x85, bsl_baudrate_9600}, {0xE0, 0x86, bsl_baudrate_19200}, {0xE0, 0x87, bsl_baudrate_38400}}},
+	{0xF2, {{0x80, 0x85, bsl_baudrate_9600}, {0x00, 0x8B, bsl_baudrate_19200}, {0x80, 0x8C, bsl_baudrate_38400}}},
+	{0xF4, {{0x00, 0x98, bsl_baudrate_9600}, {0x00, 0xB0, bsl_baudrate_19200}, {0x00, 0xC8, bsl_baudrate_38400}}},
+};
+
+// Sums and XORs a range of words in RAM above the ROM BSL stack, then returns to the BSL warm start.
+static const unsigned short device_checksum_helper[] =
+{
+	0x403C, 0x0000,		// mov #address, R12
+	0x403D, 0x0000,		// mov #words, R13
+	0x430E,				// clr R14
+	0x430F,				// clr R15
+	0x4C3B,				// loop: mov @R12+, R11
+	0x5B0E,				// add R11, R14
+	0xEB0F,				// xor R11, R15
+	0x831D,				// dec R13
+	0x23FB,				// jnz loop
+	0x4E82, 0x0000,		// mov R14, &sum
+	0x4F82, 0x0000,		// mov R15, &xor
+	0x4030, 0x0C02,		// br #0x0C02
+	0x0000, 0x0000,		// sum, xor
+};
+
+static int device_initialize_legacy(device_object_t * object_p, const unsigned char * password);
+static int device_initialize_core(device_object_t * object_p, const unsigned char * password);
+static int device_read_memory_legacy(device_object_t * object_p, unsigned long address, unsigned char * data, size_t length);
+static int device_read_memory_core(device_object_t * object_p, unsigned long address, unsigned char * data, size_t length);
+static int device_write_memory_legacy(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length);
+static int device_write_memory_core(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length);
+static int device_check_crc(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length);
+static int device_verify_memory_legacy(device_object_t * object_p, unsigned long address, const unsigned char * data,
+		size_t length, const unsigned char * password);
+static int device_execute_erase_legacy(device_object_t * object_p, const device_erase_plan_t * plan_p);
+static int device_execute_erase_core(device_object_t * object_p, const device_erase_plan_t * plan_p);
+static size_t device_mark_segments(bool * touched, unsigned long start, unsigned long end, size_t segment_size,
+		unsigned long address, unsigned long range_end);
+static void device_add_erase_command(device_erase_plan_t * plan_p, device_erase_type type, unsigned long address, double time);
+static double device_get_command_time(device_object_t * object_p);
+static int device_check_range(device_object_t * object_p, unsigned long address, size_t size, bool * blank_p);
+static int device_search_blank(device_object_t * object_p, unsigned long address, size_t length, unsigned long * non_blank_p);
+static int device_scan_blank(device_object_t * object_p, unsigned long address, size_t length, unsigned long * non_blank_p);
+static void device_set_default_geometry(device_object_t * object_p);
+static bool device_recover(device_object_t * object_p, int error, unsigned int * attempts_p);
+static size_t device_get_frame_size(device_object_t * object_p, size_t remaining);
+static void device_update_frame_size(device_object_t * object_p, size_t size, int error);
+static void device_back_off(device_object_t * object_p, double backoff);
+static int device_lower_baudrate(device_object_t * object_p);
+static int device_negotiate_baudrate(device_object_t * object_p, const unsigned char * password);
+static size_t device_get_baudrate_count(device_object_t * object_p);
+static int device_change_baudrate(device_object_t * object_p, size_t index);
+static int device_test_link(device_object_t * object_p);
+static int device_restart(device_object_t * object_p, const unsigned char * password);
+static size_t device_get_segment(device_object_t * object_p, unsigned long address, unsigned long * start_p);
+static int device_update_segment(device_object_t * object_p, unsigned long segment_start, size_t segment_size,
+		unsigned long address, const unsigned char * data, size_t length, const unsigned char * contents);
+static int device_program_memory(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length);
+static int device_read_unique_id(device_object_t * object_p, unsigned char * id, size_t * size_p);
+static int device_load_history(device_object_t * object_p);
+static int device_save_history(device_object_t * object_p);
+static size_t device_search_history(device_object_t * object_p, unsigned long address);
+static device_history_segment_t * device_find_history(device_object_t * object_p, unsigned long address);
+static int device_remember_segment(device_object_t * object_p, unsigned long address, size_t size, const unsigned char * data);
+static void device_forget_history(device_object_t * object_p, unsigned long address, size_t length);
+static int device_spot_check_history(device_object_t * object_p, unsigned long address, size_t length);
+
 device_object_t * device_construct(bsl_object_t * bsl_object_p)
 {
 	device_object_t * object_p;
@@ -37,8 +162,24 @@ device_object_t * device_construct(bsl_object_t * bsl_object_p)
 	{
 		// Store the bsl object pointer.
 		object_p->bsl_object_p = bsl_object_p;
+		object_p->protocol = device_protocol_legacy;
 		object_p->chip_id = 0;
 		object_p->bsl_version = 0;
+		object_p->clock_settings = NULL;
+		object_p->max_baudrate = DEVICE_MAX_BAUDRATE;
+		device_get_default_retry_policy(&object_p->retry_policy);
+		object_p->frame_sizing.min_size = DEVICE_MIN_FRAME_SIZE;
+		object_p->frame_sizing.max_size = BSL_MAX_BLOCK_SIZE;
+		object_p->frame_sizing.size = BSL_MAX_BLOCK_SIZE;
+		object_p->frame_sizing.errors = 0;
+		object_p->frame_sizing.bytes = 0;
+		device_clear_statistics(object_p);
+		object_p->history.path = NULL;
+		object_p->history.segments = NULL;
+		object_p->history.count = 0;
+		object_p->history.size = 0;
+		object_p->history.spot_checks = 0;
+		device_set_default_geometry(object_p);
 	}
 
 	return object_p;
@@ -46,15 +187,54 @@ device_object_t * device_construct(bsl_object_t * bsl_object_p)
 
 void device_destroy(device_object_t * object_p)
 {
+	device_close_history(object_p);
 	free(object_p);
 }
 
 int device_initialize(device_object_t * object_p, const unsigned char * password)
+{
+	int error = 0;
+	unsigned char version[BSL_CORE_VERSION_SIZE];
+
+	// Every session counts its own link quality and starts with the largest frames.
+	device_clear_statistics(object_p);
+	object_p->frame_sizing.errors = 0;
+	object_p->frame_sizing.bytes = 0;
+
+	// Start the bsl.
+	error = bsl_run_entry_sequence(object_p->bsl_object_p);
+
+	if (!error) {
+		// Only a 5xx/6xx/FRxx BSL reports a version to a core command, it is several times faster.
+		if (bsl_core_detect(object_p->bsl_object_p, version)) {
+			object_p->protocol = device_protocol_core;
+			object_p->bsl_version = ((unsigned int) version[0] << 24) + (version[1] << 16) + (version[2] << 8) + version[3];
+			object_p->frame_sizing.max_size = BSL_CORE_MAX_DATA_SIZE;
+			error = device_initialize_core(object_p, password);
+		}
+		else {
+			object_p->protocol = device_protocol_legacy;
+			object_p->frame_sizing.max_size = BSL_MAX_BLOCK_SIZE;
+			error = device_initialize_legacy(object_p, password);
+		}
+		object_p->frame_sizing.size = object_p->frame_sizing.max_size;
+		device_set_default_geometry(object_p);
+	}
+
+	if (!error) {
+		// Go as fast as the target and the adapter allow.
+		error = device_negotiate_baudrate(object_p, password);
+	}
+
+	return error;
+}
+
+static int device_initialize_legacy(device_object_t * object_p, const unsigned char * password)
 {
 	int error = 0;
 
 	if (!error) {
-		// Start the bsl.
+		// Start the bsl again, the core command confused it.
 		error = bsl_initialize(object_p->bsl_object_p);
 	}
 
@@ -67,22 +247,6 @@ int device_initialize(device_object_t * object_p, const unsigned char * password
 		}
 	}
 
-	if (!error) {
-		bsl_baudrate_settings baudrate_settings = {0x80, 0x8C, bsl_baudrate_38400};
-
-		// Increase the baudrate on the device.
-		error = bsl_change_baudrate(object_p->bsl_object_p, baudrate_settings);
-		if (error)
-		{
-			fprintf(stderr, "Changing the baudrate to 38400 baud failed.\n");
-		}
-	}
-
-	if (!error) {
-		// Increase the serial baudrate.
-		serial_change_baudrate(object_p->bsl_object_p->fd, baudrate_38400);
-	}
-
 	if (!error) {
 		// Read the Chip ID.
 		unsigned char chip_id_data[2];
@@ -97,6 +261,42 @@ int device_initialize(device_object_t * object_p, const unsigned char * password
 		object_p->bsl_version = bsl_version_data[0] * 256 + bsl_version_data[1];
 	}
 
+	if (!error) {
+		size_t i;
+
+		// The clock settings of a faster rate depend on the family, older BSLs cannot change the rate at all.
+		object_p->clock_settings = NULL;
+		for (i = 0; i < sizeof(device_clock_tables) / sizeof(device_clock_tables[0]); i++) {
+			if ((device_clock_tables[i].family == object_p->chip_id / 256)
+					&& (object_p->bsl_version >= DEVICE_CHANGE_BAUDRATE_VERSION)) {
+				object_p->clock_settings = device_clock_tables[i].settings;
+			}
+		}
+	}
+
+	return error;
+}
+
+static int device_initialize_core(device_object_t * object_p, const unsigned char * password)
+{
+	int error = 0;
+
+	if (password) {
+		// Send the password.
+		error = bsl_core_rx_password(object_p->bsl_object_p, password);
+		if (error)
+		{
+			fprintf(stderr, "Sending password failed, device is possibly mass erased.\n");
+		}
+	}
+
+	if (!error) {
+		// Read the device ID from the TLV structure.
+		unsigned char chip_id_data[2];
+		error = bsl_core_tx_data_block(object_p->bsl_object_p, DEVICE_CORE_CHIP_ID_ADDRESS, chip_id_data, 2);
+		object_p->chip_id = chip_id_data[0] * 256 + chip_id_data[1];
+	}
+
 	return error;
 }
 
@@ -116,75 +316,1607 @@ unsigned int device_get_bsl_version(device_object_t * object_p)
 	return object_p->bsl_version;
 }
 
-int device_read_memory(device_object_t * object_p, unsigned short address, unsigned char * data, size_t length)
+device_protocol device_get_protocol(device_object_t * object_p)
+{
+	return object_p->protocol;
+}
+
+unsigned int device_get_baudrate(device_object_t * object_p)
+{
+	return object_p->bsl_object_p->timing.baudrate;
+}
+
+void device_set_max_baudrate(device_object_t * object_p, unsigned int baudrate)
+{
+	object_p->max_baudrate = baudrate;
+}
+
+void device_get_geometry(device_object_t * object_p, device_geometry_t * geometry_p)
+{
+	*geometry_p = object_p->geometry;
+}
+
+int device_set_geometry(device_object_t * object_p, const device_geometry_t * geometry_p)
 {
 	int error = 0;
-	size_t i;
 
-	// Maximum of 250 bytes can be read at a time.
-	for (i = 0; (i < length) && !error; i += 250) {
+	// Segments are aligned powers of two that fit the segment buffers.
+	if ((geometry_p->main_segment_size == 0) || (geometry_p->main_segment_size > DEVICE_MAX_SEGMENT_SIZE)
+			|| ((geometry_p->main_segment_size & (geometry_p->main_segment_size - 1)) != 0)
+			|| (geometry_p->info_segment_size == 0) || (geometry_p->info_segment_size > DEVICE_MAX_SEGMENT_SIZE)
+			|| ((geometry_p->info_segment_size & (geometry_p->info_segment_size - 1)) != 0)
+			|| (geometry_p->main_end & (geometry_p->main_segment_size - 1))
+			|| ((geometry_p->info_start | geometry_p->info_end | geometry_p->segment_a) & (geometry_p->info_segment_size - 1))) {
+		fprintf(stderr, "Segment sizes should be powers of two up to %d bytes that align the memory.\n", DEVICE_MAX_SEGMENT_SIZE);
+		error = 1;
+	}
+	else {
+		object_p->geometry = *geometry_p;
+	}
+
+	return error;
+}
+
+void device_get_default_retry_policy(device_retry_policy_t * policy_p)
+{
+	policy_p->max_attempts = DEVICE_RETRY_MAX_ATTEMPTS;
+	policy_p->initial_backoff = DEVICE_RETRY_INITIAL_BACKOFF;
+	policy_p->max_backoff = DEVICE_RETRY_MAX_BACKOFF;
+	policy_p->resync_after = DEVICE_RETRY_RESYNC_AFTER;
+	policy_p->fallback_after = DEVICE_RETRY_FALLBACK_AFTER;
+}
+
+void device_set_retry_policy(device_object_t * object_p, const device_retry_policy_t * policy_p)
+{
+	object_p->retry_policy = *policy_p;
+}
+
+void device_get_statistics(device_object_t * object_p, device_statistics_t * statistics_p)
+{
+	*statistics_p = object_p->statistics;
+}
+
+void device_clear_statistics(device_object_t * object_p)
+{
+	memset(&object_p->statistics, 0, sizeof(object_p->statistics));
+}
+
+int device_read_memory(device_object_t * object_p, unsigned long address, unsigned char * data, size_t length)
+{
+	int error = 0;
+	double start = transport_get_time(object_p->bsl_object_p->transport_p);
+
+	if (object_p->protocol == device_protocol_core) {
+		error = device_read_memory_core(object_p, address, data, length);
+	}
+	else {
+		error = device_read_memory_legacy(object_p, address, data, length);
+	}
+
+	object_p->statistics.time += transport_get_time(object_p->bsl_object_p->transport_p) - start;
+	if (!error) {
+		object_p->statistics.bytes += length;
+	}
+
+	return error;
+}
+
+int device_write_memory(device_object_t *object_p, unsigned long address, const unsigned char * data, size_t length)
+{
+	int error = 0;
+
+	error = device_program_memory(object_p, address, data, length);
+
+	if (object_p->history.path != NULL) {
+		// The segments written to are no longer known, even when the write failed half way.
+		device_forget_history(object_p, address, length);
+		device_save_history(object_p);
+	}
+
+	return error;
+}
+
+static int device_program_memory(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length)
+{
+	int error = 0;
+	double start = transport_get_time(object_p->bsl_object_p->transport_p);
+
+	if (object_p->protocol == device_protocol_core) {
+		error = device_write_memory_core(object_p, address, data, length);
+	}
+	else {
+		error = device_write_memory_legacy(object_p, address, data, length);
+	}
+
+	object_p->statistics.time += transport_get_time(object_p->bsl_object_p->transport_p) - start;
+	if (!error) {
+		object_p->statistics.bytes += length;
+	}
+
+	return error;
+}
+
+int device_erase_memory(device_object_t *object_p, device_memory_sections_t memory_sections)
+{
+	int error = 0;
+	const device_geometry_t * geometry_p = &(object_p->geometry);
+	device_range_t ranges[3];
+	size_t count = 0;
+	device_erase_plan_t plan;
 
-		// Set the maximum size
-		size_t read_size = length - i;
-		if (read_size > 250) {
-			read_size = 250;
+	if (memory_sections.main_memory) {
+		ranges[count].address = geometry_p->main_start;
+		ranges[count++].length = geometry_p->main_end - geometry_p->main_start;
+	}
+	if (memory_sections.information_memory) {
+		// The information memory around segment A.
+		ranges[count].address = geometry_p->info_start;
+		ranges[count++].length = geometry_p->segment_a - geometry_p->info_start;
+		ranges[count].address = geometry_p->segment_a + geometry_p->info_segment_size;
+		ranges[count++].length = geometry_p->info_end - (geometry_p->segment_a + geometry_p->info_segment_size);
+		if (memory_sections.segment_a) {
+			ranges[count - 1].address = geometry_p->segment_a;
+			ranges[count - 1].length += geometry_p->info_segment_size;
 		}
+	}
+
+	// Whole sections leave nothing untouched, the planner picks main or mass erases where they pay off.
+	error = device_plan_erase(object_p, ranges, count, true, &plan);
 
-		// Retrieve the data.
-		error = bsl_tx_data_block(object_p->bsl_object_p, address + i, &(data[i]), read_size);
+	if (!error) {
+		error = device_execute_erase_plan(object_p, &plan);
 	}
 
+	device_release_erase_plan(&plan);
+
 	return error;
 }
 
-int device_write_memory(device_object_t *object_p, unsigned short address, const unsigned char * data, size_t length)
+int device_update_memory(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length)
 {
 	int error = 0;
-	size_t i;
+	unsigned long end = address + length;
+	unsigned long segment_address = address;
+	device_history_segment_t * history_p;
+
+	if ((object_p->protocol == device_protocol_legacy) && (end > 0x10000)) {
+		fprintf(stderr, "Address range should be within 16 bits.\n");
+		error = 1;
+	}
+
+	if (!error && (object_p->history.path != NULL)) {
+		error = device_spot_check_history(object_p, address, length);
+
+		// A session cut short leaves no history rather than a wrong one.
+		remove(object_p->history.path);
+	}
 
-	// Maximum of 250 bytes can be read at a time.
-	for (i = 0; (i < length) && !error; i += 250) {
+	// Segment by segment, the image may start and end anywhere in one.
+	while ((segment_address < end) && !error) {
+		unsigned long segment_start;
+		size_t segment_size = device_get_segment(object_p, segment_address, &segment_start);
+		unsigned long segment_end = segment_start + segment_size;
 
-		// Set the maximum size
-		size_t write_size = length - i;
-		if (write_size > 250) {
-			write_size = 250;
+		if (segment_end > end) {
+			segment_end = end;
 		}
 
-		// Retrieve the data.
-		error = bsl_rx_data_block(object_p->bsl_object_p, address + i, &(data[i]), write_size);
+		history_p = device_find_history(object_p, segment_start);
+		error = device_update_segment(object_p, segment_start, segment_size, segment_address,
+				&(data[segment_address - address]), segment_end - segment_address,
+				(history_p != NULL) ? history_p->data : NULL);
+
+		segment_address = segment_end;
+	}
+
+	if (object_p->history.path != NULL) {
+		// The segments done before an error are still known.
+		device_save_history(object_p);
 	}
 
 	return error;
 }
 
-int device_erase_memory(device_object_t *object_p, device_memory_sections_t memory_sections)
+int device_plan_erase(device_object_t * object_p, const device_range_t * ranges, size_t count, bool keep_untouched,
+		device_erase_plan_t * plan_p)
 {
 	int error = 0;
+	const device_geometry_t * geometry_p = &(object_p->geometry);
+	// The main memory may start within a segment, 0x1100 on the ROM BSL devices.
+	unsigned long main_base = geometry_p->main_start & ~(unsigned long) (geometry_p->main_segment_size - 1);
+	size_t main_count = (geometry_p->main_end - main_base) / geometry_p->main_segment_size;
+	size_t info_count = (geometry_p->info_end - geometry_p->info_start) / geometry_p->info_segment_size;
+	size_t segment_a_index = main_count + (geometry_p->segment_a - geometry_p->info_start) / geometry_p->info_segment_size;
+	bool * touched = calloc(main_count + info_count, sizeof(bool));
+	double command_time = device_get_command_time(object_p);
+	double segment_time = command_time + geometry_p->segment_erase_time;
+	size_t main_touched = 0;
+	size_t info_touched = 0;
+	bool erase_main = false;
+	bool erase_info = false;
+	bool erase_mass = false;
+	size_t i;
+
+	plan_p->commands = NULL;
+	plan_p->count = 0;
+	plan_p->time = 0;
 
-	if (memory_sections.main_memory && memory_sections.information_memory && memory_sections.segment_a) {
-		// In case all memory sections can be erased, just do a mass erase.
-		error = bsl_mass_erase(object_p->bsl_object_p);
+	if (touched == NULL) {
+		fprintf(stderr, "Failed to allocate memory for the erase plan.\n");
+		error = 1;
 	}
-	else
-	{
-		if (memory_sections.main_memory) {
-			error = bsl_erase_main_info(object_p->bsl_object_p, DEVICE_MAIN_MEMORY_ADDRESS);
+
+	// Mark the segments the ranges touch, what lies outside the flash needs no erase.
+	for (i = 0; (i < count) && !error; i++) {
+		unsigned long range_end = ranges[i].address + ranges[i].length;
+
+		main_touched += device_mark_segments(touched, main_base, geometry_p->main_end, geometry_p->main_segment_size,
+				(ranges[i].address > geometry_p->main_start) ? ranges[i].address : geometry_p->main_start, range_end);
+		info_touched += device_mark_segments(&(touched[main_count]), geometry_p->info_start, geometry_p->info_end,
+				geometry_p->info_segment_size, ranges[i].address, range_end);
+	}
+
+	if (!error) {
+		double main_time = main_touched * segment_time;
+		double info_time = info_touched * segment_time;
+		double main_erase_time = command_time + ((object_p->protocol == device_protocol_core)
+				? geometry_p->mass_erase_time : geometry_p->region_erase_time);
+		double info_erase_time = command_time + geometry_p->region_erase_time;
+		// A region erase may only clear untouched segments if they are not needed, and never segment A.
+		bool main_allowed = (main_touched > 0) && (!keep_untouched || (main_touched == main_count));
+		bool info_allowed = (object_p->protocol == device_protocol_legacy) && touched[segment_a_index]
+				&& (!keep_untouched || (info_touched == info_count));
+
+		if ((object_p->protocol == device_protocol_core) && touched[segment_a_index]) {
+			// Unlocking segment A and locking it again.
+			info_time += 2 * command_time;
 		}
-		if (memory_sections.information_memory)
-		{
-			if (memory_sections.segment_a) {
-				// In case segment A can be erased, do a full wipe of the information memory.
-				error = bsl_erase_main_info(object_p->bsl_object_p, DEVICE_INFORMATION_MEMORY_ADDRESS);
+
+		// Choose whichever is faster, a segment erase costs a command on the link as well.
+		if (main_allowed && (main_erase_time < main_time)) {
+			erase_main = true;
+			main_time = main_erase_time;
+		}
+		if (info_allowed && (info_erase_time < info_time)) {
+			erase_info = true;
+			info_time = info_erase_time;
+		}
+		if ((object_p->protocol == device_protocol_legacy) && main_allowed && info_allowed
+				&& (command_time + geometry_p->mass_erase_time < main_time + info_time)) {
+			erase_mass = true;
+		}
+
+		plan_p->commands = malloc((main_touched + info_touched + 1) * sizeof(device_erase_command_t));
+		if (plan_p->commands == NULL) {
+			fprintf(stderr, "Failed to allocate memory for the erase plan.\n");
+			error = 1;
+		}
+		else if (erase_mass) {
+			device_add_erase_command(plan_p, device_erase_mass, 0, command_time + geometry_p->mass_erase_time);
+		}
+		else {
+			if (erase_info) {
+				device_add_erase_command(plan_p, device_erase_information, geometry_p->info_start, info_erase_time);
 			}
-			else {
-				// Otherwise just erase the other segments in the information memory.
-				error = bsl_erase_segment(object_p->bsl_object_p, DEVICE_SEGMENT_B_ADDRESS);
-				error = bsl_erase_segment(object_p->bsl_object_p, DEVICE_SEGMENT_C_ADDRESS);
-				error = bsl_erase_segment(object_p->bsl_object_p, DEVICE_SEGMENT_D_ADDRESS);
+			for (i = 0; (i < info_count) && !erase_info; i++) {
+				if (touched[main_count + i]) {
+					device_add_erase_command(plan_p, device_erase_segment,
+							geometry_p->info_start + i * geometry_p->info_segment_size,
+							segment_time + ((main_count + i == segment_a_index) && (object_p->protocol == device_protocol_core)
+									? 2 * command_time : 0));
+				}
+			}
+
+			// The core BSL clears the main memory with its mass erase.
+			if (erase_main) {
+				device_add_erase_command(plan_p, (object_p->protocol == device_protocol_core) ? device_erase_mass : device_erase_main,
+						geometry_p->main_start, main_erase_time);
+			}
+			for (i = 0; (i < main_count) && !erase_main; i++) {
+				if (touched[i]) {
+					device_add_erase_command(plan_p, device_erase_segment,
+							(i > 0) ? main_base + i * geometry_p->main_segment_size : geometry_p->main_start, segment_time);
+				}
+			}
+		}
+	}
+
+	free(touched);
+
+	return error;
+}
+
+int device_execute_erase_plan(device_object_t * object_p, const device_erase_plan_t * plan_p)
+{
+	int error = 0;
+	double start = transport_get_time(object_p->bsl_object_p->transport_p);
+	unsigned long segment_start;
+	size_t segment_size;
+	size_t i;
+
+	if (object_p->protocol == device_protocol_core) {
+		error = device_execute_erase_core(object_p, plan_p);
+	}
+	else {
+		error = device_execute_erase_legacy(object_p, plan_p);
+	}
+
+	object_p->statistics.erase_time += transport_get_time(object_p->bsl_object_p->transport_p) - start;
+
+	if (object_p->history.path != NULL) {
+		// What the plan erased is no longer known, even when it failed half way.
+		for (i = 0; i < plan_p->count; i++) {
+			const device_erase_command_t * command_p = &(plan_p->commands[i]);
+
+			switch (command_p->type)
+			{
+			case device_erase_segment:
+				segment_size = device_get_segment(object_p, command_p->address, &segment_start);
+				device_forget_history(object_p, segment_start, segment_size);
+				break;
+			case device_erase_main:
+				device_forget_history(object_p, object_p->geometry.main_start,
+						object_p->geometry.main_end - object_p->geometry.main_start);
+				break;
+			case device_erase_information:
+				device_forget_history(object_p, object_p->geometry.info_start,
+						object_p->geometry.info_end - object_p->geometry.info_start);
+				break;
+			default:
+				object_p->history.count = 0;
+				break;
 			}
 		}
+		device_save_history(object_p);
+	}
+
+	return error;
+}
+
+void device_release_erase_plan(device_erase_plan_t * plan_p)
+{
+	free(plan_p->commands);
+	plan_p->commands = NULL;
+	plan_p->count = 0;
+	plan_p->time = 0;
+}
+
+int device_check_blank(device_object_t * object_p, unsigned long address, size_t length, unsigned long * non_blank_p)
+{
+	int error = 0;
+
+	*non_blank_p = address + length;
+
+	if ((object_p->protocol == device_protocol_legacy) && (address + length > 0x10000)) {
+		fprintf(stderr, "Address range should be within 16 bits.\n");
+		error = 1;
+	}
+	else if ((object_p->protocol == device_protocol_legacy) && ((address % 2) || (length % 2))) {
+		fprintf(stderr, "The ROM BSL checks whole words, address and length should be even.\n");
+		error = 1;
+	}
+	else if ((object_p->protocol == device_protocol_legacy) && (object_p->bsl_version < DEVICE_ERASE_CHECK_VERSION)) {
+		// Older ROM BSLs have no erase check.
+		error = device_scan_blank(object_p, address, length, non_blank_p);
+	}
+	else {
+		error = device_search_blank(object_p, address, length, non_blank_p);
+	}
+
+	return error;
+}
+
+int device_verify_memory(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length,
+		const unsigned char * password)
+{
+	int error = 0;
+	double start = transport_get_time(object_p->bsl_object_p->transport_p);
+
+	if (length == 0) {
+		// Nothing to check.
+	}
+	else if (object_p->protocol == device_protocol_core) {
+		error = device_check_crc(object_p, address, data, length);
+	}
+	else if (address + length > 0x10000) {
+		fprintf(stderr, "Address range should be within 16 bits.\n");
+		error = 1;
+	}
+	else if ((address % 2) || (length % 2)) {
+		fprintf(stderr, "The helper checks whole words, address and length should be even.\n");
+		error = 1;
+	}
+	else if (password == NULL) {
+		fprintf(stderr, "The BSL is locked after the helper, the password is needed.\n");
+		error = 1;
+	}
+	else {
+		error = device_verify_memory_legacy(object_p, address, data, length, password);
+	}
+
+	object_p->statistics.verify_time += transport_get_time(object_p->bsl_object_p->transport_p) - start;
+
+	return error;
+}
+
+int device_open_history(device_object_t * object_p, const char * directory, unsigned int spot_checks)
+{
+	int error = 0;
+	unsigned char id[DEVICE_CORE_DIE_RECORD_SIZE];
+	size_t id_size = 0;
+
+	device_close_history(object_p);
+
+	error = device_read_unique_id(object_p, id, &id_size);
+
+	if (!error) {
+		// The chip ID and the unique ID in hexadecimal name the file.
+		object_p->history.path = malloc(strlen(directory) + 6 + 2 * id_size + sizeof(DEVICE_HISTORY_EXTENSION));
+		if (object_p->history.path == NULL) {
+			fprintf(stderr, "Failed to allocate memory for the history file name.\n");
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		char * name_p = object_p->history.path;
+		size_t i;
+
+		name_p += sprintf(name_p, "%s/%04x-", directory, object_p->chip_id & 0xFFFF);
+		for (i = 0; i < id_size; i++) {
+			name_p += sprintf(name_p, "%02x", id[i]);
+		}
+		strcpy(name_p, DEVICE_HISTORY_EXTENSION);
+
+		object_p->history.spot_checks = spot_checks;
+		error = device_load_history(object_p);
+	}
+
+	if (error) {
+		device_close_history(object_p);
+	}
+
+	return error;
+}
+
+void device_close_history(device_object_t * object_p)
+{
+	free(object_p->history.path);
+	free(object_p->history.segments);
+	object_p->history.path = NULL;
+	object_p->history.segments = NULL;
+	object_p->history.count = 0;
+	object_p->history.size = 0;
+}
+
+static int device_read_memory_legacy(device_object_t * object_p, unsigned long address, unsigned char * data, size_t length)
+{
+	int error = 0;
+	size_t read_size = 0;
+	size_t i;
+
+	if (address + length > 0x10000) {
+		fprintf(stderr, "Address range should be within 16 bits.\n");
+		error = 1;
+	}
+
+	// Frames of at most 250 bytes, sized for the error rate of the link.
+	for (i = 0; (i < length) && !error; i += read_size) {
+		unsigned int attempts = 0;
+
+		// Retrieve the data, a failed block is read again, in smaller frames if the link gets worse.
+		do {
+			read_size = device_get_frame_size(object_p, length - i);
+			error = bsl_tx_data_block(object_p->bsl_object_p, address + i, &(data[i]), read_size);
+			device_update_frame_size(object_p, read_size, error);
+		} while (error && device_recover(object_p, error, &attempts));
+		object_p->statistics.blocks++;
 	}
 
 	return error;
 }
+
+static int device_write_memory_legacy(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length)
+{
+	int error = 0;
+	size_t write_size = 0;
+	size_t i;
+
+	if (address + length > 0x10000) {
+		fprintf(stderr, "Address range should be within 16 bits.\n");
+		error = 1;
+	}
+
+	// Frames of at most 250 bytes, sized for the error rate of the link.
+	for (i = 0; (i < length) && !error; i += write_size) {
+		unsigned int attempts = 0;
+
+		// Write the data, a failed block is written again, in smaller frames if the link gets worse.
+		do {
+			write_size = device_get_frame_size(object_p, length - i);
+			error = bsl_rx_data_block(object_p->bsl_object_p, address + i, &(data[i]), write_size);
+			device_update_frame_size(object_p, write_size, error);
+		} while (error && device_recover(object_p, error, &attempts));
+		object_p->statistics.blocks++;
+	}
+
+	return error;
+}
+
+static int device_verify_memory_legacy(device_object_t * object_p, unsigned long address, const unsigned char * data,
+		size_t length, const unsigned char * password)
+{
+	int error = 0;
+	transport_t * transport_p = object_p->bsl_object_p->transport_p;
+	unsigned char helper[sizeof(device_checksum_helper)];
+	unsigned long result_address = DEVICE_HELPER_ADDRESS + DEVICE_HELPER_RESULT_OFFSET;
+	unsigned char result[4];
+	unsigned int sum = 0;
+	unsigned short xor16 = checksum_xor16(0, data, length);
+	unsigned int attempts = 0;
+	size_t i;
+
+	for (i = 0; i < sizeof(device_checksum_helper) / 2; i++) {
+		helper[2 * i] = device_checksum_helper[i] % 256;
+		helper[2 * i + 1] = device_checksum_helper[i] / 256;
+	}
+
+	// Fill in the range and where the results go.
+	helper[2] = address % 256;
+	helper[3] = address / 256;
+	helper[6] = (length / 2) % 256;
+	helper[7] = (length / 2) / 256;
+	helper[24] = result_address % 256;
+	helper[25] = result_address / 256;
+	helper[28] = (result_address + 2) % 256;
+	helper[29] = (result_address + 2) / 256;
+
+	error = device_program_memory(object_p, DEVICE_HELPER_ADDRESS, helper, sizeof(helper));
+
+	if (!error) {
+		error = bsl_load_pc(object_p->bsl_object_p, DEVICE_HELPER_ADDRESS);
+	}
+
+	if (!error) {
+		// Nothing listens while the helper runs, the BSL it returns to is locked and at 9600 baud.
+		transport_sleep_until(transport_p, transport_get_time(transport_p)
+				+ (double) (length / 2) * DEVICE_HELPER_CYCLES_PER_WORD / DEVICE_HELPER_MIN_CLOCK);
+		bsl_resynchronize(object_p->bsl_object_p);
+		object_p->bsl_object_p->timing.baudrate = baudrate_9600;
+		error = transport_set_baudrate(transport_p, baudrate_9600);
+	}
+
+	if (!error) {
+		// A slow clock makes the helper take longer, the first attempts may go unanswered.
+		do {
+			error = bsl_rx_password(object_p->bsl_object_p, password);
+		} while (error && device_recover(object_p, error, &attempts));
+	}
+
+	if (!error) {
+		error = bsl_tx_data_block(object_p->bsl_object_p, result_address, result, sizeof(result));
+	}
+
+	if (!error) {
+		for (i = 0; i < length; i += 2) {
+			sum += data[i] + data[i + 1] * 256;
+		}
+
+		if (((unsigned int) (result[0] + result[1] * 256) != sum % 0x10000)
+				|| ((unsigned int) (result[2] + result[3] * 256) != xor16)) {
+			fprintf(stderr, "Verification of 0x%04lx to 0x%04lx failed.\n", address, address + length - 1);
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		// Back to the rate of the session.
+		error = device_negotiate_baudrate(object_p, password);
+	}
+
+	return error;
+}
+
+static int device_read_memory_core(device_object_t * object_p, unsigned long address, unsigned char * data, size_t length)
+{
+	int error = 0;
+	size_t read_size = 0;
+	size_t i;
+
+	// Frames of at most 256 bytes, sized for the error rate of the link.
+	for (i = 0; (i < length) && !error; i += read_size) {
+		unsigned int attempts = 0;
+
+		do {
+			read_size = device_get_frame_size(object_p, length - i);
+			error = bsl_core_tx_data_block(object_p->bsl_object_p, address + i, &(data[i]), read_size);
+			device_update_frame_size(object_p, read_size, error);
+		} while (error && device_recover(object_p, error, &attempts));
+		object_p->statistics.blocks++;
+	}
+
+	return error;
+}
+
+static int device_write_memory_core(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length)
+{
+	int error = 0;
+	size_t write_size = 0;
+	size_t i;
+
+	// Stream the data in blocks of at most 256 bytes, the BSL only acknowledges them.
+	for (i = 0; (i < length) && !error; i += write_size) {
+		unsigned int attempts = 0;
+
+		// Writing the same data again leaves the flash as it is, a failed block is simply sent again.
+		do {
+			write_size = device_get_frame_size(object_p, length - i);
+			error = bsl_core_rx_data_block_fast(object_p->bsl_object_p, address + i, &(data[i]), write_size);
+			device_update_frame_size(object_p, write_size, error);
+		} while (error && device_recover(object_p, error, &attempts));
+		object_p->statistics.blocks++;
+	}
+
+	if (!error) {
+		// Let the target check what ended up in memory.
+		error = device_check_crc(object_p, address, data, length);
+	}
+
+	return error;
+}
+
+static int device_check_crc(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length)
+{
+	int error = 0;
+	size_t i;
+
+	// The CRC command covers at most 32 KB.
+	for (i = 0; (i < length) && !error; i += DEVICE_CORE_CRC_RANGE) {
+		unsigned int attempts = 0;
+		unsigned short crc = 0;
+		size_t check_size = length - i;
+		if (check_size > DEVICE_CORE_CRC_RANGE) {
+			check_size = DEVICE_CORE_CRC_RANGE;
+		}
+
+		do {
+			error = bsl_core_crc_check(object_p->bsl_object_p, address + i, check_size, &crc);
+		} while (error && device_recover(object_p, error, &attempts));
+
+		if (!error && (crc != checksum_crc16(0xFFFF, &(data[i]), check_size))) {
+			fprintf(stderr, "Verification of 0x%05lx to 0x%05lx failed.\n", address + i, address + i + check_size - 1);
+			error = 1;
+		}
+	}
+
+	return error;
+}
+
+static bool device_recover(device_object_t * object_p, int error, unsigned int * attempts_p)
+{
+	const device_retry_policy_t * policy_p = &object_p->retry_policy;
+	bool retry;
+
+	(*attempts_p)++;
+
+	// A command the BSL rejected fails again, only errors of the link are worth another attempt.
+	retry = (error != bsl_error_failed) && (*attempts_p < policy_p->max_attempts);
+
+	if (!retry) {
+		object_p->statistics.failures++;
+	}
+	else {
+		double backoff = policy_p->initial_backoff;
+		unsigned int i;
+
+		object_p->statistics.retries++;
+
+		// Back off exponentially, the BSL may still be busy with the failed command.
+		for (i = 1; (i < *attempts_p) && (backoff < policy_p->max_backoff); i++) {
+			backoff *= 2;
+		}
+		if (backoff > policy_p->max_backoff) {
+			backoff = policy_p->max_backoff;
+		}
+		device_back_off(object_p, backoff);
+
+		if ((policy_p->resync_after > 0) && (*attempts_p >= policy_p->resync_after)) {
+			// Drop whatever is left of the failed answer, the next command starts clean.
+			bsl_resynchronize(object_p->bsl_object_p);
+			object_p->statistics.resyncs++;
+		}
+
+		if ((policy_p->fallback_after > 0) && ((*attempts_p % policy_p->fallback_after) == 0)) {
+			if (!device_lower_baudrate(object_p)) {
+				object_p->statistics.baudrate_fallbacks++;
+			}
+		}
+	}
+
+	return retry;
+}
+
+static size_t device_get_frame_size(device_object_t * object_p, size_t remaining)
+{
+	size_t size = object_p->frame_sizing.size;
+
+	if ((object_p->statistics.min_frame_size == 0) || (size < object_p->statistics.min_frame_size)) {
+		object_p->statistics.min_frame_size = size;
+	}
+	if (size > object_p->statistics.max_frame_size) {
+		object_p->statistics.max_frame_size = size;
+	}
+
+	// The last frame of a range only takes what is left.
+	if (remaining < size) {
+		size = remaining;
+	}
+
+	return size;
+}
+
+static void device_update_frame_size(device_object_t * object_p, size_t size, int error)
+{
+	device_frame_sizing_t * sizing_p = &object_p->frame_sizing;
+	const bsl_timing_t * timing_p = &object_p->bsl_object_p->timing;
+	double byte_time = (double) DEVICE_BITS_PER_BYTE / timing_p->baudrate;
+	double byte_error_rate;
+	double best_goodput = 0;
+	size_t best_size = sizing_p->max_size;
+
+	if (error != bsl_error_failed) {
+		// A rolling rate of frames corrupted per byte on the wire, only link errors count.
+		sizing_p->errors = DEVICE_FRAME_ERROR_DECAY * sizing_p->errors + (error ? 1 : 0);
+		sizing_p->bytes = DEVICE_FRAME_ERROR_DECAY * sizing_p->bytes + size + DEVICE_FRAME_OVERHEAD;
+	}
+
+	byte_error_rate = (sizing_p->bytes > 0) ? sizing_p->errors / sizing_p->bytes : 0;
+
+	if (byte_error_rate > 0) {
+		// Round trip and retry costs, in character times.
+		double round_trip = timing_p->latency / byte_time;
+		double retry = (bsl_get_timeout_margin(object_p->bsl_object_p) + object_p->retry_policy.initial_backoff) / byte_time;
+		double byte_success = (byte_error_rate < 1) ? 1 - byte_error_rate : 0;
+		double success = 1;
+		size_t n;
+
+		for (n = 0; n < sizing_p->min_size + DEVICE_FRAME_OVERHEAD; n++) {
+			success *= byte_success;
+		}
+
+		// Pick the even size with the highest expected goodput, frames that fail are sent again.
+		for (n = sizing_p->min_size; n <= sizing_p->max_size; n += 2) {
+			double goodput = 0;
+
+			if (success > 0) {
+				goodput = n * success / (n + DEVICE_FRAME_OVERHEAD + round_trip + (1 - success) * retry);
+			}
+			if (goodput > best_goodput) {
+				best_goodput = goodput;
+				best_size = n;
+			}
+
+			success *= byte_success * byte_success;
+		}
+
+		if (best_goodput == 0) {
+			best_size = sizing_p->min_size;
+		}
+	}
+
+	sizing_p->size = best_size;
+}
+
+static void device_back_off(device_object_t * object_p, double backoff)
+{
+	transport_t * transport_p = object_p->bsl_object_p->transport_p;
+	double deadline = transport_get_time(transport_p) + backoff;
+	unsigned char data[64];
+	int read_size;
+
+	// Wait by reading, what arrives of the failed answer is gone before the retry.
+	do {
+		read_size = transport_read(transport_p, data, sizeof(data), deadline - transport_get_time(transport_p));
+	} while ((read_size == sizeof(data)) && (transport_get_time(transport_p) < deadline));
+
+	transport_sleep_until(transport_p, deadline);
+}
+
+static int device_lower_baudrate(device_object_t * object_p)
+{
+	int error = 0;
+	size_t count = device_get_baudrate_count(object_p);
+	size_t i = 0;
+
+	while ((i < count) && (device_baudrates[i] != object_p->bsl_object_p->timing.baudrate)) {
+		i++;
+	}
+
+	if ((i == 0) || (i == count)) {
+		// Already at the lowest rate.
+		error = 1;
+	}
+	else {
+		error = device_change_baudrate(object_p, i - 1);
+	}
+
+	if (!error) {
+		fprintf(stderr, "Link errors, continuing at %u baud.\n", device_baudrates[i - 1]);
+	}
+
+	return error;
+}
+
+static int device_negotiate_baudrate(device_object_t * object_p, const unsigned char * password)
+{
+	int error = 0;
+	size_t count = device_get_baudrate_count(object_p);
+	size_t good = 0;
+	size_t i;
+
+	// Step up one rate at a time, a read of the chip ID proves each one.
+	for (i = 1; (i < count) && (device_baudrates[i] <= object_p->max_baudrate) && !error; i++) {
+		error = device_change_baudrate(object_p, i);
+		if (!error) {
+			error = device_test_link(object_p);
+		}
+		if (!error) {
+			good = i;
+		}
+	}
+
+	if (error) {
+		// The target may be stuck at the rate that failed, start it over and go straight to the last good one.
+		fprintf(stderr, "The link does not sustain %u baud.\n", device_baudrates[good + 1]);
+		error = device_restart(object_p, password);
+		if (!error && (good > 0)) {
+			error = device_change_baudrate(object_p, good);
+		}
+		if (!error) {
+			error = device_test_link(object_p);
+		}
+	}
+
+	return error;
+}
+
+static size_t device_get_baudrate_count(device_object_t * object_p)
+{
+	size_t count = 1;
+
+	if (object_p->protocol == device_protocol_core) {
+		count = sizeof(device_baudrates) / sizeof(device_baudrates[0]);
+	}
+	else if (object_p->clock_settings != NULL) {
+		count = bsl_baudrate_38400 + 1;
+	}
+
+	return count;
+}
+
+static int device_change_baudrate(device_object_t * object_p, size_t index)
+{
+	int error = 0;
+
+	// The target acknowledges at the old rate and switches, then the adapter follows.
+	if (object_p->protocol == device_protocol_core) {
+		error = bsl_core_change_baudrate(object_p->bsl_object_p, (bsl_core_baudrate) index);
+	}
+	else {
+		error = bsl_change_baudrate(object_p->bsl_object_p, object_p->clock_settings[index]);
+	}
+
+	if (!error) {
+		error = transport_set_baudrate(object_p->bsl_object_p->transport_p, device_baudrates[index]);
+	}
+
+	return error;
+}
+
+static int device_test_link(device_object_t * object_p)
+{
+	int error = 0;
+	unsigned char chip_id_data[2];
+
+	if (object_p->protocol == device_protocol_core) {
+		error = bsl_core_tx_data_block(object_p->bsl_object_p, DEVICE_CORE_CHIP_ID_ADDRESS, chip_id_data, 2);
+	}
+	else {
+		error = bsl_tx_data_block(object_p->bsl_object_p, DEVICE_CHIP_ID_ADDRESS, chip_id_data, 2);
+	}
+
+	if (!error && ((unsigned int) (chip_id_data[0] * 256 + chip_id_data[1]) != object_p->chip_id)) {
+		fprintf(stderr, "Read a different chip ID.\n");
+		error = 1;
+	}
+
+	return error;
+}
+
+static int device_restart(device_object_t * object_p, const unsigned char * password)
+{
+	int error = 0;
+
+	// Drop what is left of the garbled answers, the BSL starts at 9600 baud.
+	bsl_resynchronize(object_p->bsl_object_p);
+	error = transport_set_baudrate(object_p->bsl_object_p->transport_p, baudrate_9600);
+
+	if (!error && (object_p->protocol == device_protocol_core)) {
+		error = bsl_run_entry_sequence(object_p->bsl_object_p);
+		if (!error && password) {
+			error = bsl_core_rx_password(object_p->bsl_object_p, password);
+		}
+	}
+	else if (!error) {
+		error = bsl_initialize(object_p->bsl_object_p);
+		if (!error && password) {
+			error = bsl_rx_password(object_p->bsl_object_p, password);
+		}
+	}
+
+	return error;
+}
+
+static size_t device_get_segment(device_object_t * object_p, unsigned long address, unsigned long * start_p)
+{
+	const device_geometry_t * geometry_p = &(object_p->geometry);
+	size_t size = geometry_p->main_segment_size;
+	unsigned long start;
+	unsigned long end;
+
+	if ((address >= geometry_p->info_start) && (address < geometry_p->info_end)) {
+		size = geometry_p->info_segment_size;
+	}
+
+	start = address & ~(unsigned long) (size - 1);
+	end = start + size;
+
+	// The main memory may start within a segment, 0x1100 on the ROM BSL devices, that part is erased at main_start.
+	if ((address >= geometry_p->main_start) && (address < geometry_p->main_end)) {
+		if (start < geometry_p->main_start) {
+			start = geometry_p->main_start;
+		}
+		if (end > geometry_p->main_end) {
+			end = geometry_p->main_end;
+		}
+	}
+
+	*start_p = start;
+
+	return end - start;
+}
+
+static int device_update_segment(device_object_t * object_p, unsigned long segment_start, size_t segment_size,
+		unsigned long address, const unsigned char * data, size_t length, const unsigned char * contents)
+{
+	int error = 0;
+	unsigned char segment[DEVICE_MAIN_SEGMENT_SIZE];
+	size_t offset = address - segment_start;
+	size_t first = segment_size;
+	size_t last = 0;
+	bool compare = true;
+	bool blank = true;
+	size_t i;
+
+	object_p->statistics.segments_compared++;
+
+	if (contents != NULL) {
+		// The history knows what the segment holds, nothing needs to be read.
+		memcpy(segment, contents, segment_size);
+		object_p->statistics.segments_recalled++;
+	}
+	else if ((object_p->protocol == device_protocol_core) && (length == segment_size)) {
+		unsigned short crc = 0;
+
+		// The BSL hashes the segment, only a difference is worth reading it.
+		error = bsl_core_crc_check(object_p->bsl_object_p, segment_start, segment_size, &crc);
+		if (!error && (crc == checksum_crc16(0xFFFF, data, length))) {
+			compare = false;
+		}
+		else if (!error) {
+			error = device_read_memory(object_p, segment_start, segment, segment_size);
+		}
+	}
+	else {
+		error = device_read_memory(object_p, segment_start, segment, segment_size);
+	}
+
+	// Find the words that differ, and whether they are still erased.
+	for (i = 0; (i < length) && compare && !error; i++) {
+		if (segment[offset + i] != data[i]) {
+			if (first == segment_size) {
+				first = (offset + i) & ~(size_t) 1;
+			}
+			last = (offset + i) | 1;
+			if (segment[offset + i] != 0xFF) {
+				blank = false;
+			}
+		}
+	}
+
+	if (!error && (first < segment_size)) {
+		memcpy(&(segment[offset]), data, length);
+
+		if (segment_start == object_p->geometry.segment_a) {
+			// It holds calibration data and is locked.
+			fprintf(stderr, "Segment A differs from the image, it is only erased on request.\n");
+			error = 1;
+		}
+		else if (blank) {
+			// Flash only needs an erase to turn bits back to 1, the changed words can be programmed as they are.
+			error = device_program_memory(object_p, segment_start + first, &(segment[first]), last + 1 - first);
+
+			// Whole words are programmed, only the bytes of the image count.
+			if (first < offset) {
+				first = offset;
+			}
+			if (last >= offset + length) {
+				last = offset + length - 1;
+			}
+			object_p->statistics.bytes_skipped += length - (last + 1 - first);
+		}
+		else {
+			// Erase the segment and program all of it, what lies outside the image is kept.
+			unsigned int attempts = 0;
+
+			do {
+				if (object_p->protocol == device_protocol_core) {
+					error = bsl_core_erase_segment(object_p->bsl_object_p, segment_start);
+				}
+				else {
+					error = bsl_erase_segment(object_p->bsl_object_p, segment_start);
+				}
+			} while (error && device_recover(object_p, error, &attempts));
+
+			// Words that stay erased need no programming.
+			first = 0;
+			last = segment_size - 1;
+			while ((first < last) && (segment[first] == 0xFF) && (segment[first + 1] == 0xFF)) {
+				first += 2;
+			}
+			while ((last > first) && (segment[last] == 0xFF) && (segment[last - 1] == 0xFF)) {
+				last -= 2;
+			}
+
+			if (!error && (first < last)) {
+				error = device_program_memory(object_p, segment_start + first, &(segment[first]), last + 1 - first);
+			}
+			object_p->statistics.segments_rewritten++;
+		}
+	}
+	else if (!error) {
+		object_p->statistics.bytes_skipped += length;
+	}
+
+	if ((object_p->history.path != NULL) && error) {
+		device_forget_history(object_p, segment_start, segment_size);
+	}
+	else if (object_p->history.path != NULL) {
+		// Without a compare the CRC matched, the image is the whole segment.
+		error = device_remember_segment(object_p, segment_start, segment_size, compare ? segment : data);
+	}
+
+	return error;
+}
+
+static int device_read_unique_id(device_object_t * object_p, unsigned char * id, size_t * size_p)
+{
+	int error = 0;
+
+	if (object_p->protocol == device_protocol_core) {
+		// Lot, wafer and die position from the die record of the TLV structure.
+		error = device_read_memory(object_p, DEVICE_CORE_DIE_RECORD_ADDRESS, id, DEVICE_CORE_DIE_RECORD_SIZE);
+		*size_p = DEVICE_CORE_DIE_RECORD_SIZE;
+	}
+	else {
+		unsigned char segment_a[DEVICE_INFO_SEGMENT_SIZE];
+		unsigned short crc;
+
+		// The ROM BSL devices have no serial number, the calibration data in segment A tells them apart.
+		error = device_read_memory(object_p, DEVICE_SEGMENT_A_ADDRESS, segment_a, DEVICE_INFO_SEGMENT_SIZE);
+		crc = checksum_crc16(0xFFFF, segment_a, DEVICE_INFO_SEGMENT_SIZE);
+		id[0] = crc / 256;
+		id[1] = crc % 256;
+		*size_p = 2;
+	}
+
+	return error;
+}
+
+static int device_load_history(device_object_t * object_p)
+{
+	int error = 0;
+	FILE * file;
+	unsigned char magic[sizeof(DEVICE_HISTORY_MAGIC) - 1];
+	unsigned char record[DEVICE_HISTORY_RECORD_SIZE];
+	unsigned char data[DEVICE_MAX_SEGMENT_SIZE];
+	bool valid = true;
+
+	object_p->history.count = 0;
+
+	// A device without a file has no history yet.
+	file = fopen(object_p->history.path, "rb");
+
+	if (file != NULL) {
+		if ((fread(magic, 1, sizeof(magic), file) != sizeof(magic))
+				|| (memcmp(magic, DEVICE_HISTORY_MAGIC, sizeof(magic)) != 0)) {
+			valid = false;
+		}
+
+		// Records of a little endian address, a size and the contents of a segment.
+		while (valid && !error && (fread(record, 1, DEVICE_HISTORY_RECORD_SIZE, file) == DEVICE_HISTORY_RECORD_SIZE)) {
+			unsigned long address = record[0] + (record[1] << 8) + ((unsigned long) record[2] << 16) + ((unsigned long) record[3] << 24);
+			size_t size = record[4] + (record[5] << 8);
+			unsigned long start;
+
+			if ((size != device_get_segment(object_p, address, &start)) || (start != address)
+					|| (fread(data, 1, size, file) != size)) {
+				valid = false;
+			}
+			else {
+				error = device_remember_segment(object_p, address, size, data);
+			}
+		}
+
+		if (!valid) {
+			fprintf(stderr, "The history file %s is damaged and is not used.\n", object_p->history.path);
+			object_p->history.count = 0;
+		}
+
+		fclose(file);
+	}
+
+	return error;
+}
+
+static int device_save_history(device_object_t * object_p)
+{
+	int error = 0;
+	FILE * file;
+	size_t i;
+
+	file = fopen(object_p->history.path, "wb");
+
+	if (file == NULL) {
+		error = 1;
+	}
+	else if (fwrite(DEVICE_HISTORY_MAGIC, 1, sizeof(DEVICE_HISTORY_MAGIC) - 1, file) != sizeof(DEVICE_HISTORY_MAGIC) - 1) {
+		error = 1;
+	}
+
+	for (i = 0; (i < object_p->history.count) && !error; i++) {
+		device_history_segment_t * segment_p = &(object_p->history.segments[i]);
+		unsigned char record[DEVICE_HISTORY_RECORD_SIZE] = {
+			segment_p->address % 256, (segment_p->address >> 8) % 256, (segment_p->address >> 16) % 256,
+			(segment_p->address >> 24) % 256, segment_p->size % 256, segment_p->size / 256
+		};
+
+		if ((fwrite(record, 1, DEVICE_HISTORY_RECORD_SIZE, file) != DEVICE_HISTORY_RECORD_SIZE)
+				|| (fwrite(segment_p->data, 1, segment_p->size, file) != segment_p->size)) {
+			error = 1;
+		}
+	}
+
+	if ((file != NULL) && (fclose(file) != 0)) {
+		error = 1;
+	}
+
+	if (error) {
+		// The device is fine, the next update compares by read-back.
+		fprintf(stderr, "Failed to write the history file %s.\n", object_p->history.path);
+		remove(object_p->history.path);
+	}
+
+	return error;
+}
+
+static size_t device_search_history(device_object_t * object_p, unsigned long address)
+{
+	size_t low = 0;
+	size_t high = object_p->history.count;
+
+	// Count the segments starting at or before the address.
+	while (low < high) {
+		size_t middle = (low + high) / 2;
+
+		if (object_p->history.segments[middle].address <= address) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+static device_history_segment_t * device_find_history(device_object_t * object_p, unsigned long address)
+{
+	device_history_segment_t * segment_p = NULL;
+	size_t index = device_search_history(object_p, address);
+
+	if ((index > 0) && (address < object_p->history.segments[index - 1].address + object_p->history.segments[index - 1].size)) {
+		segment_p = &(object_p->history.segments[index - 1]);
+	}
+
+	return segment_p;
+}
+
+static int device_remember_segment(device_object_t * object_p, unsigned long address, size_t size, const unsigned char * data)
+{
+	int error = 0;
+	size_t index = device_search_history(object_p, address);
+
+	if ((index > 0) && (object_p->history.segments[index - 1].address == address)) {
+		index--;
+	}
+	else {
+		if (object_p->history.count == object_p->history.size) {
+			size_t new_size = (object_p->history.size > 0) ? 2 * object_p->history.size : DEVICE_HISTORY_INITIAL_SIZE;
+			device_history_segment_t * segments = realloc(object_p->history.segments, new_size * sizeof(device_history_segment_t));
+
+			if (segments == NULL) {
+				fprintf(stderr, "Failed to allocate memory for the device history.\n");
+				error = 1;
+			}
+			else {
+				object_p->history.segments = segments;
+				object_p->history.size = new_size;
+			}
+		}
+
+		if (!error) {
+			memmove(&(object_p->history.segments[index + 1]), &(object_p->history.segments[index]),
+					(object_p->history.count - index) * sizeof(device_history_segment_t));
+			object_p->history.count++;
+		}
+	}
+
+	if (!error) {
+		object_p->history.segments[index].address = address;
+		object_p->history.segments[index].size = size;
+		memcpy(object_p->history.segments[index].data, data, size);
+	}
+
+	return error;
+}
+
+static void device_forget_history(device_object_t * object_p, unsigned long address, size_t length)
+{
+	size_t i;
+	size_t count = 0;
+
+	for (i = 0; i < object_p->history.count; i++) {
+		device_history_segment_t * segment_p = &(object_p->history.segments[i]);
+
+		if ((segment_p->address + segment_p->size <= address) || (segment_p->address >= address + length)) {
+			if (count != i) {
+				object_p->history.segments[count] = *segment_p;
+			}
+			count++;
+		}
+	}
+
+	object_p->history.count = count;
+}
+
+static int device_spot_check_history(device_object_t * object_p, unsigned long address, size_t length)
+{
+	int error = 0;
+	size_t first = device_search_history(object_p, address);
+	size_t last = device_search_history(object_p, address + length - 1);
+	size_t checks = object_p->history.spot_checks;
+	size_t i;
+
+	if ((first > 0) && (address < object_p->history.segments[first - 1].address + object_p->history.segments[first - 1].size)) {
+		first--;
+	}
+	if (checks > last - first) {
+		checks = last - first;
+	}
+
+	// Spread the checks over the known segments of the image, another programmer may have been at work.
+	for (i = 0; (i < checks) && (object_p->history.count > 0) && !error; i++) {
+		device_history_segment_t * segment_p = &(object_p->history.segments[first + (2 * i + 1) * (last - first) / (2 * checks)]);
+		bool match;
+
+		if (object_p->protocol == device_protocol_core) {
+			unsigned short crc = 0;
+
+			error = bsl_core_crc_check(object_p->bsl_object_p, segment_p->address, segment_p->size, &crc);
+			match = (crc == checksum_crc16(0xFFFF, segment_p->data, segment_p->size));
+		}
+		else {
+			unsigned char segment[DEVICE_MAX_SEGMENT_SIZE];
+
+			error = device_read_memory(object_p, segment_p->address, segment, segment_p->size);
+			match = (memcmp(segment, segment_p->data, segment_p->size) == 0);
+		}
+
+		object_p->statistics.spot_checks++;
+
+		if (!error && !match) {
+			fprintf(stderr, "The device differs from its history at 0x%05lx, it is compared by read-back.\n", segment_p->address);
+			object_p->history.count = 0;
+		}
+	}
+
+	return error;
+}
+
+static int device_check_range(device_object_t * object_p, unsigned long address, size_t size, bool * blank_p)
+{
+	int error = 0;
+	unsigned int attempts = 0;
+	unsigned short crc = 0;
+	unsigned short blank_crc = 0xFFFF;
+
+	if (object_p->protocol == device_protocol_core) {
+		unsigned char blank[DEVICE_MAX_SEGMENT_SIZE];
+		size_t i;
+
+		// The core BSL has no erase check, blank flash has a known CRC.
+		memset(blank, 0xFF, sizeof(blank));
+		for (i = 0; i < size; i += sizeof(blank)) {
+			blank_crc = checksum_crc16(blank_crc, blank, (size - i < sizeof(blank)) ? size - i : sizeof(blank));
+		}
+	}
+
+	do {
+		if (object_p->protocol == device_protocol_core) {
+			error = bsl_core_crc_check(object_p->bsl_object_p, address, size, &crc);
+			*blank_p = (crc == blank_crc);
+		}
+		else {
+			error = bsl_erase_check(object_p->bsl_object_p, address, size, blank_p);
+		}
+	} while (error && device_recover(object_p, error, &attempts));
+
+	object_p->statistics.blank_checks++;
+
+	return error;
+}
+
+static int device_search_blank(device_object_t * object_p, unsigned long address, size_t length, unsigned long * non_blank_p)
+{
+	int error = 0;
+	unsigned long end = address + length;
+	size_t granularity = (object_p->protocol == device_protocol_legacy) ? 2 : 1;
+	size_t check_size = 0;
+	bool blank = true;
+
+	// One check per range until one is not blank.
+	while (!error && blank && (address < end)) {
+		check_size = end - address;
+		if (check_size > DEVICE_ERASE_CHECK_RANGE) {
+			check_size = DEVICE_ERASE_CHECK_RANGE;
+		}
+
+		error = device_check_range(object_p, address, check_size, &blank);
+		if (!error && blank) {
+			address += check_size;
+		}
+	}
+
+	// Halve the range that is not blank until its first byte or word remains.
+	while (!error && !blank && (check_size > granularity)) {
+		size_t half = ((check_size / 2) + granularity - 1) & ~(granularity - 1);
+		bool half_blank = true;
+
+		error = device_check_range(object_p, address, half, &half_blank);
+		if (!error && half_blank) {
+			address += half;
+			check_size -= half;
+		}
+		else if (!error) {
+			check_size = half;
+		}
+	}
+
+	if (!error && !blank) {
+		*non_blank_p = address;
+
+		if (granularity > 1) {
+			unsigned char word[2];
+
+			// The ROM BSL tells words apart, the word tells the byte.
+			error = device_read_memory(object_p, address, word, sizeof(word));
+			if (!error && (word[0] == 0xFF)) {
+				*non_blank_p = address + 1;
+			}
+		}
+	}
+
+	return error;
+}
+
+static int device_scan_blank(device_object_t * object_p, unsigned long address, size_t length, unsigned long * non_blank_p)
+{
+	int error = 0;
+	unsigned char data[DEVICE_MAX_SEGMENT_SIZE];
+	size_t read_size = 0;
+	size_t i;
+	size_t j;
+
+	// Read the range back until a byte is not blank.
+	for (i = 0; (i < length) && !error && (*non_blank_p == address + length); i += read_size) {
+		read_size = (length - i < sizeof(data)) ? length - i : sizeof(data);
+		error = device_read_memory(object_p, address + i, data, read_size);
+
+		for (j = 0; (j < read_size) && !error; j++) {
+			if (data[j] != 0xFF) {
+				*non_blank_p = address + i + j;
+				break;
+			}
+		}
+	}
+
+	return error;
+}
+
+static int device_execute_erase_legacy(device_object_t * object_p, const device_erase_plan_t * plan_p)
+{
+	int error = 0;
+	bsl_operation_t operations[DEVICE_ERASE_BATCH_SIZE];
+	bsl_transaction_t transaction;
+	unsigned int attempts = 0;
+	size_t next = 0;
+
+	while ((next < plan_p->count) && !error) {
+		size_t i;
+
+		bsl_transaction_init(&transaction, operations, DEVICE_ERASE_BATCH_SIZE);
+
+		for (i = next; (i < plan_p->count) && (transaction.count < transaction.capacity) && !error; i++) {
+			const device_erase_command_t * command_p = &(plan_p->commands[i]);
+
+			switch (command_p->type)
+			{
+			case device_erase_segment:
+				error = bsl_transaction_erase_segment(&transaction, command_p->address);
+				break;
+			case device_erase_main:
+				error = bsl_transaction_erase_main_info(&transaction, DEVICE_MAIN_MEMORY_ADDRESS);
+				break;
+			case device_erase_information:
+				error = bsl_transaction_erase_main_info(&transaction, object_p->geometry.info_start);
+				break;
+			default:
+				error = bsl_transaction_mass_erase(&transaction);
+				break;
+			}
+		}
+
+		if (!error) {
+			// The erases run back to back, the first failure stops the rest.
+			error = bsl_execute_transaction(object_p->bsl_object_p, &transaction);
+
+			// Erasing a segment twice does no harm, go on with the command that failed.
+			for (i = 0; (i < transaction.count) && !operations[i].result; i++) {
+				object_p->statistics.erases++;
+			}
+			if (i > 0) {
+				attempts = 0;
+			}
+			next += i;
+
+			if (error && device_recover(object_p, error, &attempts)) {
+				error = 0;
+			}
+		}
+	}
+
+	return error;
+}
+
+static int device_execute_erase_core(device_object_t * object_p, const device_erase_plan_t * plan_p)
+{
+	int error = 0;
+	size_t i;
+
+	for (i = 0; (i < plan_p->count) && !error; i++) {
+		const device_erase_command_t * command_p = &(plan_p->commands[i]);
+		unsigned int attempts = 0;
+
+		if (command_p->type == device_erase_information) {
+			fprintf(stderr, "The core BSL erases the information memory segment by segment.\n");
+			error = 1;
+		}
+		else if ((command_p->type == device_erase_segment) && (command_p->address == object_p->geometry.segment_a)) {
+			// Segment A is locked, unlock it for the erase only.
+			error = bsl_core_toggle_info_lock(object_p->bsl_object_p);
+			if (!error) {
+				error = bsl_core_erase_segment(object_p->bsl_object_p, command_p->address);
+				if (bsl_core_toggle_info_lock(object_p->bsl_object_p)) {
+					error = 1;
+				}
+			}
+		}
+		else {
+			do {
+				if (command_p->type == device_erase_segment) {
+					error = bsl_core_erase_segment(object_p->bsl_object_p, command_p->address);
+				}
+				else {
+					// A mass erase clears the main memory only.
+					error = bsl_core_mass_erase(object_p->bsl_object_p);
+				}
+			} while (error && device_recover(object_p, error, &attempts));
+		}
+
+		if (!error) {
+			object_p->statistics.erases++;
+		}
+	}
+
+	return error;
+}
+
+static size_t device_mark_segments(bool * touched, unsigned long start, unsigned long end, size_t segment_size,
+		unsigned long address, unsigned long range_end)
+{
+	size_t count = 0;
+	size_t i;
+
+	if (address < start) {
+		address = start;
+	}
+	if (range_end > end) {
+		range_end = end;
+	}
+
+	for (i = (address - start) / segment_size; (address < range_end) && (start + i * segment_size < range_end); i++) {
+		if (!touched[i]) {
+			touched[i] = true;
+			count++;
+		}
+	}
+
+	return count;
+}
+
+static void device_add_erase_command(device_erase_plan_t * plan_p, device_erase_type type, unsigned long address, double time)
+{
+	plan_p->commands[plan_p->count].type = type;
+	plan_p->commands[plan_p->count].address = address;
+	plan_p->commands[plan_p->count].time = time;
+	plan_p->count++;
+	plan_p->time += time;
+}
+
+static double device_get_command_time(device_object_t * object_p)
+{
+	bsl_timing_t * timing_p = &(object_p->bsl_object_p->timing);
+	double time = (double) DEVICE_FRAME_OVERHEAD * DEVICE_BITS_PER_BYTE / timing_p->baudrate;
+
+	if (timing_p->latency_known) {
+		time += timing_p->latency;
+	}
+
+	return time;
+}
+
+static void device_set_default_geometry(device_object_t * object_p)
+{
+	// The largest layout of the family, on a smaller device a plan only leaves more flash alone.
+	if (object_p->protocol == device_protocol_core) {
+		object_p->geometry.main_start = DEVICE_CORE_MAIN_START;
+		object_p->geometry.main_end = DEVICE_CORE_MAIN_END;
+		object_p->geometry.info_start = DEVICE_CORE_INFO_D_ADDRESS;
+		object_p->geometry.info_end = DEVICE_CORE_INFO_END;
+		object_p->geometry.info_segment_size = DEVICE_CORE_INFO_SEGMENT_SIZE;
+		object_p->geometry.segment_a = DEVICE_CORE_INFO_A_ADDRESS;
+	}
+	else {
+		object_p->geometry.main_start = DEVICE_MAIN_MEMORY_START;
+		object_p->geometry.main_end = DEVICE_MAIN_MEMORY_END;
+		object_p->geometry.info_start = DEVICE_INFORMATION_MEMORY_ADDRESS;
+		object_p->geometry.info_end = DEVICE_INFORMATION_MEMORY_END;
+		object_p->geometry.info_segment_size = DEVICE_INFO_SEGMENT_SIZE;
+		object_p->geometry.segment_a = DEVICE_SEGMENT_A_ADDRESS;
+	}
+	object_p->geometry.main_segment_size = DEVICE_MAIN_SEGMENT_SIZE;
+	object_p->geometry.segment_erase_time = DEVICE_SEGMENT_ERASE_TIME;
+	object_p->geometry.region_erase_time = DEVICE_REGION_ERASE_TIME;
+	object_p->geometry.mass_erase_time = DEVICE_MASS_ERASE_TIME;
+}
@@ -11,11 +11,155 @@
 #include <stdbool.h>
 #include "bsl.h"
 
+#define DEVICE_MAX_SEGMENT_SIZE	(512)
+
+typedef enum
+{
+	device_protocol_legacy,	/**< 1xx/2xx/4xx ROM BSL.				*/
+	device_protocol_core	/**< 5xx/6xx/FRxx core command BSL.		*/
+} device_protocol;
+
+/**
+ * @brief How a failed block is recovered.
+ */
+typedef struct
+{
+	unsigned int	max_attempts;		/**< Attempts per block before giving up.					*/
+	double			initial_backoff;	/**< Wait before the first retry, in seconds.				*/
+	double			max_backoff;		/**< Upper bound of the doubling wait, in seconds.			*/
+	unsigned int	resync_after;		/**< Failed attempts of a block before a resync.			*/
+	unsigned int	fallback_after;		/**< Failed attempts of a block before a lower rate.		*/
+} device_retry_policy_t;
+
+/**
+ * @brief Frame size chosen for the error rate of the link.
+ */
+typedef struct
+{
+	size_t	min_size;	/**< Smallest frame, in bytes.								*/
+	size_t	max_size;	/**< Largest frame the BSL accepts, in bytes.				*/
+	size_t	size;		/**< Frame size of the next block, in bytes.				*/
+	double	errors;		/**< Decaying count of failed frames.						*/
+	double	bytes;		/**< Decaying count of bytes those frames put on the wire.	*/
+} device_frame_sizing_t;
+
+/**
+ * @brief Link quality and transfer counters of a session.
+ */
+typedef struct
+{
+	unsigned long	blocks;				/**< Blocks read or written.								*/
+	unsigned long	retries;			/**< Blocks sent again after an error.						*/
+	unsigned long	resyncs;			/**< Recoveries that discarded input and synchronized.		*/
+	unsigned long	baudrate_fallbacks;	/**< Changes to a lower line rate.							*/
+	unsigned long	failures;			/**< Blocks that failed every attempt.						*/
+	unsigned long	bytes;				/**< Bytes read or written.									*/
+	double			time;				/**< Time spent reading and writing, in seconds.			*/
+	size_t			min_frame_size;		/**< Smallest frame size chosen.							*/
+	size_t			max_frame_size;		/**< Largest frame size chosen.								*/
+	unsigned long	segments_compared;	/**< Segments checked against an image.						*/
+	unsigned long	segments_rewritten;	/**< Segments erased and programmed again.					*/
+	unsigned long	bytes_skipped;		/**< Image bytes already in flash, not programmed.			*/
+	unsigned long	segments_recalled;	/**< Segments compared with the image history alone.		*/
+	unsigned long	spot_checks;		/**< History segments checked against the device.			*/
+	unsigned long	erases;				/**< Erase commands executed.								*/
+	double			erase_time;			/**< Time spent erasing, in seconds.						*/
+	unsigned long	blank_checks;		/**< Ranges checked for blank flash on the target.			*/
+	double			verify_time;		/**< Time spent verifying on the target, in seconds.		*/
+} device_statistics_t;
+
+/**
+ * @brief Flash layout of the device and the time its erase commands take.
+ */
+typedef struct
+{
+	unsigned long	main_start;				/**< First main memory address.					*/
+	unsigned long	main_end;				/**< Address after the main memory.				*/
+	size_t			main_segment_size;		/**< Main memory segment size in bytes.			*/
+	unsigned long	info_start;				/**< First information memory address.			*/
+	unsigned long	info_end;				/**< Address after the information memory.		*/
+	size_t			info_segment_size;		/**< Information memory segment size in bytes.	*/
+	unsigned long	segment_a;				/**< Information segment with calibration data.	*/
+	double			segment_erase_time;		/**< Time of a segment erase, in seconds.		*/
+	double			region_erase_time;		/**< Time of a main or info erase, in seconds.	*/
+	double			mass_erase_time;		/**< Time of a mass erase, in seconds.			*/
+} device_geometry_t;
+
+/**
+ * @brief Erase commands of the BSLs.
+ */
+typedef enum
+{
+	device_erase_segment,		/**< One segment.													*/
+	device_erase_main,			/**< The main memory.												*/
+	device_erase_information,	/**< The information memory, segment A included (ROM BSL only).		*/
+	device_erase_mass			/**< All flash, on a core BSL the main memory only.					*/
+} device_erase_type;
+
+/**
+ * @brief An erase command and the time it is expected to take.
+ */
 typedef struct
 {
-	bsl_object_t *	bsl_object_p;
-	unsigned int	chip_id;
-	unsigned int	bsl_version;
+	device_erase_type	type;		/**< The command.								*/
+	unsigned long		address;	/**< Segment address, for a segment erase.		*/
+	double				time;		/**< Expected time on the link, in seconds.		*/
+} device_erase_command_t;
+
+/**
+ * @brief Erase commands that together clear a set of address ranges.
+ */
+typedef struct
+{
+	device_erase_command_t *	commands;	/**< The commands in execution order.			*/
+	size_t						count;		/**< Number of commands.						*/
+	double						time;		/**< Expected time of all commands, in seconds.	*/
+} device_erase_plan_t;
+
+/**
+ * @brief An address range.
+ */
+typedef struct
+{
+	unsigned long	address;	/**< First address.		*/
+	size_t			length;		/**< Size in bytes.		*/
+} device_range_t;
+
+/**
+ * @brief A flash segment as it was last programmed.
+ */
+typedef struct
+{
+	unsigned long	address;						/**< First address of the segment.	*/
+	size_t			size;							/**< Segment size in bytes.			*/
+	unsigned char	data[DEVICE_MAX_SEGMENT_SIZE];	/**< Contents of the segment.		*/
+} device_history_segment_t;
+
+/**
+ * @brief Images last programmed into one device, kept on the host.
+ */
+typedef struct
+{
+	char *						path;			/**< File of the device, NULL if no history is kept.	*/
+	device_history_segment_t *	segments;		/**< Known segments in address order.					*/
+	size_t						count;			/**< Known segments.									*/
+	size_t						size;			/**< Segments allocated.								*/
+	unsigned int				spot_checks;	/**< Segments checked on the device per update.			*/
+} device_history_t;
+
+typedef struct
+{
+	bsl_object_t *					bsl_object_p;
+	device_protocol					protocol;
+	unsigned int					chip_id;
+	unsigned int					bsl_version;
+	const bsl_baudrate_settings *	clock_settings;
+	unsigned int					max_baudrate;
+	device_retry_policy_t			retry_policy;
+	device_frame_sizing_t			frame_sizing;
+	device_statistics_t				statistics;
+	device_history_t				history;
+	device_geometry_t				geometry;
 } device_object_t;
 
 typedef struct
@@ -33,9 +177,31 @@ void device_terminate(device_object_t * object_p);
 
 unsigned int device_get_chip_id(device_object_t * object_p);
 unsigned int device_get_bsl_version(device_object_t * object_p);
+device_protocol device_get_protocol(device_object_t * object_p);
+unsigned int device_get_baudrate(device_object_t * object_p);
+void device_set_max_baudrate(device_object_t * object_p, unsigned int baudrate);
+void device_get_geometry(device_object_t * object_p, device_geometry_t * geometry_p);
+int device_set_geometry(device_object_t * object_p, const device_geometry_t * geometry_p);
+
+void device_get_default_retry_policy(device_retry_policy_t * policy_p);
+void device_set_retry_policy(device_object_t * object_p, const device_retry_policy_t * policy_p);
+void device_get_statistics(device_object_t * object_p, device_statistics_t * statistics_p);
+void device_clear_statistics(device_object_t * object_p);
 
-int device_read_memory(device_object_t * object_p, unsigned short address, unsigned char * data, size_t length);
-int device_write_memory(device_object_t *object_p, unsigned short address, const unsigned char * data, size_t length);
+int device_read_memory(device_object_t * object_p, unsigned long address, unsigned char * data, size_t length);
+int device_write_memory(device_object_t *object_p, unsigned long address, const unsigned char * data, size_t length);
 int device_erase_memory(device_object_t *object_p, device_memory_sections_t memory_sections);
+int device_update_memory(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length);
+
+int device_plan_erase(device_object_t * object_p, const device_range_t * ranges, size_t count, bool keep_untouched,
+		device_erase_plan_t * plan_p);
+int device_execute_erase_plan(device_object_t * object_p, const device_erase_plan_t * plan_p);
+void device_release_erase_plan(device_erase_plan_t * plan_p);
+int device_check_blank(device_object_t * object_p, unsigned long address, size_t length, unsigned long * non_blank_p);
+int device_verify_memory(device_object_t * object_p, unsigned long address, const unsigned char * data, size_t length,
+		const unsigned char * password);
+
+int device_open_history(device_object_t * object_p, const char * directory, unsigned int spot_checks);
+void device_close_history(device_object_t * object_p);
 
 #endif /* DEVICE_H_ */
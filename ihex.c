@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "checksum.h"
 #include "ihex.h"
 
 #define IHEX_DATA_RECORD_TYPE				(0x00)
@@ -20,6 +21,7 @@
 #define IHEX_START_LINEAR_ADDRESS_TYPE		(0x05)
 
 #define IHEX_DEFAULT_SIZE					(5)
+#define IHEX_MAX_RECORD_SIZE				(1 + 2 + 1 + 255 + 1)
 
 static int ihex_from_file(ihex_t * ihex, FILE * file);
 void ihex_to_file(const ihex_t * ihex, FILE * file);
@@ -28,6 +30,7 @@ static int ihex_check_file(FILE * file, size_t * size_p);
 static int ihex_verify_checksum(const char * line, size_t reclen);
 static int ihex_get_record_information(const char * input_string, unsigned char * reclen_p, unsigned short * load_offset_p, unsigned char * rectyp_p);
 static int ihex_get_data(const char * input_string, unsigned char * data, size_t data_size);
+static int ihex_decode_bytes(const char * input_string, unsigned char * data, size_t data_size);
 
 ihex_t * ihex_create()
 {
@@ -312,10 +315,9 @@ void ihex_to_file(const ihex_t * ihex, FILE * file)
 
 		for (i = 0; (i < ihex->records[record].data_size); i++) {
 			fprintf(file, "%02x", ihex->records[record].data[i]);
-			checksum += ihex->records[record].data[i];
 		}
 
-		checksum = -checksum;
+		checksum = -checksum_sum8(checksum, ihex->records[record].data, ihex->records[record].data_size);
 
 		fprintf(file, "%02x\n", checksum);
 	}
@@ -399,23 +401,14 @@ static int ihex_check_file(FILE * file, size_t * size_p)
 static int ihex_verify_checksum(const char * line, size_t reclen)
 {
 	int error = 0;
-	size_t i;
-	unsigned char sum = 0;
-
-	// For a line, calculate the checksum
-	for (i = 1; (i < (2 + 4 + 2 + reclen * 2 + 2)) && !error; i += 2) {
-		unsigned int temp_data;
+	unsigned char record[IHEX_MAX_RECORD_SIZE];
+	size_t record_size = 1 + 2 + 1 + reclen + 1;
 
-		if(!sscanf(&(line[i]), "%02x", &temp_data)) {
-			error = 1;
-		}
-		else {
-			sum += (unsigned char) temp_data;
-		}
-	}
+	// Decode the line, from the record length up to and including the checksum.
+	error = ihex_decode_bytes(&(line[1]), record, record_size);
 
 	// Check if the sum is zero.
-	if (sum != 0) {
+	if (!error && (checksum_sum8(0, record, record_size) != 0)) {
 		error = 1;
 	}
 
@@ -443,17 +436,38 @@ static int ihex_get_record_information(const char * input_string, unsigned char
 
 static int ihex_get_data(const char * input_string, unsigned char * data, size_t data_size)
 {
+	return ihex_decode_bytes(&(input_string[9]), data, data_size);
+}
+
+static int ihex_decode_bytes(const char * input_string, unsigned char * data, size_t data_size)
+{
+	// Value plus one of each hexadecimal digit, zero for any other character.
+	static const unsigned char digits[256] = {
+		['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+		['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+		['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+		['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+	};
 	int error = 0;
 	size_t i;
-	unsigned int temp_data;
 
-	for (i = 0; i < data_size; i++)
+	for (i = 0; (i < data_size) && !error; i++)
 	{
-		if(!sscanf(&(input_string[9 + i * 2]), "%02x", &temp_data)) {
+		unsigned char high = digits[(unsigned char) input_string[i * 2]];
+		unsigned char low;
+
+		// Stop at the terminating zero, the low digit is not read.
+		if (high == 0) {
 			error = 1;
 		}
 		else {
-			data[i] = (unsigned char) temp_data;
+			low = digits[(unsigned char) input_string[i * 2 + 1]];
+			if (low == 0) {
+				error = 1;
+			}
+			else {
+				data[i] = (unsigned char) ((high - 1) * 16 + (low - 1));
+			}
 		}
 	}
 
@@ -0,0 +1,191 @@
+/**
+ * @file	rfc2217.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the Telnet COM port control (RFC 2217) codec.
+ *
+ * Only the parts of Telnet needed to carry a binary serial stream are handled:
+ * IAC escaping of data, option negotiation and the COM port subnegotiations.
+ * The codec does no I/O, so both the TCP transport and the simulator's server
+ * side use it.
+ *
+ * @see		https://www.rfc-editor.org/rfc/rfc2217
+ */
+
+#include "rfc2217.h"
+
+/**
+ * @defgroup rfc2217 RFC 2217
+ * @brief Telnet COM port control codec.
+ * @{
+ */
+
+/**
+ * @brief	Initialize a decoder.
+ * @param	decoder_p		The decoder.
+ * @return	None.
+ */
+void rfc2217_decoder_init(rfc2217_decoder_t * decoder_p)
+{
+	decoder_p->state = rfc2217_state_data;
+	decoder_p->command = 0;
+	decoder_p->subnegotiation_size = 0;
+}
+
+/**
+ * @brief	Strip the Telnet commands from received data.
+ *
+ * Commands may be split over several calls, the decoder keeps the state.
+ *
+ * @param	decoder_p		The decoder.
+ * @param	handler			Callbacks for the commands, may be NULL.
+ * @param	user_data		User data for the callbacks.
+ * @param	data			Received data, replaced by the plain data.
+ * @param	size			Amount of received data.
+ * @return	Amount of plain data.
+ */
+size_t rfc2217_decode(rfc2217_decoder_t * decoder_p, const rfc2217_handler_t * handler, void * user_data,
+		unsigned char * data, size_t size)
+{
+	size_t data_size = 0;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		unsigned char byte = data[i];
+
+		switch (decoder_p->state)
+		{
+		case rfc2217_state_data:
+			if (byte == RFC2217_IAC) {
+				decoder_p->state = rfc2217_state_iac;
+			}
+			else {
+				data[data_size++] = byte;
+			}
+			break;
+		case rfc2217_state_iac:
+			decoder_p->state = rfc2217_state_data;
+			if (byte == RFC2217_IAC) {
+				// An escaped data byte.
+				data[data_size++] = byte;
+			}
+			else if ((byte >= RFC2217_WILL) && (byte <= RFC2217_DONT)) {
+				decoder_p->command = byte;
+				decoder_p->state = rfc2217_state_option;
+			}
+			else if (byte == RFC2217_SB) {
+				decoder_p->subnegotiation_size = 0;
+				decoder_p->state = rfc2217_state_subnegotiation;
+			}
+			// Other commands carry no data and are ignored.
+			break;
+		case rfc2217_state_option:
+			if ((handler != NULL) && (handler->option != NULL)) {
+				handler->option(user_data, decoder_p->command, byte);
+			}
+			decoder_p->state = rfc2217_state_data;
+			break;
+		case rfc2217_state_subnegotiation:
+			if (byte == RFC2217_IAC) {
+				decoder_p->state = rfc2217_state_subnegotiation_iac;
+			}
+			else if (decoder_p->subnegotiation_size < RFC2217_SUBNEGOTIATION_SIZE) {
+				decoder_p->subnegotiation[decoder_p->subnegotiation_size++] = byte;
+			}
+			break;
+		case rfc2217_state_subnegotiation_iac:
+			if (byte == RFC2217_SE) {
+				if ((handler != NULL) && (handler->subnegotiation != NULL)) {
+					handler->subnegotiation(user_data, decoder_p->subnegotiation, decoder_p->subnegotiation_size);
+				}
+				decoder_p->state = rfc2217_state_data;
+			}
+			else {
+				// An escaped IAC inside the subnegotiation.
+				if (decoder_p->subnegotiation_size < RFC2217_SUBNEGOTIATION_SIZE) {
+					decoder_p->subnegotiation[decoder_p->subnegotiation_size++] = byte;
+				}
+				decoder_p->state = rfc2217_state_subnegotiation;
+			}
+			break;
+		}
+	}
+
+	return data_size;
+}
+
+/**
+ * @brief	Escape data for sending.
+ * @param	data			Plain data.
+ * @param	size			Amount of plain data.
+ * @param	output			Buffer for the escaped data, at least twice the size.
+ * @return	Amount of escaped data.
+ */
+size_t rfc2217_encode_data(const unsigned char * data, size_t size, unsigned char * output)
+{
+	size_t output_size = 0;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		if (data[i] == RFC2217_IAC) {
+			output[output_size++] = RFC2217_IAC;
+		}
+		output[output_size++] = data[i];
+	}
+
+	return output_size;
+}
+
+/**
+ * @brief	Encode an option negotiation.
+ * @param	command			RFC2217_WILL, RFC2217_WONT, RFC2217_DO or RFC2217_DONT.
+ * @param	option			The option.
+ * @param	output			Buffer of at least 3 bytes.
+ * @return	Amount of encoded data.
+ */
+size_t rfc2217_encode_option(unsigned char command, unsigned char option, unsigned char * output)
+{
+	output[0] = RFC2217_IAC;
+	output[1] = command;
+	output[2] = option;
+
+	return 3;
+}
+
+/**
+ * @brief	Encode a COM port control command.
+ * @param	command			The command, plus RFC2217_SERVER_OFFSET for a server reply.
+ * @param	value			The value, sent in network byte order.
+ * @param	value_size		Size of the value, 1 or 4 bytes.
+ * @param	output			Buffer of at least RFC2217_COMMAND_SIZE bytes.
+ * @return	Amount of encoded data.
+ */
+size_t rfc2217_encode_command(unsigned char command, unsigned long value, size_t value_size, unsigned char * output)
+{
+	size_t output_size = 0;
+	size_t i;
+
+	output[output_size++] = RFC2217_IAC;
+	output[output_size++] = RFC2217_SB;
+	output[output_size++] = RFC2217_OPTION_COM_PORT;
+	output[output_size++] = command;
+
+	for (i = value_size; i > 0; i--) {
+		unsigned char byte = (unsigned char) (value >> (8 * (i - 1)));
+
+		if (byte == RFC2217_IAC) {
+			output[output_size++] = RFC2217_IAC;
+		}
+		output[output_size++] = byte;
+	}
+
+	output[output_size++] = RFC2217_IAC;
+	output[output_size++] = RFC2217_SE;
+
+	return output_size;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,99 @@
+/**
+ * @file	rfc2217.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the Telnet COM port control (RFC 2217) codec.
+ */
+
+#ifndef RFC2217_H_
+#define RFC2217_H_
+
+#include <stddef.h>
+
+/**
+ * @addtogroup rfc2217
+ * @{
+ */
+
+#define RFC2217_IAC						(255)	/**< Interpret as command.		*/
+#define RFC2217_DONT					(254)
+#define RFC2217_DO						(253)
+#define RFC2217_WONT					(252)
+#define RFC2217_WILL					(251)
+#define RFC2217_SB						(250)	/**< Subnegotiation begin.		*/
+#define RFC2217_SE						(240)	/**< Subnegotiation end.		*/
+
+#define RFC2217_OPTION_BINARY			(0)
+#define RFC2217_OPTION_SUPPRESS_GO_AHEAD	(3)
+#define RFC2217_OPTION_COM_PORT			(44)
+
+#define RFC2217_SET_BAUDRATE			(1)
+#define RFC2217_SET_DATASIZE			(2)
+#define RFC2217_SET_PARITY				(3)
+#define RFC2217_SET_STOPSIZE			(4)
+#define RFC2217_SET_CONTROL				(5)
+#define RFC2217_SERVER_OFFSET			(100)	/**< Added to commands in server replies.	*/
+
+#define RFC2217_PARITY_EVEN				(3)
+#define RFC2217_STOPSIZE_1				(1)
+#define RFC2217_CONTROL_DTR_ON			(8)
+#define RFC2217_CONTROL_DTR_OFF			(9)
+#define RFC2217_CONTROL_RTS_ON			(11)
+#define RFC2217_CONTROL_RTS_OFF			(12)
+
+/**
+ * @brief Longest subnegotiation that is kept, longer ones are truncated.
+ */
+#define RFC2217_SUBNEGOTIATION_SIZE		(16)
+
+/**
+ * @brief Longest encoded COM port command: IAC SB option command, four escaped value bytes, IAC SE.
+ */
+#define RFC2217_COMMAND_SIZE			(4 + 2 * 4 + 2)
+
+/**
+ * @brief Decoder state.
+ */
+typedef enum
+{
+	rfc2217_state_data,				/**< Plain data.							*/
+	rfc2217_state_iac,				/**< Received IAC.							*/
+	rfc2217_state_option,			/**< Received IAC WILL/WONT/DO/DONT.		*/
+	rfc2217_state_subnegotiation,	/**< Inside IAC SB ... IAC SE.				*/
+	rfc2217_state_subnegotiation_iac	/**< Received IAC inside a subnegotiation.	*/
+} rfc2217_state;
+
+/**
+ * @brief Callbacks for the Telnet commands found in the stream, all optional.
+ */
+typedef struct
+{
+	void	(*option)(void * user_data, unsigned char command, unsigned char option);		/**< IAC WILL/WONT/DO/DONT option.			*/
+	void	(*subnegotiation)(void * user_data, const unsigned char * data, size_t size);	/**< Unescaped content between SB and SE.	*/
+} rfc2217_handler_t;
+
+/**
+ * @brief Decoder for one direction of a Telnet stream.
+ */
+typedef struct
+{
+	rfc2217_state	state;												/**< Parser state.						*/
+	unsigned char	command;											/**< Pending WILL/WONT/DO/DONT.			*/
+	unsigned char	subnegotiation[RFC2217_SUBNEGOTIATION_SIZE];		/**< Subnegotiation being received.		*/
+	size_t			subnegotiation_size;								/**< Bytes of the subnegotiation.		*/
+} rfc2217_decoder_t;
+
+void rfc2217_decoder_init(rfc2217_decoder_t * decoder_p);
+size_t rfc2217_decode(rfc2217_decoder_t * decoder_p, const rfc2217_handler_t * handler, void * user_data,
+		unsigned char * data, size_t size);
+
+size_t rfc2217_encode_data(const unsigned char * data, size_t size, unsigned char * output);
+size_t rfc2217_encode_option(unsigned char command, unsigned char option, unsigned char * output);
+size_t rfc2217_encode_command(unsigned char command, unsigned long value, size_t value_size, unsigned char * output);
+
+/**
+ * @}
+ */
+
+#endif /* RFC2217_H_ */
@@ -10,9 +10,14 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <linux/serial.h>
 #include <math.h>
+#include <stdlib.h>
 #include <sys/ioctl.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -20,6 +25,8 @@
 #include <unistd.h>
 
 #include "serial.h"
+#include "serial_termios2.h"
+#include "wire_capture.h"
 
 /**
  * @defgroup serial Serial Port
@@ -27,7 +34,29 @@
  * @{
  */
 
-static speed_t _serial_get_baudrate(serial_baudrate baudrate);
+/**
+ * @brief Input buffer and statistics of an open port.
+ */
+typedef struct
+{
+	bool				used;						/**< TRUE when this entry belongs to a port.	*/
+	int					fd;							/**< File descriptor for the serial port.		*/
+	unsigned char		buffer[SERIAL_BUFFER_SIZE];	/**< Read-ahead ring buffer.					*/
+	size_t				head;						/**< Position of the oldest buffered byte.		*/
+	size_t				count;						/**< Number of buffered bytes.					*/
+	serial_statistics_t	statistics;					/**< Read statistics.							*/
+	int					latency_timer;				/**< Original adapter latency timer, -1 = none.	*/
+} serial_port_t;
+
+static serial_port_t serial_ports[SERIAL_MAX_PORTS];
+
+static bool _serial_get_baudrate(serial_baudrate baudrate, speed_t * baudrate_constant_p);
+_Static_assert((SERIAL_LINE_DTR == TIOCM_DTR) && (SERIAL_LINE_RTS == TIOCM_RTS), "Serial line masks must match TIOCM bits.");
+static serial_port_t * _serial_get_port(int fd, bool create);
+static int _serial_fill_buffer(serial_port_t * port_p);
+static int _serial_get_latency_timer_path(int fd, char * path, size_t size);
+static int _serial_read_latency_timer(const char * path);
+static int _serial_write_latency_timer(const char * path, int latency_timer);
 
 /**
  * @brief	Opens the serial port.
@@ -39,6 +68,7 @@ int serial_open(const char * serial_port, serial_settings_t settings)
 {
 	struct termios options;
 	speed_t baudrate;
+	bool standard_baudrate;
 	int fd;
 
 	// Open the serial port.
@@ -51,13 +81,21 @@ int serial_open(const char * serial_port, serial_settings_t settings)
 		// Get the current options.
 		tcgetattr(fd, &options);
 
-		// Set the baud rate.
-		baudrate = _serial_get_baudrate(settings.baudrate);
-		cfsetispeed(&options, baudrate);
-		cfsetospeed(&options, baudrate);
+		// Set the baud rate, other than standard rates are set through termios2 afterwards.
+		standard_baudrate = _serial_get_baudrate(settings.baudrate, &baudrate);
+		if (standard_baudrate) {
+			cfsetispeed(&options, baudrate);
+			cfsetospeed(&options, baudrate);
+		}
 
 		options.c_oflag = 0;
 
+		// Put the port in raw mode, the BSL protocol is binary and must not be translated.
+		options.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+		options.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+		options.c_cc[VMIN] = 0;
+		options.c_cc[VTIME] = 0;
+
 		// Enable the receiver and local mode.
 		options.c_cflag |= (CLOCAL | CREAD);
 
@@ -116,6 +154,19 @@ int serial_open(const char * serial_port, serial_settings_t settings)
 
 		// Write the options to the port.
 		tcsetattr(fd, TCSANOW, &options);
+
+		if (!standard_baudrate && serial_change_baudrate(fd, settings.baudrate)) {
+			close(fd);
+			return -1;
+		}
+
+		// Set up the input buffer.
+		_serial_get_port(fd, true);
+
+		if (settings.low_latency) {
+			// Tune the driver and adapter for short round trips.
+			serial_set_low_latency(fd, true);
+		}
 	}
 
 	return fd;
@@ -128,6 +179,16 @@ int serial_open(const char * serial_port, serial_settings_t settings)
  */
 void serial_close(int fd)
 {
+	serial_port_t * port_p = _serial_get_port(fd, false);
+
+	// Release the input buffer and restore the adapter latency timer.
+	if (port_p != NULL) {
+		if (port_p->latency_timer != -1) {
+			serial_set_low_latency(fd, false);
+		}
+		port_p->used = false;
+	}
+
 	close(fd);
 }
 
@@ -142,14 +203,6 @@ int serial_write(int fd, const char* data, size_t size)
 {
 	int written_size;
 
-	size_t i;
-	printf("Writing: ");
-	for (i = 0; i < size; i++)
-	{
-		printf("0x%02x ", (unsigned char) data[i]);
-	}
-	printf("\n");
-
 	// Write the data over the serial port.
 	written_size = write(fd, data, size);
 	if (written_size != size) {
@@ -157,11 +210,53 @@ int serial_write(int fd, const char* data, size_t size)
 		fprintf(stderr, "Could not send serial data serial port: %s\n", strerror(errno));
 	}
 
+	if (written_size > 0) {
+		// Capture the data that actually went out.
+		WIRE_CAPTURE(fd, wire_capture_tx, data, written_size);
+	}
+
 	return written_size;
 }
 
+/**
+ * @brief	Write scattered data to the serial port in a single system call.
+ * @param	fd				File descriptor for the serial port.
+ * @param	vectors			Parts of the data, in order.
+ * @param	count			Number of parts.
+ * @return	Amount of data written.
+ */
+int serial_writev(int fd, const struct iovec * vectors, int count)
+{
+	ssize_t written_size;
+	size_t size = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		size += vectors[i].iov_len;
+	}
+
+	// Write all parts over the serial port at once.
+	written_size = writev(fd, vectors, count);
+	if (written_size != (ssize_t) size) {
+		// Could not send the data to the port.
+		fprintf(stderr, "Could not send serial data serial port: %s\n", strerror(errno));
+	}
+
+	if (written_size > 0) {
+		// Capture the data that actually went out.
+		WIRE_CAPTURE_VECTORS(fd, wire_capture_tx, vectors, count, (size_t) written_size);
+	}
+
+	return (int) written_size;
+}
+
 /**
  * @brief	Read the serial port.
+ *
+ * Everything the port has available is drained into the read-ahead buffer of
+ * the port, so subsequent small reads are satisfied from memory without any
+ * system calls.
+ *
  * @param	fd				File descriptor for the serial port.
  * @param	data			Buffer to read data into.
  * @param	size			Amount of data to read.
@@ -170,25 +265,55 @@ int serial_write(int fd, const char* data, size_t size)
  */
 int serial_read(int fd, char* data, size_t size, double timeout)
 {
-	int read_size = 0;
-	int read_result = 0;
+	size_t read_size = 0;
+	unsigned long syscalls;
 	fd_set read_fds;
 	int selected_fd;
 	struct timeval timeout_struct;
+	serial_port_t * port_p;
+
+	port_p = _serial_get_port(fd, true);
+	if (port_p == NULL) {
+		fprintf(stderr, "No more than %d serial ports can be read.\n", SERIAL_MAX_PORTS);
+		return 0;
+	}
 
-	/* Initialize the input set */
-	FD_ZERO(&read_fds);
-	FD_SET(fd, &read_fds);
+	port_p->statistics.read_calls++;
+	syscalls = port_p->statistics.syscalls;
 
 	/* Initialize the timeout structure */
-	timeout_struct.tv_sec = rint(timeout);
-	timeout_struct.tv_usec = rint((timeout - round(timeout)) * pow(10, 6));
+	timeout_struct.tv_sec = floor(timeout);
+	timeout_struct.tv_usec = rint((timeout - floor(timeout)) * pow(10, 6));
 
 	// Loop while not all data has been retrieved.
 	while (read_size < size)
 	{
+		if (port_p->count > 0) {
+			// Copy buffered data, this takes at most two copies because of the wrap around.
+			size_t copy_size = size - read_size;
+			size_t contiguous_size = SERIAL_BUFFER_SIZE - port_p->head;
+
+			if (copy_size > port_p->count) {
+				copy_size = port_p->count;
+			}
+			if (copy_size > contiguous_size) {
+				copy_size = contiguous_size;
+			}
+
+			memcpy(&(data[read_size]), &(port_p->buffer[port_p->head]), copy_size);
+			port_p->head = (port_p->head + copy_size) % SERIAL_BUFFER_SIZE;
+			port_p->count -= copy_size;
+			read_size += copy_size;
+			continue;
+		}
+
+		/* Initialize the input set */
+		FD_ZERO(&read_fds);
+		FD_SET(fd, &read_fds);
+
 		/* Do the select */
 		selected_fd = select(fd + 1, &read_fds,  NULL, NULL, &timeout_struct);
+		port_p->statistics.syscalls++;
 
 		/* See if there was an error */
 		if (selected_fd < 0) {
@@ -199,28 +324,133 @@ int serial_read(int fd, char* data, size_t size, double timeout)
 			fprintf(stderr, "A timeout occurred.\n");
 			break;
 		}
-		else
-		{
-			read_result = read(fd, &(data[read_size]), size - read_size);
-			if (read_result < 0)
-			{
-				fprintf(stderr, "Failed to read data: %s.\n", strerror(errno));
-				break;
-			}
-			read_size += read_result;
+		else if (_serial_fill_buffer(port_p)) {
+			break;
 		}
 	}
 
-	size_t i;
-	printf("Reading: ");
-	for (i = 0; i < read_size; i++) {
-		printf("0x%02x ", (unsigned char) data[i]);
+	port_p->statistics.bytes_read += read_size;
+	if ((read_size == size) && (port_p->statistics.syscalls == syscalls)) {
+		// A select() and read() pair was avoided.
+		port_p->statistics.buffered_reads++;
+		port_p->statistics.syscalls_saved += 2;
 	}
-	printf("\n");
 
 	return read_size;
 }
 
+/**
+ * @brief	Get the read statistics of the serial port.
+ * @param	fd				File descriptor for the serial port.
+ * @param	statistics_p	Location to store the statistics.
+ * @return	0 on success, 1 if the port is unknown.
+ */
+int serial_get_statistics(int fd, serial_statistics_t * statistics_p)
+{
+	int error = 0;
+	serial_port_t * port_p = _serial_get_port(fd, false);
+
+	if (port_p == NULL) {
+		fprintf(stderr, "No statistics available for serial port %d.\n", fd);
+		error = 1;
+	}
+	else {
+		*statistics_p = port_p->statistics;
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Enable or disable the low latency profile of the serial port.
+ *
+ * Sets ASYNC_LOW_LATENCY on the driver and, for USB-serial adapters that
+ * expose one in sysfs (e.g. FTDI), lowers the latency timer to
+ * SERIAL_LOW_LATENCY_TIMER milliseconds. Disabling restores the original
+ * latency timer. Adapters without these controls are left untouched.
+ *
+ * @param	fd				File descriptor for the serial port.
+ * @param	enabled			TRUE = enabled, FALSE = disabled.
+ * @return	0 on success, 1 on error.
+ */
+int serial_set_low_latency(int fd, bool enabled)
+{
+	int error = 0;
+	struct serial_struct serial_info;
+	char path[PATH_MAX];
+	serial_port_t * port_p = _serial_get_port(fd, true);
+
+	if (port_p == NULL) {
+		fprintf(stderr, "No more than %d serial ports can be tuned.\n", SERIAL_MAX_PORTS);
+		error = 1;
+	}
+
+	if (!error && (ioctl(fd, TIOCGSERIAL, &serial_info) == 0)) {
+		// Ask the driver to push received data to the tty layer immediately.
+		if (enabled) {
+			serial_info.flags |= ASYNC_LOW_LATENCY;
+		}
+		else {
+			serial_info.flags &= ~ASYNC_LOW_LATENCY;
+		}
+		ioctl(fd, TIOCSSERIAL, &serial_info);
+	}
+
+	if (!error && !_serial_get_latency_timer_path(fd, path, sizeof(path))) {
+		if (enabled) {
+			// Remember the original latency timer once.
+			if (port_p->latency_timer == -1) {
+				port_p->latency_timer = _serial_read_latency_timer(path);
+			}
+			if (port_p->latency_timer != -1) {
+				error = _serial_write_latency_timer(path, SERIAL_LOW_LATENCY_TIMER);
+			}
+		}
+		else if (port_p->latency_timer != -1) {
+			error = _serial_write_latency_timer(path, port_p->latency_timer);
+			port_p->latency_timer = -1;
+		}
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Assert and deassert modem control lines without reading them first.
+ *
+ * Ports without modem control lines are silently accepted, so the BSL can be
+ * driven over pseudo-terminals.
+ *
+ * @param	fd				File descriptor for the serial port.
+ * @param	set_lines		SERIAL_LINE_* lines to assert.
+ * @param	clear_lines		SERIAL_LINE_* lines to deassert.
+ * @return	0 on success, 1 on error.
+ */
+int serial_set_lines(int fd, unsigned int set_lines, unsigned int clear_lines)
+{
+	int error = 0;
+	int status;
+
+	// Ports without modem lines, such as pseudo-terminals, reject the request with ENOTTY.
+	if (set_lines) {
+		status = (int) set_lines;
+		if ((ioctl(fd, TIOCMBIS, &status) == -1) && (errno != ENOTTY)) {
+			fprintf(stderr, "Could not set the modem lines: %s\n", strerror(errno));
+			error = 1;
+		}
+	}
+
+	if (!error && clear_lines) {
+		status = (int) clear_lines;
+		if ((ioctl(fd, TIOCMBIC, &status) == -1) && (errno != ENOTTY)) {
+			fprintf(stderr, "Could not clear the modem lines: %s\n", strerror(errno));
+			error = 1;
+		}
+	}
+
+	return error;
+}
+
 /**
  * @brief	Set the RTS pin status.
  * @param	fd				File descriptor for the serial port.
@@ -326,95 +556,362 @@ bool serial_get_dsr(int fd)
 
 /**
  * @brief	Change the baudrate of the serial port.
+ *
+ * Standard rates are set through termios, any other rate through termios2 and
+ * BOTHER. A difference between the requested rate and the rate the driver
+ * actually configured is reported.
+ *
  * @param	fd File descriptor for the serial port.
  * @param	baudrate The desired baudrate.
- * @return	None.
+ * @return	0 on success, 1 on error.
  */
-void serial_change_baudrate(int fd, serial_baudrate baudrate)
+int serial_change_baudrate(int fd, serial_baudrate baudrate)
 {
+	int error = 0;
 	struct termios options;
 	speed_t baud;
+	unsigned int actual_baudrate;
+
+	if (_serial_get_baudrate(baudrate, &baud)) {
+		// Get the current options.
+		tcgetattr(fd, &options);
+
+		// Set the baud rate.
+		cfsetispeed(&options, baud);
+		cfsetospeed(&options, baud);
+
+		// Write the options to the port.
+		if (tcsetattr(fd, TCSANOW, &options) == -1) {
+			fprintf(stderr, "Could not set the baud rate to %u: %s\n", (unsigned int) baudrate, strerror(errno));
+			error = 1;
+		}
+	}
+	else {
+		error = serial_termios2_set_baudrate(fd, baudrate);
+	}
+
+	if (!error && !serial_get_baudrate(fd, &actual_baudrate) && (actual_baudrate != (unsigned int) baudrate)) {
+		fprintf(stderr, "Requested %u baud, the port runs at %u baud.\n", (unsigned int) baudrate, actual_baudrate);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Get the baudrate the serial port actually runs at.
+ * @param	fd				File descriptor for the serial port.
+ * @param	baudrate_p		Location to store the baudrate.
+ * @return	0 on success, 1 on error.
+ */
+int serial_get_baudrate(int fd, unsigned int * baudrate_p)
+{
+	return serial_termios2_get_baudrate(fd, baudrate_p);
+}
+
+/**
+ * @brief	Discard all received but unread data.
+ * @param	fd				File descriptor for the serial port.
+ * @return	None.
+ */
+void serial_flush(int fd)
+{
+	serial_port_t * port_p = _serial_get_port(fd, false);
+
+	if (port_p != NULL) {
+		port_p->head = 0;
+		port_p->count = 0;
+	}
+
+	tcflush(fd, TCIFLUSH);
+}
 
-	// Get the current options.
-	tcgetattr(fd, &options);
+/**
+ * @brief	Validate the current baudrate with a loopback connection (TX wired to RX).
+ * @param	fd				File descriptor for the serial port.
+ * @param	size			Amount of test data to send.
+ * @param	timeout			Timeout for each chunk of test data.
+ * @return	0 if all data was received unaltered, 1 otherwise.
+ */
+int serial_loopback_test(int fd, size_t size, double timeout)
+{
+	int error = 0;
+	char write_data[SERIAL_LOOPBACK_CHUNK_SIZE];
+	char read_data[SERIAL_LOOPBACK_CHUNK_SIZE];
+	unsigned int pattern = 0x2A;
+	size_t done;
+	size_t i;
+
+	serial_flush(fd);
+
+	for (done = 0; (done < size) && !error; done += SERIAL_LOOPBACK_CHUNK_SIZE) {
+		size_t chunk_size = size - done;
 
-	// Set the baud rate.
-	baud = _serial_get_baudrate(baudrate);
-	cfsetispeed(&options, baud);
-	cfsetospeed(&options, baud);
+		if (chunk_size > SERIAL_LOOPBACK_CHUNK_SIZE) {
+			chunk_size = SERIAL_LOOPBACK_CHUNK_SIZE;
+		}
+
+		// Fill the chunk with a pseudo random pattern to exercise all bit transitions.
+		for (i = 0; i < chunk_size; i++) {
+			pattern = pattern * 1103515245 + 12345;
+			write_data[i] = (char) (pattern >> 16);
+		}
 
-	// Write the options to the port.
-	tcsetattr(fd, TCSANOW, &options);
+		if (serial_write(fd, write_data, chunk_size) != (int) chunk_size) {
+			error = 1;
+		}
+		else if (serial_read(fd, read_data, chunk_size, timeout) != (int) chunk_size) {
+			fprintf(stderr, "Loopback test received less data than sent.\n");
+			error = 1;
+		}
+		else if (memcmp(write_data, read_data, chunk_size) != 0) {
+			fprintf(stderr, "Loopback test received corrupted data.\n");
+			error = 1;
+		}
+	}
+
+	return error;
 }
 
 /**
  * @brief	Calculate the serial baud rate constants.
- * @param	baudrate Enum with baud rate.
- * @return	Baud rate constants..
+ * @param	baudrate Baud rate.
+ * @param	baudrate_constant_p Location to store the baud rate constant.
+ * @return	TRUE if a standard baud rate constant exists, FALSE otherwise.
  */
-static speed_t _serial_get_baudrate(serial_baudrate baudrate)
+static bool _serial_get_baudrate(serial_baudrate baudrate, speed_t * baudrate_constant_p)
 {
-	speed_t baudrate_constant;
+	bool standard = true;
 
 	switch(baudrate)
 	{
 	case baudrate_0:
-		baudrate_constant = B0;
+		*baudrate_constant_p = B0;
 		break;
 	case baudrate_50:
-		baudrate_constant = B50;
+		*baudrate_constant_p = B50;
 		break;
 	case baudrate_75:
-		baudrate_constant = B75;
+		*baudrate_constant_p = B75;
 		break;
 	case baudrate_110:
-		baudrate_constant = B110;
+		*baudrate_constant_p = B110;
 		break;
 	case baudrate_134:
-		baudrate_constant = B134;
+		*baudrate_constant_p = B134;
 		break;
 	case baudrate_150:
-		baudrate_constant = B150;
+		*baudrate_constant_p = B150;
 		break;
 	case baudrate_200:
-		baudrate_constant = B200;
+		*baudrate_constant_p = B200;
 		break;
 	case baudrate_300:
-		baudrate_constant = B300;
+		*baudrate_constant_p = B300;
 		break;
 	case baudrate_600:
-		baudrate_constant = B600;
+		*baudrate_constant_p = B600;
 		break;
 	case baudrate_1200:
-		baudrate_constant = B1200;
+		*baudrate_constant_p = B1200;
 		break;
 	case baudrate_1800:
-		baudrate_constant = B1800;
+		*baudrate_constant_p = B1800;
 		break;
 	case baudrate_2400:
-		baudrate_constant = B2400;
+		*baudrate_constant_p = B2400;
 		break;
 	case baudrate_4800:
-		baudrate_constant = B4800;
+		*baudrate_constant_p = B4800;
 		break;
 	case baudrate_9600:
-		baudrate_constant = B9600;
+		*baudrate_constant_p = B9600;
 		break;
 	case baudrate_19200:
-		baudrate_constant = B19200;
+		*baudrate_constant_p = B19200;
 		break;
 	case baudrate_38400:
-		baudrate_constant = B38400;
+		*baudrate_constant_p = B38400;
 		break;
 	case baudrate_57600:
-		baudrate_constant = B57600;
+		*baudrate_constant_p = B57600;
 		break;
 	case baudrate_115200:
-		baudrate_constant = B115200;
+		*baudrate_constant_p = B115200;
+		break;
+	case baudrate_230400:
+		*baudrate_constant_p = B230400;
+		break;
+	case baudrate_460800:
+		*baudrate_constant_p = B460800;
+		break;
+	case baudrate_921600:
+		*baudrate_constant_p = B921600;
 		break;
+	default:
+		standard = false;
+		break;
+	}
+
+	return standard;
+}
+
+/**
+ * @brief	Get the input buffer of a port.
+ * @param	fd				File descriptor for the serial port.
+ * @param	create			TRUE = set up a new buffer if the port has none.
+ * @return	The port, or NULL if it does not exist and cannot be created.
+ */
+static serial_port_t * _serial_get_port(int fd, bool create)
+{
+	serial_port_t * port_p = NULL;
+	size_t i;
+
+	for (i = 0; (i < SERIAL_MAX_PORTS) && (port_p == NULL); i++) {
+		if (serial_ports[i].used && (serial_ports[i].fd == fd)) {
+			port_p = &serial_ports[i];
+		}
+	}
+
+	for (i = 0; (i < SERIAL_MAX_PORTS) && (port_p == NULL) && create; i++) {
+		if (!serial_ports[i].used) {
+			port_p = &serial_ports[i];
+			port_p->used = true;
+			port_p->fd = fd;
+			port_p->head = 0;
+			port_p->count = 0;
+			port_p->latency_timer = -1;
+			memset(&port_p->statistics, 0, sizeof(serial_statistics_t));
+		}
+	}
+
+	return port_p;
+}
+
+/**
+ * @brief	Drain everything the port has available into its input buffer.
+ * @param	port_p			The port.
+ * @return	0 on success, 1 on error.
+ */
+static int _serial_fill_buffer(serial_port_t * port_p)
+{
+	int error = 0;
+	struct iovec vectors[2];
+	int vector_count = 1;
+	size_t tail = (port_p->head + port_p->count) % SERIAL_BUFFER_SIZE;
+	ssize_t read_result;
+
+	// The free space is at most two regions because of the wrap around.
+	vectors[0].iov_base = &(port_p->buffer[tail]);
+	if (tail >= port_p->head) {
+		vectors[0].iov_len = SERIAL_BUFFER_SIZE - tail;
+		vectors[1].iov_base = port_p->buffer;
+		vectors[1].iov_len = port_p->head;
+		vector_count = (port_p->head > 0) ? 2 : 1;
+	}
+	else {
+		vectors[0].iov_len = port_p->head - tail;
+	}
+
+	read_result = readv(port_p->fd, vectors, vector_count);
+	port_p->statistics.syscalls++;
+
+	if (read_result < 0) {
+		fprintf(stderr, "Failed to read data: %s.\n", strerror(errno));
+		error = 1;
+	}
+	else {
+		size_t first_size = ((size_t) read_result < vectors[0].iov_len) ? (size_t) read_result : vectors[0].iov_len;
+
+		// Capture the chunk as it arrived.
+		WIRE_CAPTURE(port_p->fd, wire_capture_rx, vectors[0].iov_base, first_size);
+		if ((size_t) read_result > first_size) {
+			WIRE_CAPTURE(port_p->fd, wire_capture_rx, vectors[1].iov_base, read_result - first_size);
+		}
+
+		port_p->count += read_result;
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Find the sysfs latency timer attribute of a USB-serial adapter.
+ * @param	fd				File descriptor for the serial port.
+ * @param	path			Buffer for the attribute path.
+ * @param	size			Size of the buffer.
+ * @return	0 if the adapter has a latency timer, 1 otherwise.
+ */
+static int _serial_get_latency_timer_path(int fd, char * path, size_t size)
+{
+	int error = 0;
+	char link[32];
+	char device[PATH_MAX];
+	ssize_t length;
+
+	// Resolve the device node of the file descriptor, e.g. /dev/ttyUSB0.
+	snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+	length = readlink(link, device, sizeof(device) - 1);
+	if (length < 0) {
+		error = 1;
+	}
+
+	if (!error) {
+		device[length] = '\0';
+		snprintf(path, size, "/sys/class/tty/%s/device/latency_timer", basename(device));
+		if (access(path, F_OK) != 0) {
+			error = 1;
+		}
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Read an adapter latency timer.
+ * @param	path			Path of the sysfs attribute.
+ * @return	Latency timer in milliseconds, -1 on error.
+ */
+static int _serial_read_latency_timer(const char * path)
+{
+	int latency_timer = -1;
+	FILE * file;
+
+	file = fopen(path, "r");
+	if (file != NULL) {
+		if (fscanf(file, "%d", &latency_timer) != 1) {
+			latency_timer = -1;
+		}
+		fclose(file);
+	}
+
+	return latency_timer;
+}
+
+/**
+ * @brief	Write an adapter latency timer.
+ * @param	path			Path of the sysfs attribute.
+ * @param	latency_timer	Latency timer in milliseconds.
+ * @return	0 on success, 1 on error.
+ */
+static int _serial_write_latency_timer(const char * path, int latency_timer)
+{
+	int error = 0;
+	FILE * file;
+
+	file = fopen(path, "w");
+	if (file == NULL) {
+		fprintf(stderr, "Could not set the latency timer %s: %s\n", path, strerror(errno));
+		error = 1;
+	}
+	else {
+		fprintf(file, "%d", latency_timer);
+		if (fclose(file) != 0) {
+			fprintf(stderr, "Could not set the latency timer %s: %s\n", path, strerror(errno));
+			error = 1;
+		}
 	}
 
-	return baudrate_constant;
+	return error;
 }
 
 /**
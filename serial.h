@@ -11,6 +11,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <sys/uio.h>
 
 /**
  * @addtogroup serial
@@ -18,28 +19,61 @@
  */
 
 /**
- * @brief Available baud rates.
+ * @brief Maximum number of simultaneously open serial ports.
+ */
+#define SERIAL_MAX_PORTS	(64)
+
+/**
+ * @brief Size of the read-ahead buffer of each port.
+ */
+#define SERIAL_BUFFER_SIZE	(4096)
+
+/**
+ * @brief Adapter latency timer in milliseconds used by the low latency profile.
+ */
+#define SERIAL_LOW_LATENCY_TIMER	(1)
+
+/**
+ * @brief Modem control output lines, for use with serial_set_lines().
+ */
+#define SERIAL_LINE_DTR	(0x002)
+#define SERIAL_LINE_RTS	(0x004)
+
+/**
+ * @brief Size of the chunks sent by the loopback test.
+ */
+#define SERIAL_LOOPBACK_CHUNK_SIZE	(256)
+
+/**
+ * @brief Common baud rates.
+ *
+ * The value of each constant is the rate in baud. Any other integer rate can be
+ * used as a serial_baudrate as well, rates without a standard termios constant
+ * are configured through termios2/BOTHER.
  */
 typedef enum
 {
-	baudrate_0,		/**< 0 baud.		*/
-	baudrate_50,	/**< 50 baud.		*/
-	baudrate_75,	/**< 75 baud.		*/
-	baudrate_110,	/**< 110 baud.		*/
-	baudrate_134,	/**< 134 baud.		*/
-	baudrate_150,	/**< 150 baud.		*/
-	baudrate_200,	/**< 200 baud.		*/
-	baudrate_300,	/**< 300 baud.		*/
-	baudrate_600,	/**< 600 baud.		*/
-	baudrate_1200,	/**< 1200 baud.		*/
-	baudrate_1800,	/**< 1800 baud.		*/
-	baudrate_2400,	/**< 2400 baud.		*/
-	baudrate_4800,	/**< 4800 baud.		*/
-	baudrate_9600,	/**< 9600 baud.		*/
-	baudrate_19200,	/**< 19200 baud.	*/
-	baudrate_38400,	/**< 38400 baud.	*/
-	baudrate_57600,	/**< 57600 baud.	*/
-	baudrate_115200	/**< 115200 baud.	 */
+	baudrate_0 = 0,				/**< 0 baud.		*/
+	baudrate_50 = 50,			/**< 50 baud.		*/
+	baudrate_75 = 75,			/**< 75 baud.		*/
+	baudrate_110 = 110,			/**< 110 baud.		*/
+	baudrate_134 = 134,			/**< 134 baud.		*/
+	baudrate_150 = 150,			/**< 150 baud.		*/
+	baudrate_200 = 200,			/**< 200 baud.		*/
+	baudrate_300 = 300,			/**< 300 baud.		*/
+	baudrate_600 = 600,			/**< 600 baud.		*/
+	baudrate_1200 = 1200,		/**< 1200 baud.		*/
+	baudrate_1800 = 1800,		/**< 1800 baud.		*/
+	baudrate_2400 = 2400,		/**< 2400 baud.		*/
+	baudrate_4800 = 4800,		/**< 4800 baud.		*/
+	baudrate_9600 = 9600,		/**< 9600 baud.		*/
+	baudrate_19200 = 19200,		/**< 19200 baud.	*/
+	baudrate_38400 = 38400,		/**< 38400 baud.	*/
+	baudrate_57600 = 57600,		/**< 57600 baud.	*/
+	baudrate_115200 = 115200,	/**< 115200 baud.	*/
+	baudrate_230400 = 230400,	/**< 230400 baud.	*/
+	baudrate_460800 = 460800,	/**< 460800 baud.	*/
+	baudrate_921600 = 921600	/**< 921600 baud.	*/
 } serial_baudrate;
 
 /**
@@ -82,18 +116,38 @@ typedef struct
 	serial_stopbits		stopbits;		/**< The number of stopbits. 									*/
 	serial_databits		databits;		/**< The number of databits. 									*/
 	bool				flow_control;	/**< Hardware flow control: TRUE = enabled, FALSE = disabled.	*/
+	bool				low_latency;	/**< Low latency profile: TRUE = enabled, FALSE = disabled.		*/
 } serial_settings_t;
 
+/**
+ * @brief Read statistics of a serial port.
+ */
+typedef struct
+{
+	unsigned long	read_calls;		/**< Number of serial_read() calls.							*/
+	unsigned long	buffered_reads;	/**< Calls satisfied from the buffer without system calls.	*/
+	unsigned long	syscalls;		/**< Number of select() and read() calls performed.			*/
+	unsigned long	syscalls_saved;	/**< Number of system calls avoided by buffered reads.		*/
+	unsigned long	bytes_read;		/**< Number of bytes returned to the caller.				*/
+} serial_statistics_t;
+
 int serial_open(const char* serial_port, serial_settings_t settings);
 void serial_close(int fd);
 int serial_write(int fd, const char* data, size_t size);
+int serial_writev(int fd, const struct iovec * vectors, int count);
 int serial_read(int fd, char* data, size_t size, double timeout);
+int serial_get_statistics(int fd, serial_statistics_t * statistics_p);
+int serial_set_low_latency(int fd, bool enabled);
+int serial_set_lines(int fd, unsigned int set_lines, unsigned int clear_lines);
 void serial_set_rts(int fd, bool enabled);
 void serial_set_dtr(int fd, bool enabled);
 bool serial_get_cts(int fd);
 bool serial_get_dcd(int fd);
 bool serial_get_dsr(int fd);
-void serial_change_baudrate(int fd, serial_baudrate baudrate);
+int serial_change_baudrate(int fd, serial_baudrate baudrate);
+int serial_get_baudrate(int fd, unsigned int * baudrate_p);
+void serial_flush(int fd);
+int serial_loopback_test(int fd, size_t size, double timeout);
 
 /**
  * @}
@@ -0,0 +1,568 @@
+/**
+ * @file	serial_reactor.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the multi-port serial reactor.
+ *
+ * The reactor multiplexes any number of open serial ports (up to
+ * SERIAL_REACTOR_MAX_PORTS) in the calling thread with a single epoll instance.
+ * Reads and writes are started asynchronously and complete through the port
+ * callback, and each port has its own deadline, so one thread can drive a
+ * whole rack of targets at line rate.
+ *
+ * A port is only watched for input while a read is pending, so data that
+ * arrives before the owner asks for it waits in the port and wakes the
+ * reactor at most once. The interest is dropped lazily, a read that follows
+ * the previous one costs no extra system call. A port that reports an error
+ * or hang-up is no longer watched.
+ *
+ * The reactor transport runs complete BSL sessions on the ports of a reactor.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "serial_reactor.h"
+#include "wire_capture.h"
+
+/**
+ * @defgroup serial_reactor Serial Reactor
+ * @brief Library functions for driving many serial ports from one thread.
+ * @{
+ */
+
+static serial_reactor_port_t * serial_reactor_get_port(serial_reactor_t * reactor_p, int fd);
+static int serial_reactor_update_events(serial_reactor_t * reactor_p, serial_reactor_port_t * port_p);
+static void serial_reactor_handle_read(serial_reactor_t * reactor_p, serial_reactor_port_t * port_p);
+static void serial_reactor_handle_write(serial_reactor_t * reactor_p, serial_reactor_port_t * port_p);
+static void serial_reactor_handle_deadlines(serial_reactor_t * reactor_p);
+static unsigned long long serial_reactor_get_time(void);
+
+/**
+ * @brief	Construct a reactor.
+ * @return	The reactor object, or NULL on error.
+ */
+serial_reactor_t * serial_reactor_construct(void)
+{
+	serial_reactor_t * reactor_p;
+	size_t i;
+
+	// Allocate memory for the reactor object.
+	reactor_p = malloc(sizeof(serial_reactor_t));
+
+	if (reactor_p == NULL) {
+		// Could not allocate memory.
+		fprintf(stderr, "Failed to allocate memory for the serial reactor object.\n");
+	}
+	else {
+		reactor_p->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		reactor_p->port_count = 0;
+		for (i = 0; i < SERIAL_REACTOR_MAX_PORTS; i++) {
+			reactor_p->ports[i].fd = -1;
+		}
+
+		if (reactor_p->epoll_fd == -1) {
+			fprintf(stderr, "Failed to create an epoll instance: %s\n", strerror(errno));
+			free(reactor_p);
+			reactor_p = NULL;
+		}
+	}
+
+	return reactor_p;
+}
+
+/**
+ * @brief	Destroy a reactor, the ports themselves are not closed.
+ * @param	reactor_p		The reactor object.
+ * @return	None.
+ */
+void serial_reactor_destroy(serial_reactor_t * reactor_p)
+{
+	close(reactor_p->epoll_fd);
+	free(reactor_p);
+}
+
+/**
+ * @brief	Add an open port to the reactor.
+ * @param	reactor_p		The reactor object.
+ * @param	fd				File descriptor for the serial port.
+ * @param	callback		Callback for the events of this port.
+ * @param	user_data		User data passed to the callback.
+ * @return	0 on success, 1 on error.
+ */
+int serial_reactor_add(serial_reactor_t * reactor_p, int fd, serial_reactor_callback callback, void * user_data)
+{
+	int error = 0;
+	serial_reactor_port_t * port_p = NULL;
+	size_t i;
+
+	if (serial_reactor_get_port(reactor_p, fd) != NULL) {
+		fprintf(stderr, "Port %d is already part of the reactor.\n", fd);
+		error = 1;
+	}
+
+	if (!error) {
+		// Find a free slot.
+		for (i = 0; (i < SERIAL_REACTOR_MAX_PORTS) && (port_p == NULL); i++) {
+			if (reactor_p->ports[i].fd == -1) {
+				port_p = &reactor_p->ports[i];
+			}
+		}
+
+		if (port_p == NULL) {
+			fprintf(stderr, "No more than %d ports can be added to the reactor.\n", SERIAL_REACTOR_MAX_PORTS);
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		struct epoll_event event;
+
+		memset(port_p, 0, sizeof(serial_reactor_port_t));
+		port_p->callback = callback;
+		port_p->user_data = user_data;
+
+		// Nothing is pending yet, only errors and hang-ups are reported.
+		event.events = 0;
+		event.data.ptr = port_p;
+		if (epoll_ctl(reactor_p->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+			fprintf(stderr, "Failed to add port %d to the reactor: %s\n", fd, strerror(errno));
+			port_p->fd = -1;
+			error = 1;
+		}
+		else {
+			port_p->fd = fd;
+			reactor_p->port_count++;
+		}
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Remove a port from the reactor, pending operations are dropped.
+ * @param	reactor_p		The reactor object.
+ * @param	fd				File descriptor for the serial port.
+ * @return	0 on success, 1 on error.
+ */
+int serial_reactor_remove(serial_reactor_t * reactor_p, int fd)
+{
+	int error = 0;
+	serial_reactor_port_t * port_p;
+
+	port_p = serial_reactor_get_port(reactor_p, fd);
+	if (port_p == NULL) {
+		fprintf(stderr, "Port %d is not part of the reactor.\n", fd);
+		error = 1;
+	}
+
+	if (!error) {
+		epoll_ctl(reactor_p->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+		port_p->fd = -1;
+		reactor_p->port_count--;
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Set the deadline of a port.
+ * @param	reactor_p		The reactor object.
+ * @param	fd				File descriptor for the serial port.
+ * @param	timeout			Time from now after which a timeout event is delivered, 0 clears the deadline.
+ * @return	0 on success, 1 on error.
+ */
+int serial_reactor_set_deadline(serial_reactor_t * reactor_p, int fd, double timeout)
+{
+	int error = 0;
+	serial_reactor_port_t * port_p;
+
+	port_p = serial_reactor_get_port(reactor_p, fd);
+	if (port_p == NULL) {
+		fprintf(stderr, "Port %d is not part of the reactor.\n", fd);
+		error = 1;
+	}
+	else if (timeout <= 0) {
+		port_p->deadline = 0;
+	}
+	else {
+		port_p->deadline = serial_reactor_get_time() + (unsigned long long) llrint(timeout * 1e9);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Start reading from a port.
+ *
+ * Completes with serial_reactor_read_complete once all data is received, or
+ * with serial_reactor_timeout when the timeout expires first.
+ *
+ * @param	reactor_p		The reactor object.
+ * @param	fd				File descriptor for the serial port.
+ * @param	data			Buffer to read data into, must stay valid until completion.
+ * @param	size			Amount of data to read, at least 1.
+ * @param	timeout			Timeout for the read, 0 for none.
+ * @return	0 on success, 1 on error.
+ */
+int serial_reactor_read(serial_reactor_t * reactor_p, int fd, char * data, size_t size, double timeout)
+{
+	int error = 0;
+	serial_reactor_port_t * port_p;
+
+	port_p = serial_reactor_get_port(reactor_p, fd);
+	if (port_p == NULL) {
+		fprintf(stderr, "Port %d is not part of the reactor.\n", fd);
+		error = 1;
+	}
+	else if (port_p->read_data != NULL) {
+		fprintf(stderr, "A read is already pending on port %d.\n", fd);
+		error = 1;
+	}
+	else if (size == 0) {
+		// Nothing would ever complete it.
+		fprintf(stderr, "Cannot start an empty read on port %d.\n", fd);
+		error = 1;
+	}
+
+	if (!error) {
+		port_p->read_data = data;
+		port_p->read_size = size;
+		port_p->read_done = 0;
+		error = serial_reactor_set_deadline(reactor_p, fd, timeout);
+	}
+
+	if (!error) {
+		error = serial_reactor_update_events(reactor_p, port_p);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Start writing to a port.
+ *
+ * As much data as possible is written immediately, the rest is sent when the
+ * port becomes writable. Completes with serial_reactor_write_complete.
+ *
+ * @param	reactor_p		The reactor object.
+ * @param	fd				File descriptor for the serial port.
+ * @param	data			Data to write, must stay valid until completion.
+ * @param	size			Amount of data to write.
+ * @return	0 on success, 1 on error.
+ */
+int serial_reactor_write(serial_reactor_t * reactor_p, int fd, const char * data, size_t size)
+{
+	int error = 0;
+	serial_reactor_port_t * port_p;
+
+	port_p = serial_reactor_get_port(reactor_p, fd);
+	if (port_p == NULL) {
+		fprintf(stderr, "Port %d is not part of the reactor.\n", fd);
+		error = 1;
+	}
+	else if (port_p->write_data != NULL) {
+		fprintf(stderr, "A write is already pending on port %d.\n", fd);
+		error = 1;
+	}
+
+	if (!error) {
+		ssize_t written_size;
+
+		port_p->write_data = data;
+		port_p->write_size = size;
+		port_p->write_done = 0;
+
+		// Try to send the data right away.
+		written_size = write(fd, data, size);
+		if (written_size > 0) {
+			WIRE_CAPTURE(fd, wire_capture_tx, data, written_size);
+			port_p->write_done = written_size;
+		}
+		else if ((written_size < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+			fprintf(stderr, "Could not send serial data on port %d: %s\n", fd, strerror(errno));
+			port_p->write_data = NULL;
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		// Wait for the port to become writable for the remainder, or to report completion.
+		error = serial_reactor_update_events(reactor_p, port_p);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Wait for and dispatch events once.
+ * @param	reactor_p		The reactor object.
+ * @param	timeout			Maximum time to wait, negative to wait for the nearest deadline.
+ * @return	0 on success, 1 on error.
+ */
+int serial_reactor_run_once(serial_reactor_t * reactor_p, double timeout)
+{
+	int error = 0;
+	struct epoll_event events[SERIAL_REACTOR_MAX_PORTS];
+	unsigned long long now = serial_reactor_get_time();
+	long long wait_time = (timeout < 0) ? -1 : (long long) ceil(timeout * 1e3);
+	int event_count;
+	int i;
+
+	// Do not sleep past the nearest deadline.
+	for (i = 0; i < SERIAL_REACTOR_MAX_PORTS; i++) {
+		serial_reactor_port_t * port_p = &reactor_p->ports[i];
+
+		if ((port_p->fd != -1) && (port_p->deadline != 0)) {
+			long long deadline_time = (port_p->deadline > now) ? (long long) ((port_p->deadline - now + 999999) / 1000000) : 0;
+
+			if ((wait_time < 0) || (deadline_time < wait_time)) {
+				wait_time = deadline_time;
+			}
+		}
+	}
+
+	event_count = epoll_wait(reactor_p->epoll_fd, events, SERIAL_REACTOR_MAX_PORTS, (int) wait_time);
+	if (event_count < 0) {
+		if (errno != EINTR) {
+			fprintf(stderr, "Failed to wait for serial events: %s\n", strerror(errno));
+			error = 1;
+		}
+		event_count = 0;
+	}
+
+	for (i = 0; i < event_count; i++) {
+		serial_reactor_port_t * port_p = events[i].data.ptr;
+
+		// The port may have been removed by an earlier callback.
+		if (port_p->fd == -1) {
+			continue;
+		}
+
+		if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+			// These are reported whatever the interest, stop watching the port or they never end.
+			epoll_ctl(reactor_p->epoll_fd, EPOLL_CTL_DEL, port_p->fd, NULL);
+			port_p->read_data = NULL;
+			port_p->write_data = NULL;
+			port_p->deadline = 0;
+			port_p->callback(port_p->user_data, port_p->fd, serial_reactor_error, 0);
+			continue;
+		}
+		if (events[i].events & EPOLLOUT) {
+			serial_reactor_handle_write(reactor_p, port_p);
+		}
+		if ((events[i].events & EPOLLIN) && (port_p->fd != -1)) {
+			serial_reactor_handle_read(reactor_p, port_p);
+		}
+	}
+
+	serial_reactor_handle_deadlines(reactor_p);
+
+	return error;
+}
+
+/**
+ * @brief	Dispatch events until no port has a pending operation or deadline.
+ * @param	reactor_p		The reactor object.
+ * @return	0 on success, 1 on error.
+ */
+int serial_reactor_run(serial_reactor_t * reactor_p)
+{
+	int error = 0;
+	bool pending = true;
+	size_t i;
+
+	while (pending && !error) {
+		pending = false;
+		for (i = 0; (i < SERIAL_REACTOR_MAX_PORTS) && !pending; i++) {
+			serial_reactor_port_t * port_p = &reactor_p->ports[i];
+
+			pending = (port_p->fd != -1) &&
+					((port_p->read_data != NULL) || (port_p->write_data != NULL) || (port_p->deadline != 0));
+		}
+
+		if (pending) {
+			error = serial_reactor_run_once(reactor_p, -1);
+		}
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Find the state of a registered port.
+ * @param	reactor_p		The reactor object.
+ * @param	fd				File descriptor for the serial port.
+ * @return	The port state, or NULL if the port is not registered.
+ */
+static serial_reactor_port_t * serial_reactor_get_port(serial_reactor_t * reactor_p, int fd)
+{
+	serial_reactor_port_t * port_p = NULL;
+	size_t i;
+
+	for (i = 0; (i < SERIAL_REACTOR_MAX_PORTS) && (port_p == NULL) && (fd != -1); i++) {
+		if (reactor_p->ports[i].fd == fd) {
+			port_p = &reactor_p->ports[i];
+		}
+	}
+
+	return port_p;
+}
+
+/**
+ * @brief	Update the epoll interest of a port to match its pending operations.
+ * @param	reactor_p		The reactor object.
+ * @param	port_p			The port state.
+ * @return	0 on success, 1 on error.
+ */
+static int serial_reactor_update_events(serial_reactor_t * reactor_p, serial_reactor_port_t * port_p)
+{
+	int error = 0;
+	struct epoll_event event;
+
+	event.events = 0;
+	if (port_p->read_data != NULL) {
+		event.events |= EPOLLIN;
+	}
+	if (port_p->write_data != NULL) {
+		event.events |= EPOLLOUT;
+	}
+	event.data.ptr = port_p;
+
+	if (event.events != port_p->events) {
+		if (epoll_ctl(reactor_p->epoll_fd, EPOLL_CTL_MOD, port_p->fd, &event) == -1) {
+			fprintf(stderr, "Failed to update port %d in the reactor: %s\n", port_p->fd, strerror(errno));
+			error = 1;
+		}
+		else {
+			port_p->events = event.events;
+		}
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Handle a readable port.
+ * @param	reactor_p		The reactor object.
+ * @param	port_p			The port state.
+ * @return	None.
+ */
+static void serial_reactor_handle_read(serial_reactor_t * reactor_p, serial_reactor_port_t * port_p)
+{
+	ssize_t read_result;
+
+	if (port_p->read_data == NULL) {
+		// Nobody asked for the data, stop watching for input until a read starts.
+		serial_reactor_update_events(reactor_p, port_p);
+	}
+	else {
+		read_result = read(port_p->fd, &(port_p->read_data[port_p->read_done]), port_p->read_size - port_p->read_done);
+
+		if (read_result > 0) {
+			WIRE_CAPTURE(port_p->fd, wire_capture_rx, &(port_p->read_data[port_p->read_done]), read_result);
+			port_p->read_done += read_result;
+		}
+		else if ((read_result < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+			fprintf(stderr, "Failed to read data from port %d: %s.\n", port_p->fd, strerror(errno));
+			port_p->read_data = NULL;
+			port_p->deadline = 0;
+			port_p->callback(port_p->user_data, port_p->fd, serial_reactor_error, port_p->read_done);
+			return;
+		}
+
+		if (port_p->read_done == port_p->read_size) {
+			port_p->read_data = NULL;
+			port_p->deadline = 0;
+			port_p->callback(port_p->user_data, port_p->fd, serial_reactor_read_complete, port_p->read_done);
+		}
+	}
+}
+
+/**
+ * @brief	Handle a writable port.
+ * @param	reactor_p		The reactor object.
+ * @param	port_p			The port state.
+ * @return	None.
+ */
+static void serial_reactor_handle_write(serial_reactor_t * reactor_p, serial_reactor_port_t * port_p)
+{
+	ssize_t written_size;
+
+	if (port_p->write_data == NULL) {
+		return;
+	}
+
+	if (port_p->write_done < port_p->write_size) {
+		written_size = write(port_p->fd, &(port_p->write_data[port_p->write_done]), port_p->write_size - port_p->write_done);
+
+		if (written_size > 0) {
+			WIRE_CAPTURE(port_p->fd, wire_capture_tx, &(port_p->write_data[port_p->write_done]), written_size);
+			port_p->write_done += written_size;
+		}
+		else if ((written_size < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+			fprintf(stderr, "Could not send serial data on port %d: %s\n", port_p->fd, strerror(errno));
+			port_p->write_data = NULL;
+			serial_reactor_update_events(reactor_p, port_p);
+			port_p->callback(port_p->user_data, port_p->fd, serial_reactor_error, port_p->write_done);
+			return;
+		}
+	}
+
+	if (port_p->write_done == port_p->write_size) {
+		port_p->write_data = NULL;
+		serial_reactor_update_events(reactor_p, port_p);
+		port_p->callback(port_p->user_data, port_p->fd, serial_reactor_write_complete, port_p->write_done);
+	}
+}
+
+/**
+ * @brief	Deliver timeout events for all expired deadlines.
+ * @param	reactor_p		The reactor object.
+ * @return	None.
+ */
+static void serial_reactor_handle_deadlines(serial_reactor_t * reactor_p)
+{
+	unsigned long long now = serial_reactor_get_time();
+	size_t i;
+
+	for (i = 0; i < SERIAL_REACTOR_MAX_PORTS; i++) {
+		serial_reactor_port_t * port_p = &reactor_p->ports[i];
+
+		if ((port_p->fd != -1) && (port_p->deadline != 0) && (port_p->deadline <= now)) {
+			size_t read_done = port_p->read_done;
+
+			// A timeout cancels the pending read.
+			port_p->deadline = 0;
+			if (port_p->read_data == NULL) {
+				read_done = 0;
+			}
+			port_p->read_data = NULL;
+			port_p->callback(port_p->user_data, port_p->fd, serial_reactor_timeout, read_done);
+		}
+	}
+}
+
+/**
+ * @brief	Get the monotonic time.
+ * @return	Time in nanoseconds.
+ */
+static unsigned long long serial_reactor_get_time(void)
+{
+	struct timespec time;
+
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return (unsigned long long) time.tv_sec * 1000000000ull + (unsigned long long) time.tv_nsec;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,90 @@
+/**
+ * @file	serial_reactor.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the multi-port serial reactor.
+ */
+
+#ifndef SERIAL_REACTOR_H_
+#define SERIAL_REACTOR_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @addtogroup serial_reactor
+ * @{
+ */
+
+/**
+ * @brief Maximum number of ports a single reactor can multiplex.
+ */
+#define SERIAL_REACTOR_MAX_PORTS	(64)
+
+/**
+ * @brief Events delivered to the port callback.
+ */
+typedef enum
+{
+	serial_reactor_read_complete,	/**< A pending read received all requested data.	*/
+	serial_reactor_write_complete,	/**< A pending write has been sent completely.		*/
+	serial_reactor_timeout,			/**< The deadline of the port expired.				*/
+	serial_reactor_error			/**< The port reported an error or hang-up.			*/
+} serial_reactor_event;
+
+/**
+ * @brief	Port event callback.
+ * @param	user_data		User data passed to serial_reactor_add().
+ * @param	fd				File descriptor of the port.
+ * @param	event			The event that occurred.
+ * @param	size			Amount of data transferred (completion and timeout events).
+ */
+typedef void (*serial_reactor_callback)(void * user_data, int fd, serial_reactor_event event, size_t size);
+
+/**
+ * @brief State of a single port in the reactor.
+ */
+typedef struct
+{
+	int						fd;				/**< File descriptor, -1 when the slot is free.	*/
+	serial_reactor_callback	callback;		/**< Event callback.							*/
+	void *					user_data;		/**< User data for the callback.				*/
+	char *					read_data;		/**< Buffer of the pending read, or NULL.		*/
+	size_t					read_size;		/**< Size of the pending read.					*/
+	size_t					read_done;		/**< Data received for the pending read.		*/
+	const char *			write_data;		/**< Data of the pending write, or NULL.		*/
+	size_t					write_size;		/**< Size of the pending write.					*/
+	size_t					write_done;		/**< Data sent for the pending write.			*/
+	unsigned long long		deadline;		/**< Monotonic deadline in ns, 0 = none.		*/
+	unsigned int			events;			/**< Epoll events the port is watched for.		*/
+} serial_reactor_port_t;
+
+/**
+ * @brief Reactor object.
+ */
+typedef struct
+{
+	int						epoll_fd;							/**< The epoll instance.	*/
+	serial_reactor_port_t	ports[SERIAL_REACTOR_MAX_PORTS];	/**< Registered ports.		*/
+	size_t					port_count;							/**< Registered port count.	*/
+} serial_reactor_t;
+
+serial_reactor_t * serial_reactor_construct(void);
+void serial_reactor_destroy(serial_reactor_t * reactor_p);
+
+int serial_reactor_add(serial_reactor_t * reactor_p, int fd, serial_reactor_callback callback, void * user_data);
+int serial_reactor_remove(serial_reactor_t * reactor_p, int fd);
+
+int serial_reactor_set_deadline(serial_reactor_t * reactor_p, int fd, double timeout);
+int serial_reactor_read(serial_reactor_t * reactor_p, int fd, char * data, size_t size, double timeout);
+int serial_reactor_write(serial_reactor_t * reactor_p, int fd, const char * data, size_t size);
+
+int serial_reactor_run_once(serial_reactor_t * reactor_p, double timeout);
+int serial_reactor_run(serial_reactor_t * reactor_p);
+
+/**
+ * @}
+ */
+
+#endif /* SERIAL_REACTOR_H_ */
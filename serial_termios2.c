@@ -0,0 +1,87 @@
+/**
+ * @file	serial_termios2.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the termios2 helpers of the serial library.
+ *
+ * The kernel termios2 interface allows arbitrary baud rates through BOTHER.
+ * Its definitions clash with the libc termios.h, so they live in this
+ * separate translation unit.
+ */
+
+#include <asm/ioctls.h>
+#include <asm/termbits.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include "serial_termios2.h"
+
+/**
+ * @addtogroup serial
+ * @{
+ */
+
+/**
+ * @brief	Set an arbitrary baud rate.
+ * @param	fd				File descriptor for the serial port.
+ * @param	baudrate		The desired baud rate in baud.
+ * @return	0 on success, 1 on error.
+ */
+int serial_termios2_set_baudrate(int fd, unsigned int baudrate)
+{
+	int error = 0;
+	struct termios2 options;
+
+	// Get the current options.
+	if (ioctl(fd, TCGETS2, &options) == -1) {
+		fprintf(stderr, "Could not get the serial options: %s\n", strerror(errno));
+		error = 1;
+	}
+
+	if (!error) {
+		// Set the baud rate for both directions.
+		options.c_cflag &= ~CBAUD;
+		options.c_cflag |= BOTHER;
+		options.c_cflag &= ~(CBAUD << IBSHIFT);
+		options.c_cflag |= BOTHER << IBSHIFT;
+		options.c_ispeed = baudrate;
+		options.c_ospeed = baudrate;
+
+		// Write the options to the port.
+		if (ioctl(fd, TCSETS2, &options) == -1) {
+			fprintf(stderr, "Could not set the baud rate to %u: %s\n", baudrate, strerror(errno));
+			error = 1;
+		}
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Get the baud rate the driver actually configured.
+ * @param	fd				File descriptor for the serial port.
+ * @param	baudrate_p		Location to store the baud rate in baud.
+ * @return	0 on success, 1 on error.
+ */
+int serial_termios2_get_baudrate(int fd, unsigned int * baudrate_p)
+{
+	int error = 0;
+	struct termios2 options;
+
+	if (ioctl(fd, TCGETS2, &options) == -1) {
+		fprintf(stderr, "Could not get the serial options: %s\n", strerror(errno));
+		error = 1;
+	}
+	else {
+		*baudrate_p = options.c_ospeed;
+	}
+
+	return error;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,24 @@
+/**
+ * @file	serial_termios2.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the termios2 helpers of the serial library.
+ */
+
+#ifndef SERIAL_TERMIOS2_H_
+#define SERIAL_TERMIOS2_H_
+
+/**
+ * @addtogroup serial
+ * @{
+ */
+
+int serial_termios2_set_baudrate(int fd, unsigned int baudrate);
+int serial_termios2_get_baudrate(int fd, unsigned int * baudrate_p);
+
+/**
+ * @}
+ */
+
+#endif /* SERIAL_TERMIOS2_H_ */
@@ -0,0 +1,444 @@
+/**
+ * @file	bsl-bench.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	End-to-end flash and verify throughput benchmark.
+ *
+ * Erases, writes and reads back an image through the regular device layer and
+ * reports the achieved throughput. Runs against a serial port (a real board
+ * or the bsl-sim pseudo-terminal), a serial device server given as
+ * tcp://host:port or rfc2217://host:port, or, with -S, against an in-process
+ * simulator over the loopback transport. Times are taken from the clock of the
+ * transport, so with -S they are the predicted durations on a real link,
+ * computed in virtual time, and the CPU time spent is reported separately.
+ * With -w the traffic on a serial port or network link is captured to a file
+ * that wire-decode renders as annotated frames.
+ *
+ * Build: gcc -I.. -o bsl-bench bsl-bench.c ../bsl.c ../bsl_core.c ../device.c ../serial.c ../serial_termios2.c
+ *        ../wire_capture.c ../transport.c ../transport_serial.c ../transport_loopback.c ../transport_tcp.c ../rfc2217.c ../bsl_simulator.c ../checksum.c -lm
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bsl.h"
+#include "bsl_simulator.h"
+#include "device.h"
+#include "serial.h"
+#include "transport_loopback.h"
+#include "transport_serial.h"
+#include "transport_tcp.h"
+#include "wire_capture.h"
+
+static void bsl_bench_usage(const char * name)
+{
+	fprintf(stderr,
+			"Usage: %s (-p port | -S [-C] [-n rate] [-d rate] [-L latency] [-B baud]) [-m] [-b baud] [-a address] [-s size] [-k] [-u count] [-H dir] [-t] [-c attempts] [-l] [-w file]\n"
+			"  -p port     Serial port of the target, or tcp://host:port or rfc2217://host:port.\n"
+			"  -S          Use an in-process simulator instead of a serial port.\n"
+			"  -C          Simulate a 5xx/6xx device with the core command BSL.\n"
+			"  -n rate     Probability the simulator answers a frame with a NAK.\n"
+			"  -d rate     Probability the simulator drops a response byte.\n"
+			"  -L latency  Adapter latency added to every simulated response, in ms.\n"
+			"  -B baud     Highest line rate the simulated link sustains.\n"
+			"  -m          Send the synchronization character together with each command.\n"
+			"  -b baud     Highest line rate to negotiate (default 115200).\n"
+			"  -a address  Start address of the image (default 0x8000).\n"
+			"  -s size     Size of the image in bytes (default 32768).\n"
+			"  -k          Keep the flash outside the image, erase only the segments it covers.\n"
+			"  -u count    Then change count bytes of the image and update only what differs.\n"
+			"  -H dir      Keep an image history of the device in dir and program by update.\n"
+			"  -t          Verify with a checksum on the target instead of reading the image back.\n"
+			"  -c attempts Shorten the entry sequence while this many entries in a row succeed.\n"
+			"  -l          Tune the link for low latency and report the round trip before and after.\n"
+			"  -w file     Capture the most recent traffic on the port to file, not with -S.\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	int error = 0;
+	const char * port = NULL;
+	bool simulate = false;
+	bool core = false;
+	bool merge_sync = false;
+	double nak_rate = 0;
+	double drop_rate = 0;
+	double latency = 0;
+	unsigned int link_baudrate = 0;
+	unsigned int max_baudrate = 115200;
+	unsigned int address = 0x8000;
+	size_t size = 32768;
+	size_t changes = 0;
+	double update_time = 0;
+	const char * history_directory = NULL;
+	const char * capture_filename = NULL;
+	int fd = -1;
+	bsl_simulator_t * simulator_p = NULL;
+	transport_t * transport_p = NULL;
+	bsl_object_t * bsl_object_p = NULL;
+	device_object_t * device_object_p = NULL;
+	unsigned char * image = NULL;
+	unsigned char * read_back = NULL;
+	unsigned char password[32];
+	bool keep_untouched = false;
+	bool verify_on_target = false;
+	unsigned int calibration_attempts = 0;
+	unsigned int settle_time;
+	bool low_latency = false;
+	double latency_before;
+	double latency_after;
+	device_range_t range;
+	device_erase_plan_t plan = {NULL, 0, 0};
+	double erase_time = 0;
+	double blank_time = 0;
+	unsigned long non_blank = 0;
+	double start;
+	double write_time = 0;
+	double read_time = 0;
+	bsl_statistics_t statistics;
+	unsigned long write_round_trips = 0;
+	unsigned long read_round_trips = 0;
+	unsigned long allocations = 0;
+	clock_t cpu_start = clock();
+	size_t i;
+	int option;
+
+	while ((option = getopt(argc, argv, "p:SCn:d:L:B:mb:a:s:ku:H:tc:lw:h")) != -1) {
+		switch (option)
+		{
+		case 'p':
+			port = optarg;
+			break;
+		case 'S':
+			simulate = true;
+			break;
+		case 'C':
+			core = true;
+			break;
+		case 'n':
+			nak_rate = strtod(optarg, NULL);
+			break;
+		case 'd':
+			drop_rate = strtod(optarg, NULL);
+			break;
+		case 'L':
+			latency = strtod(optarg, NULL) / 1e3;
+			break;
+		case 'B':
+			link_baudrate = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			merge_sync = true;
+			break;
+		case 'b':
+			max_baudrate = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			address = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			size = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			keep_untouched = true;
+			break;
+		case 'u':
+			changes = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			history_directory = optarg;
+			break;
+		case 't':
+			verify_on_target = true;
+			break;
+		case 'c':
+			calibration_attempts = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			low_latency = true;
+			break;
+		case 'w':
+			capture_filename = optarg;
+			break;
+		default:
+			bsl_bench_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if ((port == NULL) == !simulate) {
+		bsl_bench_usage(argv[0]);
+		return 1;
+	}
+
+	if (simulate && (capture_filename != NULL)) {
+		// The loopback transport makes no system calls, so there is nothing on a wire.
+		fprintf(stderr, "The in-process simulator cannot be captured, run bsl-sim and use -p instead.\n");
+		return 1;
+	}
+
+	image = malloc(size);
+	read_back = malloc(size);
+	if ((image == NULL) || (read_back == NULL)) {
+		fprintf(stderr, "Failed to allocate memory for the image.\n");
+		error = 1;
+	}
+
+	if (!error) {
+		// A reproducible image.
+		for (i = 0; i < size; i++) {
+			image[i] = (unsigned char) (i * 7 + (i >> 8));
+		}
+	}
+
+	if (!error && simulate) {
+		bsl_simulator_settings_t settings;
+
+		if (core) {
+			bsl_simulator_get_core_settings(&settings);
+		}
+		else {
+			bsl_simulator_get_default_settings(&settings);
+		}
+		settings.nak_rate = nak_rate;
+		settings.drop_rate = drop_rate;
+		settings.max_baudrate = link_baudrate;
+		simulator_p = bsl_simulator_construct(&settings);
+		if (simulator_p != NULL) {
+			transport_p = transport_loopback_construct(&bsl_simulator_peer, simulator_p);
+		}
+		if (transport_p != NULL) {
+			transport_loopback_set_latency(transport_p, latency);
+		}
+	}
+	else if (!error && (strstr(port, "://") != NULL)) {
+		transport_p = transport_tcp_construct_from_url(port);
+	}
+	else if (!error) {
+		serial_settings_t serial_settings = {baudrate_9600, even, stopbits_1, databits_8, false, true};
+
+		fd = serial_open(port, serial_settings);
+		if (fd != -1) {
+			transport_p = transport_serial_construct(fd);
+		}
+	}
+
+	if (!error && (transport_p == NULL)) {
+		error = 1;
+	}
+
+	if (!error && (capture_filename != NULL)) {
+		wire_capture_enable(true);
+	}
+
+	if (!error) {
+		bsl_object_p = bsl_construct(transport_p);
+		device_object_p = (bsl_object_p != NULL) ? device_construct(bsl_object_p) : NULL;
+		if (device_object_p == NULL) {
+			error = 1;
+		}
+		else {
+			device_set_max_baudrate(device_object_p, max_baudrate);
+			if (merge_sync) {
+				bsl_set_sync_mode(bsl_object_p, bsl_sync_merged);
+			}
+		}
+	}
+
+	if (!error && (calibration_attempts > 0)) {
+		error = bsl_calibrate_entry_sequence(bsl_object_p, calibration_attempts, &settle_time);
+		if (!error) {
+			printf("Calibrated BSL entry sequence, settle time %u us.\n", settle_time);
+		}
+	}
+
+	if (!error) {
+		// An erased device has all vectors, and thus the password, at 0xFF.
+		memset(password, 0xFF, sizeof(password));
+		error = device_initialize(device_object_p, password);
+	}
+
+	if (!error) {
+		printf("Chip ID 0x%04x, BSL version 0x%04x, %u baud\n",
+				device_get_chip_id(device_object_p), device_get_bsl_version(device_object_p),
+				device_get_baudrate(device_object_p));
+		if (history_directory != NULL) {
+			error = device_open_history(device_object_p, history_directory, 1);
+		}
+	}
+
+	if (!error && low_latency && (device_get_protocol(device_object_p) != device_protocol_legacy)) {
+		fprintf(stderr, "The round trip is measured with synchronizations, only a ROM BSL answers them.\n");
+	}
+	else if (!error && low_latency) {
+		error = bsl_enable_low_latency(bsl_object_p, &latency_before, &latency_after);
+		if (!error) {
+			printf("Round trip latency: %.3f ms before, %.3f ms after low latency tuning.\n",
+					latency_before * 1e3, latency_after * 1e3);
+		}
+	}
+
+	if (!error) {
+		// Erase what the image needs, the whole main memory unless the rest is kept.
+		range.address = address;
+		range.length = size;
+		error = device_plan_erase(device_object_p, &range, 1, keep_untouched, &plan);
+	}
+
+	if (!error) {
+		start = transport_get_time(transport_p);
+		error = device_execute_erase_plan(device_object_p, &plan);
+		erase_time = transport_get_time(transport_p) - start;
+	}
+
+	if (!error) {
+		// The target checks the erase, nothing is read back.
+		start = transport_get_time(transport_p);
+		error = device_check_blank(device_object_p, address, size, &non_blank);
+		blank_time = transport_get_time(transport_p) - start;
+	}
+
+	if (!error && (non_blank != address + size)) {
+		fprintf(stderr, "Flash at 0x%05lx is not blank after the erase.\n", non_blank);
+		error = 1;
+	}
+
+	if (!error) {
+		allocations = bsl_get_allocation_count();
+		bsl_clear_statistics(bsl_object_p);
+		start = transport_get_time(transport_p);
+		if (history_directory != NULL) {
+			// The update records what it programs.
+			error = device_update_memory(device_object_p, address, image, size);
+		}
+		else {
+			error = device_write_memory(device_object_p, address, image, size);
+		}
+		write_time = transport_get_time(transport_p) - start;
+		bsl_get_statistics(bsl_object_p, &statistics);
+		write_round_trips = statistics.round_trips;
+	}
+
+	if (!error && (address <= 0xFFE0) && (address + size >= 0x10000)) {
+		// The image brings its own vectors, and with them the password of a locked BSL.
+		memcpy(password, &(image[0xFFE0 - address]), sizeof(password));
+	}
+
+	if (!error) {
+		bsl_clear_statistics(bsl_object_p);
+		start = transport_get_time(transport_p);
+		if (verify_on_target) {
+			// Only checksums come back, the image stays on the target.
+			error = device_verify_memory(device_object_p, address, image, size, password);
+		}
+		else {
+			error = device_read_memory(device_object_p, address, read_back, size);
+		}
+		read_time = transport_get_time(transport_p) - start;
+		bsl_get_statistics(bsl_object_p, &statistics);
+		read_round_trips = statistics.round_trips;
+		allocations = bsl_get_allocation_count() - allocations;
+	}
+
+	if (!error && !verify_on_target && (memcmp(image, read_back, size) != 0)) {
+		fprintf(stderr, "Verification failed.\n");
+		error = 1;
+	}
+
+	if (!error) {
+		printf("Erase:  %zu commands in %.3f s, %.3f s planned\n", plan.count, erase_time, plan.time);
+		printf("Blank:  %zu bytes checked in %.3f s\n", size, blank_time);
+		printf("Write:  %zu bytes in %.3f s, %.0f bytes/s, %.1f round trips/KB\n",
+				size, write_time, size / write_time, write_round_trips * 1024.0 / size);
+		printf("Verify: %zu bytes in %.3f s, %.0f bytes/s, %.1f round trips/KB\n",
+				size, read_time, size / read_time, read_round_trips * 1024.0 / size);
+		printf("Heap allocations during the transfer: %lu\n", allocations);
+	}
+
+	if (!error && (changes > 0)) {
+		// Spread the changes over the image, they need an erase to take effect.
+		for (i = 0; i < changes; i++) {
+			image[i * size / changes] ^= 0x5A;
+		}
+
+		start = transport_get_time(transport_p);
+		error = device_update_memory(device_object_p, address, image, size);
+		update_time = transport_get_time(transport_p) - start;
+
+		if (!error && verify_on_target) {
+			error = device_verify_memory(device_object_p, address, image, size, password);
+		}
+		else if (!error) {
+			error = device_read_memory(device_object_p, address, read_back, size);
+			if (!error && (memcmp(image, read_back, size) != 0)) {
+				fprintf(stderr, "Verification of the update failed.\n");
+				error = 1;
+			}
+		}
+		if (!error) {
+			printf("Update: %zu bytes changed in %.3f s\n", changes, update_time);
+		}
+	}
+
+	if (device_object_p != NULL) {
+		device_statistics_t device_statistics;
+
+		device_get_statistics(device_object_p, &device_statistics);
+		printf("Link: %lu blocks, %lu retries, %lu resyncs, %lu baudrate fallbacks, %lu failed blocks\n",
+				device_statistics.blocks, device_statistics.retries, device_statistics.resyncs,
+				device_statistics.baudrate_fallbacks, device_statistics.failures);
+		if (device_statistics.time > 0) {
+			printf("Frames: %zu to %zu bytes, %lu bytes at %.0f bytes/s\n",
+					device_statistics.min_frame_size, device_statistics.max_frame_size,
+					device_statistics.bytes, device_statistics.bytes / device_statistics.time);
+		}
+		if (device_statistics.segments_compared > 0) {
+			printf("Segments: %lu compared, %lu rewritten, %lu image bytes skipped\n",
+					device_statistics.segments_compared, device_statistics.segments_rewritten,
+					device_statistics.bytes_skipped);
+		}
+		if (history_directory != NULL) {
+			printf("History: %lu segments recalled, %lu spot checks\n",
+					device_statistics.segments_recalled, device_statistics.spot_checks);
+		}
+	}
+
+	if ((simulator_p != NULL) && (transport_p != NULL)) {
+		printf("Predicted session time %.6f s in %.6f s of CPU time\n",
+				transport_get_time(transport_p), (double) (clock() - cpu_start) / CLOCKS_PER_SEC);
+		printf("Simulator: %lu syncs, %lu commands, %lu NAKs, %lu dropped bytes\n",
+				simulator_p->statistics.syncs, simulator_p->statistics.commands,
+				simulator_p->statistics.naks, simulator_p->statistics.dropped);
+	}
+
+	if (capture_filename != NULL) {
+		// Also keep the traffic of a failed session, that is when it is needed most.
+		wire_capture_enable(false);
+		error |= wire_capture_dump(capture_filename);
+	}
+
+	device_release_erase_plan(&plan);
+	if (device_object_p != NULL) {
+		device_destroy(device_object_p);
+	}
+	if (bsl_object_p != NULL) {
+		bsl_destroy(bsl_object_p);
+	}
+	if (transport_p != NULL) {
+		transport_destroy(transport_p);
+	}
+	if (simulator_p != NULL) {
+		bsl_simulator_destroy(simulator_p);
+	}
+	if (fd != -1) {
+		serial_close(fd);
+	}
+	free(image);
+	free(read_back);
+
+	return error;
+}
@@ -0,0 +1,373 @@
+/**
+ * @file	bsl-sim.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Pseudo-terminal front end for the BSL device simulator.
+ *
+ * Creates a pseudo-terminal that behaves like a serial port with an MSP430 in
+ * BSL mode attached, pacing every response with the simulated UART and flash
+ * times. Point the programmer at the printed device (or at the -l link).
+ *
+ * With -t or -r it stands in for a serial device server instead and accepts
+ * connections on the loopback interface, as a raw TCP stream or with RFC 2217
+ * COM port control. With RFC 2217 the DTR and RTS commands drive the reset
+ * and TEST pins of the simulated device, so the entry sequence is exercised.
+ *
+ * Build: gcc -I.. -o bsl-sim bsl-sim.c ../bsl_simulator.c ../rfc2217.c ../transport.c ../transport_loopback.c ../checksum.c -lm
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bsl_simulator.h"
+#include "rfc2217.h"
+#include "serial.h"
+
+/**
+ * @brief State of one connection to the simulator.
+ */
+typedef struct
+{
+	bsl_simulator_t *	simulator_p;	/**< The simulated device.					*/
+	int					fd;				/**< Pseudo-terminal master or socket.		*/
+	bool				network;		/**< TRUE for a socket.						*/
+	bool				rfc2217;		/**< TRUE if the stream uses RFC 2217.		*/
+	rfc2217_decoder_t	decoder;		/**< Decoder for the received stream.		*/
+	unsigned int		lines;			/**< SERIAL_LINE_* lines set by the client.	*/
+} bsl_sim_connection_t;
+
+static volatile sig_atomic_t bsl_sim_stop = 0;
+
+static void bsl_sim_signal(int signal_number)
+{
+	(void) signal_number;
+
+	bsl_sim_stop = 1;
+}
+
+static void bsl_sim_usage(const char * name)
+{
+	fprintf(stderr,
+			"Usage: %s [-l link | -t port | -r port] [-C] [-n nak_rate] [-d drop_rate] [-c corrupt_rate] [-s seed]\n"
+			"  -l link          Create a symbolic link to the pseudo-terminal.\n"
+			"  -t port          Listen for raw TCP connections on a local port.\n"
+			"  -r port          Listen for RFC 2217 connections on a local port.\n"
+			"  -C               Simulate a 5xx/6xx device with the core command BSL.\n"
+			"  -n nak_rate      Probability of answering a frame with a NAK.\n"
+			"  -d drop_rate     Probability of dropping a response byte.\n"
+			"  -c corrupt_rate  Probability of corrupting a response byte.\n"
+			"  -s seed          Seed for the error injection.\n", name);
+}
+
+static void bsl_sim_send(bsl_sim_connection_t * connection_p, const unsigned char * data, size_t size)
+{
+	if (write(connection_p->fd, data, size) != (ssize_t) size) {
+		fprintf(stderr, "Could not send the response: %s\n", strerror(errno));
+	}
+}
+
+static void bsl_sim_option(void * user_data, unsigned char command, unsigned char option)
+{
+	bsl_sim_connection_t * connection_p = user_data;
+	bool supported = (option == RFC2217_OPTION_BINARY) || (option == RFC2217_OPTION_SUPPRESS_GO_AHEAD)
+			|| (option == RFC2217_OPTION_COM_PORT);
+	unsigned char reply[3];
+
+	if (command == RFC2217_WILL) {
+		bsl_sim_send(connection_p, reply, rfc2217_encode_option(supported ? RFC2217_DO : RFC2217_DONT, option, reply));
+	}
+	else if (command == RFC2217_DO) {
+		bsl_sim_send(connection_p, reply, rfc2217_encode_option(supported ? RFC2217_WILL : RFC2217_WONT, option, reply));
+	}
+}
+
+static void bsl_sim_subnegotiation(void * user_data, const unsigned char * data, size_t size)
+{
+	bsl_sim_connection_t * connection_p = user_data;
+	unsigned char reply[RFC2217_COMMAND_SIZE];
+	unsigned long value = 0;
+	size_t i;
+
+	if ((size < 3) || (data[0] != RFC2217_OPTION_COM_PORT)) {
+		return;
+	}
+
+	for (i = 2; i < size; i++) {
+		value = (value << 8) | data[i];
+	}
+
+	switch (data[1])
+	{
+	case RFC2217_SET_CONTROL:
+		if (value == RFC2217_CONTROL_DTR_ON) {
+			connection_p->lines |= SERIAL_LINE_DTR;
+		}
+		else if (value == RFC2217_CONTROL_DTR_OFF) {
+			connection_p->lines &= ~SERIAL_LINE_DTR;
+		}
+		else if (value == RFC2217_CONTROL_RTS_ON) {
+			connection_p->lines |= SERIAL_LINE_RTS;
+		}
+		else if (value == RFC2217_CONTROL_RTS_OFF) {
+			connection_p->lines &= ~SERIAL_LINE_RTS;
+		}
+		bsl_simulator_set_lines(connection_p->simulator_p, connection_p->lines);
+		break;
+	default:
+		// The line format is not simulated, the host rate is trusted to follow the device.
+		break;
+	}
+
+	// Every command is confirmed with the value in effect.
+	bsl_sim_send(connection_p, reply, rfc2217_encode_command(data[1] + RFC2217_SERVER_OFFSET, value, size - 2, reply));
+}
+
+static const rfc2217_handler_t bsl_sim_handler =
+{
+	bsl_sim_option,
+	bsl_sim_subnegotiation
+};
+
+static void bsl_sim_serve(bsl_sim_connection_t * connection_p)
+{
+	bool connected = true;
+
+	rfc2217_decoder_init(&connection_p->decoder);
+
+	while (connected && !bsl_sim_stop) {
+		struct pollfd poll_fd = {connection_p->fd, POLLIN, 0};
+		unsigned char data[BSL_SIMULATOR_FRAME_SIZE];
+		unsigned char response[2 * BSL_SIMULATOR_FRAME_SIZE];
+		unsigned char encoded[4 * BSL_SIMULATOR_FRAME_SIZE];
+		ssize_t size;
+		size_t response_size;
+		double delay;
+		struct timespec delay_struct;
+
+		if (poll(&poll_fd, 1, 100) <= 0) {
+			continue;
+		}
+
+		size = read(connection_p->fd, data, sizeof(data));
+		if (size <= 0) {
+			// A socket is closed by the client, a pseudo-terminal only ends with the simulator.
+			if (connection_p->network && ((size == 0) || (errno != EINTR))) {
+				connected = false;
+			}
+			continue;
+		}
+
+		if (connection_p->rfc2217) {
+			size = (ssize_t) rfc2217_decode(&connection_p->decoder, &bsl_sim_handler, connection_p, data, (size_t) size);
+		}
+
+		response_size = bsl_simulator_receive(connection_p->simulator_p, data, size, response, sizeof(response), &delay);
+
+		// Pace the response like the real UART and flash would.
+		delay_struct.tv_sec = (time_t) delay;
+		delay_struct.tv_nsec = (long) ((delay - delay_struct.tv_sec) * 1e9);
+		nanosleep(&delay_struct, NULL);
+
+		if ((response_size > 0) && connection_p->rfc2217) {
+			bsl_sim_send(connection_p, encoded, rfc2217_encode_data(response, response_size, encoded));
+		}
+		else if (response_size > 0) {
+			bsl_sim_send(connection_p, response, response_size);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int error = 0;
+	bsl_simulator_settings_t settings;
+	bsl_simulator_t * simulator_p = NULL;
+	bsl_sim_connection_t connection = {NULL, -1, false, false, {0}, 0};
+	const char * link_name = NULL;
+	bool core = false;
+	int tcp_port = 0;
+	int master_fd = -1;
+	int slave_fd = -1;
+	int listen_fd = -1;
+	int option;
+
+	bsl_simulator_get_default_settings(&settings);
+
+	while ((option = getopt(argc, argv, "l:t:r:Cn:d:c:s:h")) != -1) {
+		switch (option)
+		{
+		case 'l':
+			link_name = optarg;
+			break;
+		case 't':
+		case 'r':
+			tcp_port = atoi(optarg);
+			connection.network = true;
+			connection.rfc2217 = (option == 'r');
+			break;
+		case 'C':
+			core = true;
+			break;
+		case 'n':
+			settings.nak_rate = atof(optarg);
+			break;
+		case 'd':
+			settings.drop_rate = atof(optarg);
+			break;
+		case 'c':
+			settings.corrupt_rate = atof(optarg);
+			break;
+		case 's':
+			settings.seed = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			bsl_sim_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (core) {
+		bsl_simulator_settings_t options = settings;
+
+		// Keep the error injection options, whatever their order.
+		bsl_simulator_get_core_settings(&settings);
+		settings.nak_rate = options.nak_rate;
+		settings.drop_rate = options.drop_rate;
+		settings.corrupt_rate = options.corrupt_rate;
+		settings.seed = options.seed;
+	}
+
+	simulator_p = bsl_simulator_construct(&settings);
+	if (simulator_p == NULL) {
+		error = 1;
+	}
+	connection.simulator_p = simulator_p;
+
+	if (!error && connection.network) {
+		struct sockaddr_in address;
+		int value = 1;
+
+		// Only local clients, this is a test stand-in.
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(tcp_port);
+
+		listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+		if ((listen_fd == -1) || setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value))
+				|| bind(listen_fd, (struct sockaddr *) &address, sizeof(address)) || listen(listen_fd, 1)) {
+			fprintf(stderr, "Could not listen on port %d: %s\n", tcp_port, strerror(errno));
+			error = 1;
+		}
+	}
+	else if (!error) {
+		// Create the pseudo-terminal.
+		master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+		if ((master_fd == -1) || grantpt(master_fd) || unlockpt(master_fd)) {
+			fprintf(stderr, "Could not create a pseudo-terminal: %s\n", strerror(errno));
+			error = 1;
+		}
+	}
+
+	if (!error && !connection.network) {
+		struct termios options;
+
+		// Keep the slave open so the terminal survives the programmer closing it, and make it raw.
+		slave_fd = open(ptsname(master_fd), O_RDWR | O_NOCTTY);
+		if (slave_fd == -1) {
+			fprintf(stderr, "Could not open %s: %s\n", ptsname(master_fd), strerror(errno));
+			error = 1;
+		}
+		else {
+			tcgetattr(slave_fd, &options);
+			cfmakeraw(&options);
+			tcsetattr(slave_fd, TCSANOW, &options);
+		}
+	}
+
+	if (!error && (link_name != NULL) && !connection.network) {
+		unlink(link_name);
+		if (symlink(ptsname(master_fd), link_name) == -1) {
+			fprintf(stderr, "Could not create link %s: %s\n", link_name, strerror(errno));
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		if (connection.network) {
+			printf("Simulating chip 0x%04x BSL 0x%04x on %s://127.0.0.1:%d\n", settings.chip_id, settings.bsl_version,
+					connection.rfc2217 ? "rfc2217" : "tcp", tcp_port);
+		}
+		else {
+			printf("Simulating chip 0x%04x BSL 0x%04x on %s\n", settings.chip_id, settings.bsl_version, ptsname(master_fd));
+		}
+		fflush(stdout);
+
+		signal(SIGINT, bsl_sim_signal);
+		signal(SIGTERM, bsl_sim_signal);
+	}
+
+	if (!error && !connection.network) {
+		connection.fd = master_fd;
+		bsl_sim_serve(&connection);
+	}
+
+	while (!error && connection.network && !bsl_sim_stop) {
+		struct pollfd poll_fd = {listen_fd, POLLIN, 0};
+
+		if (poll(&poll_fd, 1, 100) <= 0) {
+			continue;
+		}
+
+		connection.fd = accept(listen_fd, NULL, NULL);
+		if (connection.fd != -1) {
+			int value = 1;
+
+			setsockopt(connection.fd, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+
+			// Every connection starts from a device in BSL mode with released lines.
+			connection.lines = 0;
+			bsl_simulator_reset(simulator_p, true);
+			bsl_sim_serve(&connection);
+			close(connection.fd);
+		}
+	}
+
+	if (simulator_p != NULL) {
+		printf("Syncs %lu, commands %lu, NAKs %lu, dropped %lu, corrupted %lu, simulated time %.3f s\n",
+				simulator_p->statistics.syncs, simulator_p->statistics.commands, simulator_p->statistics.naks,
+				simulator_p->statistics.dropped, simulator_p->statistics.corrupted, simulator_p->statistics.elapsed);
+		bsl_simulator_destroy(simulator_p);
+	}
+
+	if ((link_name != NULL) && !connection.network) {
+		unlink(link_name);
+	}
+	if (listen_fd != -1) {
+		close(listen_fd);
+	}
+	if (slave_fd != -1) {
+		close(slave_fd);
+	}
+	if (master_fd != -1) {
+		close(master_fd);
+	}
+
+	return error;
+}
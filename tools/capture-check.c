@@ -0,0 +1,344 @@
+/**
+ * @file	capture-check.c
+ *
+ * @date	18 oct. 2026
+ * @author	enjschreuder
+ * @brief	Round trip check of the wire capture against the BSL simulator.
+ *
+ * Runs a session through the serial transport to a simulated device on a
+ * pseudo-terminal with capturing enabled, dumps the capture to a file and
+ * decodes it again. Every synchronization and every frame the simulator took
+ * must show up once, with a valid checksum, every synchronization must be
+ * acknowledged and every read must decode to a data response.
+ *
+ * Build: gcc -I.. -o capture-check capture-check.c ../bsl.c ../bsl_core.c ../device.c ../serial.c ../serial_termios2.c
+ *        ../wire_capture.c ../transport.c ../transport_serial.c ../bsl_simulator.c ../transport_loopback.c
+ *        ../checksum.c -lm -lpthread
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bsl.h"
+#include "bsl_simulator.h"
+#include "device.h"
+#include "transport_serial.h"
+#include "wire_capture.h"
+
+#define CAPTURE_CHECK_ADDRESS	(0x8000)
+#define CAPTURE_CHECK_SIZE		(512)
+
+/**
+ * @brief A simulated device on a pseudo-terminal.
+ */
+typedef struct
+{
+	bsl_simulator_t *	simulator_p;	/**< The simulated device.				*/
+	int					master_fd;		/**< Device side of the terminal.		*/
+	int					slave_fd;		/**< Host side of the terminal.			*/
+	pthread_t			thread;			/**< Thread serving the device side.	*/
+	atomic_bool			stop;			/**< Ends the thread.					*/
+} capture_check_board_t;
+
+/**
+ * @brief Lines of the decoded capture.
+ */
+typedef struct
+{
+	unsigned long	syncs;		/**< Synchronizations sent.					*/
+	unsigned long	frames;		/**< Requests with a valid checksum.		*/
+	unsigned long	reads;		/**< Requests for a block of memory.		*/
+	unsigned long	responses;	/**< Data responses with a valid checksum.	*/
+	unsigned long	invalid;	/**< Anything that did not decode cleanly.	*/
+} capture_check_count_t;
+
+static void * capture_check_serve(void * user_data)
+{
+	capture_check_board_t * board_p = user_data;
+
+	while (!atomic_load(&board_p->stop)) {
+		struct pollfd poll_fd = {board_p->master_fd, POLLIN, 0};
+		unsigned char data[BSL_SIMULATOR_FRAME_SIZE];
+		unsigned char response[2 * BSL_SIMULATOR_FRAME_SIZE];
+		ssize_t size;
+		size_t response_size;
+		double delay;
+		struct timespec delay_struct;
+
+		if (poll(&poll_fd, 1, 100) <= 0) {
+			continue;
+		}
+
+		size = read(board_p->master_fd, data, sizeof(data));
+		if (size <= 0) {
+			continue;
+		}
+
+		response_size = bsl_simulator_receive(board_p->simulator_p, data, size, response, sizeof(response), &delay);
+
+		// Pace the response like the real UART and flash would.
+		delay_struct.tv_sec = (time_t) delay;
+		delay_struct.tv_nsec = (long) ((delay - delay_struct.tv_sec) * 1e9);
+		nanosleep(&delay_struct, NULL);
+
+		if ((response_size > 0) && (write(board_p->master_fd, response, response_size) != (ssize_t) response_size)) {
+			fprintf(stderr, "The board could not send the response.\n");
+		}
+	}
+
+	return NULL;
+}
+
+static int capture_check_open(capture_check_board_t * board_p)
+{
+	int error = 0;
+	bsl_simulator_settings_t settings;
+	struct termios options;
+
+	memset(board_p, 0, sizeof(*board_p));
+	board_p->master_fd = -1;
+	board_p->slave_fd = -1;
+
+	bsl_simulator_get_default_settings(&settings);
+	board_p->simulator_p = bsl_simulator_construct(&settings);
+	if (board_p->simulator_p == NULL) {
+		error = 1;
+	}
+
+	if (!error) {
+		board_p->master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+		if ((board_p->master_fd == -1) || grantpt(board_p->master_fd) || unlockpt(board_p->master_fd)) {
+			fprintf(stderr, "Could not create a pseudo-terminal.\n");
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		board_p->slave_fd = open(ptsname(board_p->master_fd), O_RDWR | O_NOCTTY);
+		if (board_p->slave_fd == -1) {
+			fprintf(stderr, "Could not open %s.\n", ptsname(board_p->master_fd));
+			error = 1;
+		}
+		else {
+			tcgetattr(board_p->slave_fd, &options);
+			cfmakeraw(&options);
+			tcsetattr(board_p->slave_fd, TCSANOW, &options);
+		}
+	}
+
+	if (!error && pthread_create(&board_p->thread, NULL, capture_check_serve, board_p)) {
+		fprintf(stderr, "Could not start the thread of the board.\n");
+		error = 1;
+	}
+
+	if (error) {
+		if (board_p->slave_fd != -1) {
+			close(board_p->slave_fd);
+		}
+		if (board_p->master_fd != -1) {
+			close(board_p->master_fd);
+		}
+		if (board_p->simulator_p != NULL) {
+			bsl_simulator_destroy(board_p->simulator_p);
+		}
+	}
+
+	return error;
+}
+
+static void capture_check_close(capture_check_board_t * board_p)
+{
+	atomic_store(&board_p->stop, true);
+	pthread_join(board_p->thread, NULL);
+
+	close(board_p->slave_fd);
+	close(board_p->master_fd);
+	bsl_simulator_destroy(board_p->simulator_p);
+}
+
+static int capture_check_session(capture_check_board_t * board_p)
+{
+	int error = 0;
+	transport_t * transport_p;
+	bsl_object_t * bsl_object_p = NULL;
+	device_object_t * device_object_p = NULL;
+	unsigned char password[32];
+	unsigned char image[CAPTURE_CHECK_SIZE];
+	unsigned char read_back[CAPTURE_CHECK_SIZE];
+	size_t i;
+
+	transport_p = transport_serial_construct(board_p->slave_fd);
+	if (transport_p != NULL) {
+		bsl_object_p = bsl_construct(transport_p);
+	}
+	if (bsl_object_p != NULL) {
+		device_object_p = device_construct(bsl_object_p);
+	}
+
+	if (device_object_p == NULL) {
+		error = 1;
+	}
+	else {
+		// An erased device has all vectors, and thus the password, at 0xFF.
+		memset(password, 0xFF, sizeof(password));
+		error = device_initialize(device_object_p, password);
+	}
+
+	if (!error) {
+		for (i = 0; i < sizeof(image); i++) {
+			image[i] = (unsigned char) (i * 7 + (i >> 8));
+		}
+		error = device_write_memory(device_object_p, CAPTURE_CHECK_ADDRESS, image, sizeof(image));
+	}
+
+	if (!error) {
+		error = device_read_memory(device_object_p, CAPTURE_CHECK_ADDRESS, read_back, sizeof(read_back));
+	}
+	if (!error && (memcmp(image, read_back, sizeof(image)) != 0)) {
+		fprintf(stderr, "The flash differs from the image.\n");
+		error = 1;
+	}
+
+	if (device_object_p != NULL) {
+		device_destroy(device_object_p);
+	}
+	if (bsl_object_p != NULL) {
+		bsl_destroy(bsl_object_p);
+	}
+	if (transport_p != NULL) {
+		transport_destroy(transport_p);
+	}
+
+	return error;
+}
+
+static void capture_check_count(FILE * decoded, capture_check_count_t * count_p)
+{
+	char line[2048];
+	bool sync_pending = false;
+
+	memset(count_p, 0, sizeof(*count_p));
+
+	while (fgets(line, sizeof(line), decoded) != NULL) {
+		if (sync_pending && !strstr(line, " RX  ACK ")) {
+			// The simulator acknowledges every synchronization.
+			fprintf(stderr, "Decoded after a synchronization: %s", line);
+			count_p->invalid++;
+		}
+		sync_pending = false;
+
+		if (strstr(line, "BAD CHECKSUM") || strstr(line, "UNEXPECTED") || strstr(line, "INCOMPLETE") ||
+			strstr(line, "UNKNOWN_COMMAND"))
+		{
+			fprintf(stderr, "Decoded: %s", line);
+			count_p->invalid++;
+		}
+		else if (strstr(line, " TX  SYNC ")) {
+			count_p->syncs++;
+			sync_pending = true;
+		}
+		else if (strstr(line, " TX  ") && strstr(line, "checksum ok")) {
+			count_p->frames++;
+			if (strstr(line, " TX  TX_DATA_BLOCK ")) {
+				count_p->reads++;
+			}
+		}
+		else if (strstr(line, " RX  ACK ") || strstr(line, " RX  NAK ")) {
+			// The device may refuse a request, such as the probe for the core command BSL.
+		}
+		else if (strstr(line, " RX  DATA ") && strstr(line, "checksum ok")) {
+			count_p->responses++;
+		}
+		else {
+			// Raw data outside a frame, such as a request split over several records.
+			fprintf(stderr, "Decoded: %s", line);
+			count_p->invalid++;
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int error = 0;
+	capture_check_board_t board;
+	char filename[] = "/tmp/capture-check-XXXXXX";
+	int file_fd;
+	FILE * decoded = NULL;
+	capture_check_count_t count;
+
+	(void) argc;
+	(void) argv;
+
+	file_fd = mkstemp(filename);
+	if (file_fd == -1) {
+		fprintf(stderr, "Could not create a capture file.\n");
+		error = 1;
+	}
+	else {
+		close(file_fd);
+	}
+
+	if (!error) {
+		error = capture_check_open(&board);
+	}
+
+	if (!error) {
+		wire_capture_clear();
+		wire_capture_enable(true);
+		error = capture_check_session(&board);
+		wire_capture_enable(false);
+
+		if (!error) {
+			error = wire_capture_dump(filename);
+		}
+		if (!error) {
+			decoded = tmpfile();
+			if (decoded == NULL) {
+				fprintf(stderr, "Could not create the decoded file.\n");
+				error = 1;
+			}
+		}
+		if (!error) {
+			error = wire_capture_decode(filename, decoded);
+		}
+
+		if (!error) {
+			rewind(decoded);
+			capture_check_count(decoded, &count);
+
+			// The simulator may take the first character of a refused frame for a synchronization.
+			if ((count.invalid > 0) || (count.reads == 0) || (count.responses != count.reads) ||
+				(count.syncs + count.frames != board.simulator_p->statistics.syncs + board.simulator_p->statistics.commands))
+			{
+				fprintf(stderr, "Decoded %lu syncs, %lu frames, %lu reads, %lu responses and %lu invalid lines, "
+						"the simulator took %lu syncs and %lu frames.\n", count.syncs, count.frames, count.reads,
+						count.responses, count.invalid, board.simulator_p->statistics.syncs,
+						board.simulator_p->statistics.commands);
+				error = 1;
+			}
+		}
+
+		capture_check_close(&board);
+	}
+
+	printf("%-32s %s\n", "capture round trip", error ? "failed" : "passed");
+
+	if (decoded != NULL) {
+		fclose(decoded);
+	}
+	if (file_fd != -1) {
+		unlink(filename);
+	}
+
+	return error;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file	checksum-bench.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Checksum kernel micro-benchmark.
+ *
+ * Checks every supported kernel against the scalar one, then reports the
+ * throughput of each kernel for BSL frame sizes and for large buffers.
+ *
+ * Build: gcc -O2 -I.. -o checksum-bench checksum-bench.c ../checksum.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "checksum.h"
+
+#define CHECKSUM_BENCH_TOTAL_SIZE	(256UL * 1024 * 1024)
+
+static double checksum_bench_get_time(void)
+{
+	struct timespec time;
+
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+	int error = 0;
+	static const size_t sizes[] = {260, 4096, 1024 * 1024};
+	size_t buffer_size = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+	unsigned char * buffer;
+	unsigned short reference_xor16;
+	unsigned char reference_sum8;
+	volatile unsigned int sink = 0;
+	checksum_kernel kernel;
+	size_t i;
+	size_t j;
+
+	(void) argc;
+	(void) argv;
+
+	buffer = malloc(buffer_size);
+	if (buffer == NULL) {
+		fprintf(stderr, "Failed to allocate memory for the buffer.\n");
+		return 1;
+	}
+
+	srand(1);
+	for (i = 0; i < buffer_size; i++) {
+		buffer[i] = (unsigned char) rand();
+	}
+
+	printf("Selected kernel: %s\n", checksum_kernel_name(checksum_get_kernel()));
+
+	// The scalar kernel is the reference, an odd size exercises the tails.
+	checksum_set_kernel(checksum_kernel_scalar);
+	reference_xor16 = checksum_xor16(0, buffer, buffer_size - 3);
+	reference_sum8 = checksum_sum8(0, buffer, buffer_size - 3);
+
+	printf("%-8s %-8s %10s %10s\n", "kernel", "function", "size", "GB/s");
+
+	for (kernel = checksum_kernel_scalar; kernel < checksum_kernel_count; kernel++) {
+		if (!checksum_kernel_supported(kernel)) {
+			printf("%-8s not supported\n", checksum_kernel_name(kernel));
+			continue;
+		}
+
+		checksum_set_kernel(kernel);
+		if ((checksum_xor16(0, buffer, buffer_size - 3) != reference_xor16)
+				|| (checksum_sum8(0, buffer, buffer_size - 3) != reference_sum8)) {
+			fprintf(stderr, "The %s kernel does not match the scalar kernel.\n", checksum_kernel_name(kernel));
+			error = 1;
+		}
+
+		for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+			size_t iterations = CHECKSUM_BENCH_TOTAL_SIZE / sizes[i];
+			double start;
+			double xor16_time;
+			double sum8_time;
+
+			start = checksum_bench_get_time();
+			for (j = 0; j < iterations; j++) {
+				sink += checksum_xor16((unsigned short) j, buffer, sizes[i]);
+			}
+			xor16_time = checksum_bench_get_time() - start;
+
+			start = checksum_bench_get_time();
+			for (j = 0; j < iterations; j++) {
+				sink += checksum_sum8((unsigned char) j, buffer, sizes[i]);
+			}
+			sum8_time = checksum_bench_get_time() - start;
+
+			printf("%-8s %-8s %10zu %10.2f\n", checksum_kernel_name(kernel), "xor16", sizes[i],
+					iterations * sizes[i] / xor16_time / 1e9);
+			printf("%-8s %-8s %10zu %10.2f\n", checksum_kernel_name(kernel), "sum8", sizes[i],
+					iterations * sizes[i] / sum8_time / 1e9);
+		}
+	}
+
+	// The CRC has a single kernel, check it against the CRC-16/CCITT-FALSE check value.
+	if (checksum_crc16(0xFFFF, (const unsigned char *) "123456789", 9) != 0x29B1) {
+		fprintf(stderr, "The CRC16 kernel fails the check value.\n");
+		error = 1;
+	}
+	else {
+		double start = checksum_bench_get_time();
+
+		for (j = 0; j < CHECKSUM_BENCH_TOTAL_SIZE / 16 / sizes[0]; j++) {
+			sink += checksum_crc16(0xFFFF, buffer, sizes[0]);
+		}
+		printf("%-8s %-8s %10zu %10.2f\n", "table", "crc16", sizes[0],
+				CHECKSUM_BENCH_TOTAL_SIZE / 16 / (checksum_bench_get_time() - start) / 1e9);
+	}
+
+	free(buffer);
+
+	return error;
+}
@@ -0,0 +1,410 @@
+/**
+ * @file	reactor-check.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Gang programming check of the serial reactor transport.
+ *
+ * Attaches simulated devices to pseudo-terminals, each served by a thread of
+ * its own that paces the responses like the real UART and flash would, and
+ * programs and reads back all of them from the main thread through one serial
+ * reactor. The time a single device takes is measured first, so the gain of
+ * driving the devices side by side shows in the output. Input that arrives
+ * while a session sleeps must not keep the reactor busy.
+ *
+ * Build: gcc -I.. -o reactor-check reactor-check.c ../bsl.c ../bsl_core.c ../device.c ../serial.c ../serial_termios2.c
+ *        ../serial_reactor.c ../wire_capture.c ../transport.c ../transport_reactor.c ../bsl_simulator.c
+ *        ../transport_loopback.c ../checksum.c -lm -lpthread
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bsl.h"
+#include "bsl_simulator.h"
+#include "device.h"
+#include "serial_reactor.h"
+#include "transport_reactor.h"
+
+#define REACTOR_CHECK_BOARDS		(4)
+#define REACTOR_CHECK_ADDRESS		(0x8000)
+#define REACTOR_CHECK_SIZE			(2048)
+#define REACTOR_CHECK_IDLE_TIME		(0.2)
+#define REACTOR_CHECK_MAX_CPU_TIME	(0.02)
+
+static const unsigned char reactor_check_unsolicited_data[4] = {0x90, 0xA0, 0x55, 0xAA};
+
+/**
+ * @brief A simulated device on a pseudo-terminal.
+ */
+typedef struct
+{
+	bsl_simulator_t *	simulator_p;	/**< The simulated device.				*/
+	int					master_fd;		/**< Device side of the terminal.		*/
+	int					slave_fd;		/**< Host side of the terminal.			*/
+	pthread_t			thread;			/**< Thread serving the device side.	*/
+	atomic_bool			stop;			/**< Ends the thread.					*/
+	int					index;			/**< Number of the board.				*/
+	transport_t *		transport_p;	/**< Host side transport.				*/
+} reactor_check_board_t;
+
+static void * reactor_check_serve(void * user_data)
+{
+	reactor_check_board_t * board_p = user_data;
+
+	while (!atomic_load(&board_p->stop)) {
+		struct pollfd poll_fd = {board_p->master_fd, POLLIN, 0};
+		unsigned char data[BSL_SIMULATOR_FRAME_SIZE];
+		unsigned char response[2 * BSL_SIMULATOR_FRAME_SIZE];
+		ssize_t size;
+		size_t response_size;
+		double delay;
+		struct timespec delay_struct;
+
+		if (poll(&poll_fd, 1, 100) <= 0) {
+			continue;
+		}
+
+		size = read(board_p->master_fd, data, sizeof(data));
+		if (size <= 0) {
+			continue;
+		}
+
+		response_size = bsl_simulator_receive(board_p->simulator_p, data, size, response, sizeof(response), &delay);
+
+		// Pace the response like the real UART and flash would.
+		delay_struct.tv_sec = (time_t) delay;
+		delay_struct.tv_nsec = (long) ((delay - delay_struct.tv_sec) * 1e9);
+		nanosleep(&delay_struct, NULL);
+
+		if ((response_size > 0) && (write(board_p->master_fd, response, response_size) != (ssize_t) response_size)) {
+			fprintf(stderr, "Board %d could not send the response.\n", board_p->index);
+		}
+	}
+
+	return NULL;
+}
+
+static int reactor_check_open(reactor_check_board_t * board_p, int index)
+{
+	int error = 0;
+	bsl_simulator_settings_t settings;
+	struct termios options;
+
+	memset(board_p, 0, sizeof(*board_p));
+	board_p->index = index;
+	board_p->master_fd = -1;
+	board_p->slave_fd = -1;
+
+	bsl_simulator_get_default_settings(&settings);
+	board_p->simulator_p = bsl_simulator_construct(&settings);
+	if (board_p->simulator_p == NULL) {
+		error = 1;
+	}
+
+	if (!error) {
+		board_p->master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+		if ((board_p->master_fd == -1) || grantpt(board_p->master_fd) || unlockpt(board_p->master_fd)) {
+			fprintf(stderr, "Could not create a pseudo-terminal.\n");
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		board_p->slave_fd = open(ptsname(board_p->master_fd), O_RDWR | O_NOCTTY);
+		if (board_p->slave_fd == -1) {
+			fprintf(stderr, "Could not open %s.\n", ptsname(board_p->master_fd));
+			error = 1;
+		}
+		else {
+			tcgetattr(board_p->slave_fd, &options);
+			cfmakeraw(&options);
+			tcsetattr(board_p->slave_fd, TCSANOW, &options);
+		}
+	}
+
+	if (!error && pthread_create(&board_p->thread, NULL, reactor_check_serve, board_p)) {
+		fprintf(stderr, "Could not start the thread of board %d.\n", index);
+		error = 1;
+	}
+
+	if (error) {
+		if (board_p->slave_fd != -1) {
+			close(board_p->slave_fd);
+		}
+		if (board_p->master_fd != -1) {
+			close(board_p->master_fd);
+		}
+		if (board_p->simulator_p != NULL) {
+			bsl_simulator_destroy(board_p->simulator_p);
+		}
+	}
+
+	return error;
+}
+
+static void reactor_check_close(reactor_check_board_t * board_p)
+{
+	atomic_store(&board_p->stop, true);
+	pthread_join(board_p->thread, NULL);
+
+	close(board_p->slave_fd);
+	close(board_p->master_fd);
+	bsl_simulator_destroy(board_p->simulator_p);
+}
+
+static int reactor_check_session(transport_t * transport_p, void * user_data)
+{
+	int error = 0;
+	reactor_check_board_t * board_p = user_data;
+	bsl_object_t * bsl_object_p;
+	device_object_t * device_object_p = NULL;
+	unsigned char password[32];
+	unsigned char image[REACTOR_CHECK_SIZE];
+	unsigned char read_back[REACTOR_CHECK_SIZE];
+	size_t i;
+
+	bsl_object_p = bsl_construct(transport_p);
+	if (bsl_object_p != NULL) {
+		device_object_p = device_construct(bsl_object_p);
+	}
+
+	if (device_object_p == NULL) {
+		error = 1;
+	}
+	else {
+		// An erased device has all vectors, and thus the password, at 0xFF.
+		memset(password, 0xFF, sizeof(password));
+		error = device_initialize(device_object_p, password);
+	}
+
+	if (!error) {
+		// Every board gets an image of its own.
+		for (i = 0; i < sizeof(image); i++) {
+			image[i] = (unsigned char) (i * 7 + board_p->index);
+		}
+		error = device_write_memory(device_object_p, REACTOR_CHECK_ADDRESS, image, sizeof(image));
+	}
+
+	if (!error) {
+		error = device_read_memory(device_object_p, REACTOR_CHECK_ADDRESS, read_back, sizeof(read_back));
+	}
+	if (!error && (memcmp(image, read_back, sizeof(image)) != 0)) {
+		fprintf(stderr, "Board %d: the flash differs from the image.\n", board_p->index);
+		error = 1;
+	}
+
+	if (device_object_p != NULL) {
+		device_destroy(device_object_p);
+	}
+	if (bsl_object_p != NULL) {
+		bsl_destroy(bsl_object_p);
+	}
+
+	return error;
+}
+
+static int reactor_check_run(reactor_check_board_t * boards, size_t count, double * time_p)
+{
+	int error = 0;
+	serial_reactor_t * reactor_p;
+	struct timespec start;
+	struct timespec end;
+	size_t i;
+
+	reactor_p = serial_reactor_construct();
+	if (reactor_p == NULL) {
+		error = 1;
+	}
+
+	for (i = 0; (i < count) && !error; i++) {
+		boards[i].transport_p = transport_reactor_construct(reactor_p, boards[i].slave_fd);
+		if (boards[i].transport_p == NULL) {
+			error = 1;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	// Every session runs up to its first wait, the reactor takes them from there.
+	for (i = 0; (i < count) && !error; i++) {
+		error = transport_reactor_start(boards[i].transport_p, reactor_check_session, &boards[i]);
+	}
+	if (!error) {
+		error = serial_reactor_run(reactor_p);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	*time_p = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	for (i = 0; (i < count) && !error; i++) {
+		if (transport_reactor_get_result(boards[i].transport_p)) {
+			fprintf(stderr, "Board %d failed.\n", boards[i].index);
+			error = 1;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		if (boards[i].transport_p != NULL) {
+			transport_destroy(boards[i].transport_p);
+			boards[i].transport_p = NULL;
+		}
+	}
+	if (reactor_p != NULL) {
+		serial_reactor_destroy(reactor_p);
+	}
+
+	return error;
+}
+
+static int reactor_check_empty_read(reactor_check_board_t * board_p)
+{
+	int error = 0;
+	serial_reactor_t * reactor_p;
+	char data[1];
+
+	reactor_p = serial_reactor_construct();
+	if (reactor_p == NULL) {
+		error = 1;
+	}
+	else {
+		// An empty read would wait forever, it must be refused.
+		error = serial_reactor_add(reactor_p, board_p->slave_fd, NULL, NULL);
+		if (!error && !serial_reactor_read(reactor_p, board_p->slave_fd, data, 0, 1.0)) {
+			fprintf(stderr, "An empty read was started.\n");
+			error = 1;
+		}
+		serial_reactor_destroy(reactor_p);
+	}
+
+	return error;
+}
+
+static int reactor_check_idle_session(transport_t * transport_p, void * user_data)
+{
+	int error = 0;
+	unsigned char data[sizeof(reactor_check_unsolicited_data)];
+
+	(void) user_data;
+
+	// The data arrives while the session sleeps and is only read afterwards.
+	transport_sleep_until(transport_p, transport_get_time(transport_p) + REACTOR_CHECK_IDLE_TIME);
+	if ((transport_read(transport_p, data, sizeof(data), 0.5) != (int) sizeof(data)) ||
+		(memcmp(data, reactor_check_unsolicited_data, sizeof(data)) != 0))
+	{
+		fprintf(stderr, "The unsolicited data was not read after the sleep.\n");
+		error = 1;
+	}
+
+	return error;
+}
+
+static int reactor_check_unsolicited(reactor_check_board_t * board_p, double * cpu_time_p)
+{
+	int error = 0;
+	serial_reactor_t * reactor_p;
+	transport_t * transport_p = NULL;
+	struct timespec start;
+	struct timespec end;
+
+	reactor_p = serial_reactor_construct();
+	if (reactor_p == NULL) {
+		error = 1;
+	}
+	else {
+		transport_p = transport_reactor_construct(reactor_p, board_p->slave_fd);
+		if (transport_p == NULL) {
+			error = 1;
+		}
+	}
+
+	if (!error && (write(board_p->master_fd, reactor_check_unsolicited_data, sizeof(reactor_check_unsolicited_data))
+			!= (ssize_t) sizeof(reactor_check_unsolicited_data)))
+	{
+		fprintf(stderr, "Could not send the unsolicited data.\n");
+		error = 1;
+	}
+
+	// A reactor that spins on the waiting data burns the whole sleep in CPU time.
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+	if (!error) {
+		error = transport_reactor_start(transport_p, reactor_check_idle_session, NULL);
+	}
+	if (!error) {
+		error = serial_reactor_run(reactor_p);
+	}
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+	*cpu_time_p = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	if (!error && transport_reactor_get_result(transport_p)) {
+		error = 1;
+	}
+	if (!error && (*cpu_time_p > REACTOR_CHECK_MAX_CPU_TIME)) {
+		fprintf(stderr, "The reactor used %.3f s of CPU time during a %.3f s sleep.\n", *cpu_time_p, REACTOR_CHECK_IDLE_TIME);
+		error = 1;
+	}
+
+	if (transport_p != NULL) {
+		transport_destroy(transport_p);
+	}
+	if (reactor_p != NULL) {
+		serial_reactor_destroy(reactor_p);
+	}
+
+	return error;
+}
+
+int main(int argc, char *argv[])
+{
+	int error = 0;
+	reactor_check_board_t boards[REACTOR_CHECK_BOARDS];
+	size_t opened = 0;
+	double single_time = 0;
+	double gang_time = 0;
+	double cpu_time = 0;
+	int result;
+
+	(void) argc;
+	(void) argv;
+
+	while ((opened < REACTOR_CHECK_BOARDS) && !error) {
+		error = reactor_check_open(&boards[opened], (int) opened);
+		if (!error) {
+			opened++;
+		}
+	}
+
+	if (!error) {
+		result = reactor_check_empty_read(&boards[0]);
+		printf("%-32s %s\n", "empty read", result ? "failed" : "passed");
+		error |= result;
+
+		result = reactor_check_unsolicited(&boards[0], &cpu_time);
+		printf("%-32s %s, %.3f s of CPU time\n", "unsolicited input", result ? "failed" : "passed", cpu_time);
+		error |= result;
+
+		result = reactor_check_run(boards, 1, &single_time);
+		printf("%-32s %s, %.3f s\n", "single board", result ? "failed" : "passed", single_time);
+		error |= result;
+
+		result = reactor_check_run(boards, REACTOR_CHECK_BOARDS, &gang_time);
+		printf("%-32s %s, %.3f s\n", "gang of boards", result ? "failed" : "passed", gang_time);
+		error |= result;
+	}
+
+	while (opened > 0) {
+		reactor_check_close(&boards[--opened]);
+	}
+
+	return error;
+}
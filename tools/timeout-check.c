@@ -0,0 +1,186 @@
+/**
+ * @file	timeout-check.c
+ *
+ * @date	18 oct. 2026
+ * @author	enjschreuder
+ * @brief	Timeout and retry check against the BSL simulator in virtual time.
+ *
+ * Delays the responses of the loopback transport past the read timeouts and
+ * checks that the reads time out, that the late data stays queued, and that
+ * the device layer retries and finally fails the blocks that never arrive in
+ * time, all without waiting for a real clock.
+ *
+ * Build: gcc -I.. -o timeout-check timeout-check.c ../bsl.c ../bsl_core.c ../device.c ../serial.c ../serial_termios2.c
+ *        ../wire_capture.c ../transport.c ../transport_loopback.c ../bsl_simulator.c ../checksum.c -lm
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bsl.h"
+#include "bsl_simulator.h"
+#include "device.h"
+#include "transport_loopback.h"
+
+#define TIMEOUT_CHECK_ADDRESS	(0x8000)
+#define TIMEOUT_CHECK_SIZE		(256)
+
+/**
+ * @brief Objects of one simulated session.
+ */
+typedef struct
+{
+	bsl_simulator_t *	simulator_p;	/**< The simulated device.		*/
+	transport_t *		transport_p;	/**< Loopback to the simulator.	*/
+	bsl_object_t *		bsl_object_p;	/**< BSL protocol.				*/
+	device_object_t *	device_object_p;	/**< Device layer.			*/
+} timeout_check_session_t;
+
+static int timeout_check_open(timeout_check_session_t * session_p)
+{
+	int error = 0;
+	bsl_simulator_settings_t settings;
+	unsigned char password[32];
+
+	memset(session_p, 0, sizeof(*session_p));
+
+	bsl_simulator_get_default_settings(&settings);
+	session_p->simulator_p = bsl_simulator_construct(&settings);
+
+	if (session_p->simulator_p != NULL) {
+		session_p->transport_p = transport_loopback_construct(&bsl_simulator_peer, session_p->simulator_p);
+	}
+	if (session_p->transport_p != NULL) {
+		session_p->bsl_object_p = bsl_construct(session_p->transport_p);
+	}
+	if (session_p->bsl_object_p != NULL) {
+		session_p->device_object_p = device_construct(session_p->bsl_object_p);
+	}
+
+	if (session_p->device_object_p == NULL) {
+		error = 1;
+	}
+	else {
+		// An erased device has all vectors, and thus the password, at 0xFF.
+		memset(password, 0xFF, sizeof(password));
+		error = device_initialize(session_p->device_object_p, password);
+	}
+
+	return error;
+}
+
+static void timeout_check_close(timeout_check_session_t * session_p)
+{
+	if (session_p->device_object_p != NULL) {
+		device_destroy(session_p->device_object_p);
+	}
+	if (session_p->bsl_object_p != NULL) {
+		bsl_destroy(session_p->bsl_object_p);
+	}
+	if (session_p->transport_p != NULL) {
+		transport_destroy(session_p->transport_p);
+	}
+	if (session_p->simulator_p != NULL) {
+		bsl_simulator_destroy(session_p->simulator_p);
+	}
+}
+
+static int timeout_check_late_data(void)
+{
+	int error = 0;
+	transport_t * transport_p;
+	const unsigned char data[4] = {0x80, 0x90, 0xA0, 0x00};
+	unsigned char read_back[4];
+	int first_size = 0;
+	int second_size = 0;
+
+	// Without a peer the written data is looped back, here two seconds late.
+	transport_p = transport_loopback_construct(NULL, NULL);
+	if (transport_p == NULL) {
+		error = 1;
+	}
+	else {
+		transport_loopback_set_latency(transport_p, 2.0);
+		transport_write(transport_p, data, sizeof(data));
+		first_size = transport_read(transport_p, read_back, sizeof(read_back), 1.0);
+		if ((first_size != 0) || (fabs(transport_get_time(transport_p) - 1.0) > 1e-9)) {
+			fprintf(stderr, "late data: a read within 1 s returned %d bytes at %.3f s.\n", first_size,
+					transport_get_time(transport_p));
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		// The data stayed queued and arrives during the next read.
+		second_size = transport_read(transport_p, read_back, sizeof(read_back), 2.0);
+		if ((second_size != (int) sizeof(data)) || (memcmp(data, read_back, sizeof(data)) != 0) ||
+			(fabs(transport_get_time(transport_p) - 2.0) > 1e-9))
+		{
+			fprintf(stderr, "late data: the next read returned %d bytes at %.3f s.\n", second_size,
+					transport_get_time(transport_p));
+			error = 1;
+		}
+	}
+
+	printf("%-32s %s\n", "late data", error ? "failed" : "passed");
+
+	if (transport_p != NULL) {
+		transport_destroy(transport_p);
+	}
+
+	return error;
+}
+
+static int timeout_check_run(const char * name, double latency, bool fail)
+{
+	int error = 0;
+	int result = 0;
+	timeout_check_session_t session;
+	unsigned char read_back[TIMEOUT_CHECK_SIZE];
+	device_statistics_t statistics;
+
+	error = timeout_check_open(&session);
+
+	if (!error) {
+		// The link slows down once the session is up.
+		transport_loopback_set_latency(session.transport_p, latency);
+		device_clear_statistics(session.device_object_p);
+		result = device_read_memory(session.device_object_p, TIMEOUT_CHECK_ADDRESS, read_back, sizeof(read_back));
+		device_get_statistics(session.device_object_p, &statistics);
+
+		if (fail && !result) {
+			fprintf(stderr, "%s: responses %.3f s late were accepted.\n", name, latency);
+			error = 1;
+		}
+		else if (!fail && result) {
+			fprintf(stderr, "%s: responses %.3f s late were rejected.\n", name, latency);
+			error = 1;
+		}
+		else if (fail && ((statistics.retries == 0) || (statistics.failures == 0))) {
+			fprintf(stderr, "%s: %lu retries and %lu failed blocks.\n", name, statistics.retries, statistics.failures);
+			error = 1;
+		}
+	}
+
+	printf("%-32s %s\n", name, error ? "failed" : "passed");
+
+	timeout_check_close(&session);
+
+	return error;
+}
+
+int main(int argc, char *argv[])
+{
+	int error = 0;
+
+	(void) argc;
+	(void) argv;
+
+	error |= timeout_check_late_data();
+	error |= timeout_check_run("latency within the margin", 0.005, false);
+	error |= timeout_check_run("latency past the timeout", 3.0, true);
+
+	return error;
+}
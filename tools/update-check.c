@@ -0,0 +1,176 @@
+/**
+ * @file	update-check.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Differential programming check against the BSL simulator.
+ *
+ * Programs images with device_write_memory(), changes them, programs the
+ * changes with device_update_memory() and reads the flash back. The device
+ * has its main memory start at 0x1100, within a segment, as the 60 KB ROM BSL
+ * devices do, so the partial first segment and the information memory below
+ * it are covered too.
+ *
+ * Build: gcc -I.. -o update-check update-check.c ../bsl.c ../bsl_core.c ../device.c ../serial.c ../serial_termios2.c
+ *        ../wire_capture.c ../transport.c ../transport_loopback.c ../bsl_simulator.c ../checksum.c -lm
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bsl.h"
+#include "bsl_simulator.h"
+#include "device.h"
+#include "transport_loopback.h"
+
+#define UPDATE_CHECK_MAX_SIZE	(1026)
+
+/**
+ * @brief Objects of one simulated session.
+ */
+typedef struct
+{
+	bsl_simulator_t *	simulator_p;	/**< The simulated device.		*/
+	transport_t *		transport_p;	/**< Loopback to the simulator.	*/
+	bsl_object_t *		bsl_object_p;	/**< BSL protocol.				*/
+	device_object_t *	device_object_p;	/**< Device layer.			*/
+} update_check_session_t;
+
+static int update_check_open(update_check_session_t * session_p)
+{
+	int error = 0;
+	bsl_simulator_settings_t settings;
+	unsigned char password[32];
+
+	memset(session_p, 0, sizeof(*session_p));
+
+	bsl_simulator_get_default_settings(&settings);
+	settings.main_start = 0x1100;
+	session_p->simulator_p = bsl_simulator_construct(&settings);
+
+	if (session_p->simulator_p != NULL) {
+		session_p->transport_p = transport_loopback_construct(&bsl_simulator_peer, session_p->simulator_p);
+	}
+	if (session_p->transport_p != NULL) {
+		session_p->bsl_object_p = bsl_construct(session_p->transport_p);
+	}
+	if (session_p->bsl_object_p != NULL) {
+		session_p->device_object_p = device_construct(session_p->bsl_object_p);
+	}
+
+	if (session_p->device_object_p == NULL) {
+		error = 1;
+	}
+	else {
+		// An erased device has all vectors, and thus the password, at 0xFF.
+		memset(password, 0xFF, sizeof(password));
+		error = device_initialize(session_p->device_object_p, password);
+	}
+
+	return error;
+}
+
+static void update_check_close(update_check_session_t * session_p)
+{
+	if (session_p->device_object_p != NULL) {
+		device_destroy(session_p->device_object_p);
+	}
+	if (session_p->bsl_object_p != NULL) {
+		bsl_destroy(session_p->bsl_object_p);
+	}
+	if (session_p->transport_p != NULL) {
+		transport_destroy(session_p->transport_p);
+	}
+	if (session_p->simulator_p != NULL) {
+		bsl_simulator_destroy(session_p->simulator_p);
+	}
+}
+
+static int update_check_run(const char * name, unsigned long address, size_t size, unsigned char old_fill,
+		unsigned char new_fill, size_t changes)
+{
+	int error = 0;
+	update_check_session_t session;
+	unsigned char image[UPDATE_CHECK_MAX_SIZE];
+	unsigned char read_back[UPDATE_CHECK_MAX_SIZE];
+	unsigned char info[256];
+	device_statistics_t statistics;
+	// The ROM BSL reads and programs whole words, an image may still start or end within one.
+	unsigned long start = address & ~1UL;
+	unsigned long end = (address + size + 1) & ~1UL;
+	size_t i;
+
+	error = update_check_open(&session);
+
+	if (!error) {
+		// Something in the information memory that no update of the main memory may touch.
+		for (i = 0; i < sizeof(info); i++) {
+			info[i] = (unsigned char) (i * 3);
+		}
+		error = device_write_memory(session.device_object_p, 0x1000, info, sizeof(info));
+	}
+
+	if (!error) {
+		memset(image, old_fill, end - start);
+		error = device_write_memory(session.device_object_p, start, image, end - start);
+	}
+
+	if (!error) {
+		// Change a spread of bytes, or all of them.
+		if (changes == 0) {
+			memset(image, new_fill, size);
+		}
+		for (i = 0; i < changes; i++) {
+			image[i * size / changes] = new_fill;
+		}
+
+		device_clear_statistics(session.device_object_p);
+		error = device_update_memory(session.device_object_p, address, image, size);
+		device_get_statistics(session.device_object_p, &statistics);
+	}
+
+	if (!error) {
+		error = device_read_memory(session.device_object_p, start, read_back, end - start);
+	}
+	if (!error && (memcmp(image, &(read_back[address - start]), size) != 0)) {
+		fprintf(stderr, "%s: the flash differs from the image after the update.\n", name);
+		error = 1;
+	}
+
+	if (!error) {
+		error = device_read_memory(session.device_object_p, 0x1000, read_back, sizeof(info));
+	}
+	if (!error && (memcmp(info, read_back, sizeof(info)) != 0)) {
+		fprintf(stderr, "%s: the update changed the information memory.\n", name);
+		error = 1;
+	}
+
+	if (!error && (statistics.bytes_skipped > size)) {
+		fprintf(stderr, "%s: %lu bytes skipped of a %zu byte image.\n", name, statistics.bytes_skipped, size);
+		error = 1;
+	}
+
+	printf("%-32s %s\n", name, error ? "failed" : "passed");
+
+	update_check_close(&session);
+
+	return error;
+}
+
+int main(int argc, char *argv[])
+{
+	int error = 0;
+
+	(void) argc;
+	(void) argv;
+
+	error |= update_check_run("first main segment, erased", 0x1100, 256, 0x00, 0x55, 0);
+	error |= update_check_run("first main segment, programmed", 0x1100, 256, 0xFF, 0x55, 0);
+	error |= update_check_run("first two main segments", 0x1100, 768, 0x00, 0xA5, 7);
+	error |= update_check_run("single odd byte", 0x8001, 1, 0xFF, 0x55, 0);
+	error |= update_check_run("single odd byte, erased", 0x8001, 1, 0x00, 0x55, 0);
+	error |= update_check_run("unaligned range", 0x81F3, 300, 0x12, 0x34, 5);
+
+	return error;
+}
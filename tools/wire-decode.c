@@ -0,0 +1,27 @@
+/**
+ * @file	wire-decode.c
+ *
+ * @date	18 oct. 2026
+ * @author	enjschreuder
+ * @brief	Renders a wire capture file as annotated BSL frames.
+ *
+ * Reads a capture written by wire_capture_dump(), for example with the -w
+ * option of bsl-bench, and prints every request and response with its time,
+ * port, command name and checksum state.
+ *
+ * Build: gcc -I.. -o wire-decode wire-decode.c ../wire_capture.c ../checksum.c
+ */
+
+#include <stdio.h>
+
+#include "wire_capture.h"
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s capture-file\n", argv[0]);
+		return 1;
+	}
+
+	return wire_capture_decode(argv[1], stdout);
+}
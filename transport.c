@@ -0,0 +1,240 @@
+/**
+ * @file	transport.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the BSL transport interface.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "transport.h"
+
+/**
+ * @defgroup transport Transport
+ * @brief Byte transports the BSL protocol runs over.
+ * @{
+ */
+
+/**
+ * @brief	Construct a transport.
+ * @param	operations		Backend operations.
+ * @param	context_p		Backend state, released through the destroy operation.
+ * @return	The transport object, or NULL on error.
+ */
+transport_t * transport_construct(const transport_operations_t * operations, void * context_p)
+{
+	transport_t * transport_p;
+
+	// Allocate memory for the transport object.
+	transport_p = malloc(sizeof(transport_t));
+
+	if (transport_p == NULL) {
+		// Could not allocate memory.
+		fprintf(stderr, "Failed to allocate memory for the transport object.\n");
+	}
+	else {
+		transport_p->operations = operations;
+		transport_p->context_p = context_p;
+	}
+
+	return transport_p;
+}
+
+/**
+ * @brief	Destroy a transport and its backend state.
+ * @param	transport_p		The transport object.
+ * @return	None.
+ */
+void transport_destroy(transport_t * transport_p)
+{
+	if (transport_p->operations->destroy != NULL) {
+		transport_p->operations->destroy(transport_p->context_p);
+	}
+
+	free(transport_p);
+}
+
+/**
+ * @brief	Write to the transport.
+ * @param	transport_p		The transport object.
+ * @param	data			Data to write.
+ * @param	size			Amount of data to write.
+ * @return	Amount of data written.
+ */
+int transport_write(transport_t * transport_p, const unsigned char * data, size_t size)
+{
+	return transport_p->operations->write(transport_p->context_p, data, size);
+}
+
+/**
+ * @brief	Write scattered data to the transport as one write.
+ *
+ * Transports without a writev operation get the parts gathered in a buffer on
+ * the stack, or written one by one if they do not fit.
+ *
+ * @param	transport_p		The transport object.
+ * @param	vectors			Parts of the data, in order.
+ * @param	count			Number of parts.
+ * @return	Amount of data written.
+ */
+int transport_writev(transport_t * transport_p, const struct iovec * vectors, int count)
+{
+	int written_size = 0;
+	size_t size = 0;
+	int i;
+
+	if (transport_p->operations->writev != NULL) {
+		written_size = transport_p->operations->writev(transport_p->context_p, vectors, count);
+	}
+	else {
+		for (i = 0; i < count; i++) {
+			size += vectors[i].iov_len;
+		}
+
+		if (size <= TRANSPORT_GATHER_SIZE) {
+			unsigned char buffer[TRANSPORT_GATHER_SIZE];
+
+			size = 0;
+			for (i = 0; i < count; i++) {
+				memcpy(&buffer[size], vectors[i].iov_base, vectors[i].iov_len);
+				size += vectors[i].iov_len;
+			}
+			written_size = transport_write(transport_p, buffer, size);
+		}
+		else {
+			for (i = 0; i < count; i++) {
+				written_size += transport_write(transport_p, vectors[i].iov_base, vectors[i].iov_len);
+			}
+		}
+	}
+
+	return written_size;
+}
+
+/**
+ * @brief	Read from the transport.
+ * @param	transport_p		The transport object.
+ * @param	data			Buffer to read data into.
+ * @param	size			Amount of data to read.
+ * @param	timeout			Timeout after which to return.
+ * @return	Amount of data read.
+ */
+int transport_read(transport_t * transport_p, unsigned char * data, size_t size, double timeout)
+{
+	return transport_p->operations->read(transport_p->context_p, data, size, timeout);
+}
+
+/**
+ * @brief	Assert and deassert modem control lines.
+ * @param	transport_p		The transport object.
+ * @param	set_lines		SERIAL_LINE_* lines to assert.
+ * @param	clear_lines		SERIAL_LINE_* lines to deassert.
+ * @return	0 on success, 1 on error.
+ */
+int transport_set_lines(transport_t * transport_p, unsigned int set_lines, unsigned int clear_lines)
+{
+	return transport_p->operations->set_lines(transport_p->context_p, set_lines, clear_lines);
+}
+
+/**
+ * @brief	Change the line rate.
+ * @param	transport_p		The transport object.
+ * @param	baudrate		The desired rate in baud.
+ * @return	0 on success, 1 on error.
+ */
+int transport_set_baudrate(transport_t * transport_p, unsigned int baudrate)
+{
+	return transport_p->operations->set_baudrate(transport_p->context_p, baudrate);
+}
+
+/**
+ * @brief	Tune the transport for short round trips, if it supports it.
+ * @param	transport_p		The transport object.
+ * @param	enabled			TRUE = enabled, FALSE = disabled.
+ * @return	0 on success, 1 on error.
+ */
+int transport_set_low_latency(transport_t * transport_p, bool enabled)
+{
+	int error = 0;
+
+	if (transport_p->operations->set_low_latency != NULL) {
+		error = transport_p->operations->set_low_latency(transport_p->context_p, enabled);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Get the time of the clock the transport runs on.
+ * @param	transport_p		The transport object.
+ * @return	The time in seconds, only differences are meaningful.
+ */
+double transport_get_time(transport_t * transport_p)
+{
+	double time;
+
+	if (transport_p->operations->get_time != NULL) {
+		time = transport_p->operations->get_time(transport_p->context_p);
+	}
+	else {
+		struct timespec now;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		time = now.tv_sec + now.tv_nsec / 1e9;
+	}
+
+	return time;
+}
+
+/**
+ * @brief	Wait until the clock the transport runs on reaches a deadline.
+ * @param	transport_p		The transport object.
+ * @param	deadline		Absolute time in seconds, as returned by transport_get_time().
+ * @return	None.
+ */
+void transport_sleep_until(transport_t * transport_p, double deadline)
+{
+	if (transport_p->operations->sleep_until != NULL) {
+		transport_p->operations->sleep_until(transport_p->context_p, deadline);
+	}
+	else {
+		struct timespec time;
+
+		time.tv_sec = (time_t) deadline;
+		time.tv_nsec = (long) ((deadline - time.tv_sec) * 1e9);
+		if (time.tv_nsec >= 1000000000) {
+			time.tv_sec++;
+			time.tv_nsec -= 1000000000;
+		}
+
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL) == EINTR);
+	}
+}
+
+/**
+ * @brief	Get the time to allow for the network on top of the line times.
+ *
+ * Meant to be added once to the deadline of a command, not to every read.
+ *
+ * @param	transport_p		The transport object.
+ * @return	The margin in seconds, 0 for a local link.
+ */
+double transport_get_latency_margin(transport_t * transport_p)
+{
+	double margin = 0;
+
+	if (transport_p->operations->get_latency_margin != NULL) {
+		margin = transport_p->operations->get_latency_margin(transport_p->context_p);
+	}
+
+	return margin;
+}
+
+/**
+ * @}
+ */
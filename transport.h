@@ -0,0 +1,73 @@
+/**
+ * @file	transport.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the BSL transport interface.
+ */
+
+#ifndef TRANSPORT_H_
+#define TRANSPORT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+/**
+ * @addtogroup transport
+ * @{
+ */
+
+/**
+ * @brief Operations implemented by a transport backend.
+ *
+ * The context pointer of the transport is passed to every operation.
+ * Operations marked optional may be NULL. Without a clock of its own, a
+ * transport runs on the monotonic system clock.
+ */
+typedef struct
+{
+	int		(*write)(void * context_p, const unsigned char * data, size_t size);					/**< Write data, returns the amount written.				*/
+	int		(*writev)(void * context_p, const struct iovec * vectors, int count);				/**< Optional, write scattered data at once.				*/
+	int		(*read)(void * context_p, unsigned char * data, size_t size, double timeout);		/**< Read data within the timeout, returns the amount read.	*/
+	int		(*set_lines)(void * context_p, unsigned int set_lines, unsigned int clear_lines);	/**< Assert and deassert SERIAL_LINE_* lines.				*/
+	int		(*set_baudrate)(void * context_p, unsigned int baudrate);							/**< Change the line rate in baud.							*/
+	int		(*set_low_latency)(void * context_p, bool enabled);									/**< Optional, tune the link for short round trips.			*/
+	double	(*get_time)(void * context_p);														/**< Optional, current time of the link clock in seconds.	*/
+	void	(*sleep_until)(void * context_p, double deadline);									/**< Optional, wait until the link clock reaches deadline.	*/
+	void	(*destroy)(void * context_p);														/**< Optional, release the context.							*/
+	double	(*get_latency_margin)(void * context_p);											/**< Optional, extra wait for the network, in seconds.		*/
+} transport_operations_t;
+
+/**
+ * @brief Largest scattered write that is gathered for a transport without writev.
+ */
+#define TRANSPORT_GATHER_SIZE	(512)
+
+/**
+ * @brief Transport object.
+ */
+typedef struct
+{
+	const transport_operations_t *	operations;	/**< Backend operations.	*/
+	void *							context_p;	/**< Backend state.			*/
+} transport_t;
+
+transport_t * transport_construct(const transport_operations_t * operations, void * context_p);
+void transport_destroy(transport_t * transport_p);
+
+int transport_write(transport_t * transport_p, const unsigned char * data, size_t size);
+int transport_writev(transport_t * transport_p, const struct iovec * vectors, int count);
+int transport_read(transport_t * transport_p, unsigned char * data, size_t size, double timeout);
+int transport_set_lines(transport_t * transport_p, unsigned int set_lines, unsigned int clear_lines);
+int transport_set_baudrate(transport_t * transport_p, unsigned int baudrate);
+int transport_set_low_latency(transport_t * transport_p, bool enabled);
+double transport_get_time(transport_t * transport_p);
+void transport_sleep_until(transport_t * transport_p, double deadline);
+double transport_get_latency_margin(transport_t * transport_p);
+
+/**
+ * @}
+ */
+
+#endif /* TRANSPORT_H_ */
@@ -0,0 +1,262 @@
+/**
+ * @file	transport_loopback.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the in-memory loopback transport.
+ *
+ * Runs the BSL protocol in-process without system calls or hardware. Data
+ * written by the host is handed to the peer by reference, without copying.
+ * Responses of the peer are queued in a ring buffer and copied once into the
+ * buffer of the reading host.
+ *
+ * The transport runs on a virtual clock. The peer states how long after the
+ * write each response arrives, a read advances the clock to the arrival of
+ * the data or by its full timeout, and sleeps advance it to their deadline.
+ * Nothing is ever waited for, so a session takes microseconds of CPU time
+ * while transport_get_time() gives its exact duration on a real link.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "transport_loopback.h"
+
+/**
+ * @addtogroup transport
+ * @{
+ */
+
+/**
+ * @brief Loopback transport state.
+ */
+typedef struct
+{
+	const transport_loopback_peer_t *	peer;									/**< Peer callbacks, may be NULL.	*/
+	void *								peer_p;									/**< Peer state.					*/
+	transport_t *						transport_p;							/**< The owning transport.			*/
+	unsigned int						lines;									/**< Asserted SERIAL_LINE_* lines.	*/
+	unsigned char						buffer[TRANSPORT_LOOPBACK_BUFFER_SIZE];	/**< Queued responses.				*/
+	size_t								head;									/**< Oldest queued byte.			*/
+	size_t								count;									/**< Number of queued bytes.		*/
+	double								time;									/**< Virtual clock in seconds.		*/
+	double								ready_time;								/**< Arrival of the queued bytes.	*/
+	double								latency;								/**< Added to every response.		*/
+} transport_loopback_t;
+
+static int transport_loopback_write(void * context_p, const unsigned char * data, size_t size);
+static int transport_loopback_read(void * context_p, unsigned char * data, size_t size, double timeout);
+static int transport_loopback_set_lines(void * context_p, unsigned int set_lines, unsigned int clear_lines);
+static int transport_loopback_set_baudrate(void * context_p, unsigned int baudrate);
+static double transport_loopback_get_time(void * context_p);
+static void transport_loopback_sleep_until(void * context_p, double deadline);
+static void transport_loopback_destroy(void * context_p);
+
+static const transport_operations_t transport_loopback_operations =
+{
+	transport_loopback_write,
+	NULL,
+	transport_loopback_read,
+	transport_loopback_set_lines,
+	transport_loopback_set_baudrate,
+	NULL,
+	transport_loopback_get_time,
+	transport_loopback_sleep_until,
+	transport_loopback_destroy,
+	NULL
+};
+
+/**
+ * @brief	Construct a loopback transport.
+ * @param	peer			Peer callbacks, NULL to echo all written data.
+ * @param	peer_p			Peer state passed to the callbacks.
+ * @return	The transport object, or NULL on error.
+ */
+transport_t * transport_loopback_construct(const transport_loopback_peer_t * peer, void * peer_p)
+{
+	transport_loopback_t * loopback_p;
+	transport_t * transport_p = NULL;
+
+	// Allocate memory for the loopback state.
+	loopback_p = malloc(sizeof(transport_loopback_t));
+
+	if (loopback_p == NULL) {
+		// Could not allocate memory.
+		fprintf(stderr, "Failed to allocate memory for the loopback transport.\n");
+	}
+	else {
+		loopback_p->peer = peer;
+		loopback_p->peer_p = peer_p;
+		loopback_p->lines = 0;
+		loopback_p->head = 0;
+		loopback_p->count = 0;
+		loopback_p->time = 0;
+		loopback_p->ready_time = 0;
+		loopback_p->latency = 0;
+
+		transport_p = transport_construct(&transport_loopback_operations, loopback_p);
+		if (transport_p == NULL) {
+			free(loopback_p);
+		}
+		else {
+			loopback_p->transport_p = transport_p;
+		}
+	}
+
+	return transport_p;
+}
+
+/**
+ * @brief	Queue data from the peer for the host to read.
+ * @param	transport_p		The loopback transport.
+ * @param	data			Data to queue.
+ * @param	size			Amount of data.
+ * @param	delay			Time from the current write until the data has arrived, in seconds.
+ * @return	0 on success, 1 if the receive buffer overflowed.
+ */
+int transport_loopback_respond(transport_t * transport_p, const unsigned char * data, size_t size, double delay)
+{
+	int error = 0;
+	transport_loopback_t * loopback_p = transport_p->context_p;
+	size_t i;
+
+	if (size > TRANSPORT_LOOPBACK_BUFFER_SIZE - loopback_p->count) {
+		fprintf(stderr, "Loopback receive buffer overflow.\n");
+		size = TRANSPORT_LOOPBACK_BUFFER_SIZE - loopback_p->count;
+		error = 1;
+	}
+
+	for (i = 0; i < size; i++) {
+		loopback_p->buffer[(loopback_p->head + loopback_p->count + i) % TRANSPORT_LOOPBACK_BUFFER_SIZE] = data[i];
+	}
+	loopback_p->count += size;
+
+	// Queued data is available as a whole once the last part has arrived.
+	if (loopback_p->time + delay + loopback_p->latency > loopback_p->ready_time) {
+		loopback_p->ready_time = loopback_p->time + delay + loopback_p->latency;
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Model the latency of a real adapter, such as the USB polling and latency timer.
+ * @param	transport_p		The loopback transport.
+ * @param	latency			Time added to the arrival of every response, in seconds.
+ * @return	None.
+ */
+void transport_loopback_set_latency(transport_t * transport_p, double latency)
+{
+	transport_loopback_t * loopback_p = transport_p->context_p;
+
+	loopback_p->latency = latency;
+}
+
+static int transport_loopback_write(void * context_p, const unsigned char * data, size_t size)
+{
+	transport_loopback_t * loopback_p = context_p;
+
+	if ((loopback_p->peer == NULL) || (loopback_p->peer->receive == NULL)) {
+		// Without a peer, the data is simply looped back.
+		transport_loopback_respond(loopback_p->transport_p, data, size, 0);
+	}
+	else {
+		loopback_p->peer->receive(loopback_p->peer_p, loopback_p->transport_p, data, size);
+	}
+
+	return (int) size;
+}
+
+static int transport_loopback_read(void * context_p, unsigned char * data, size_t size, double timeout)
+{
+	transport_loopback_t * loopback_p = context_p;
+	size_t read_size = 0;
+	bool arrived = (loopback_p->ready_time <= loopback_p->time + timeout);
+
+	if (arrived && (loopback_p->count >= size)) {
+		// Wait for the data to arrive.
+		if (loopback_p->ready_time > loopback_p->time) {
+			loopback_p->time = loopback_p->ready_time;
+		}
+	}
+	else {
+		// The data does not arrive in full within the timeout, so the whole timeout passes.
+		loopback_p->time += timeout;
+	}
+
+	// Data that arrives after the timeout stays queued, as on a real port.
+	// Copy at most two contiguous parts because of the wrap around.
+	while (arrived && (read_size < size) && (loopback_p->count > 0)) {
+		size_t copy_size = size - read_size;
+		size_t contiguous_size = TRANSPORT_LOOPBACK_BUFFER_SIZE - loopback_p->head;
+
+		if (copy_size > loopback_p->count) {
+			copy_size = loopback_p->count;
+		}
+		if (copy_size > contiguous_size) {
+			copy_size = contiguous_size;
+		}
+
+		memcpy(&(data[read_size]), &(loopback_p->buffer[loopback_p->head]), copy_size);
+		loopback_p->head = (loopback_p->head + copy_size) % TRANSPORT_LOOPBACK_BUFFER_SIZE;
+		loopback_p->count -= copy_size;
+		read_size += copy_size;
+	}
+
+	if (read_size < size) {
+		fprintf(stderr, "A timeout occurred.\n");
+	}
+
+	return (int) read_size;
+}
+
+static int transport_loopback_set_lines(void * context_p, unsigned int set_lines, unsigned int clear_lines)
+{
+	transport_loopback_t * loopback_p = context_p;
+
+	loopback_p->lines |= set_lines;
+	loopback_p->lines &= ~clear_lines;
+
+	if ((loopback_p->peer != NULL) && (loopback_p->peer->set_lines != NULL)) {
+		loopback_p->peer->set_lines(loopback_p->peer_p, loopback_p->transport_p, loopback_p->lines);
+	}
+
+	return 0;
+}
+
+static int transport_loopback_set_baudrate(void * context_p, unsigned int baudrate)
+{
+	transport_loopback_t * loopback_p = context_p;
+
+	if ((loopback_p->peer != NULL) && (loopback_p->peer->set_baudrate != NULL)) {
+		loopback_p->peer->set_baudrate(loopback_p->peer_p, loopback_p->transport_p, baudrate);
+	}
+
+	return 0;
+}
+
+static double transport_loopback_get_time(void * context_p)
+{
+	transport_loopback_t * loopback_p = context_p;
+
+	return loopback_p->time;
+}
+
+static void transport_loopback_sleep_until(void * context_p, double deadline)
+{
+	transport_loopback_t * loopback_p = context_p;
+
+	if (deadline > loopback_p->time) {
+		loopback_p->time = deadline;
+	}
+}
+
+static void transport_loopback_destroy(void * context_p)
+{
+	free(context_p);
+}
+
+/**
+ * @}
+ */
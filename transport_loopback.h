@@ -0,0 +1,46 @@
+/**
+ * @file	transport_loopback.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the in-memory loopback transport.
+ */
+
+#ifndef TRANSPORT_LOOPBACK_H_
+#define TRANSPORT_LOOPBACK_H_
+
+#include "transport.h"
+
+/**
+ * @addtogroup transport
+ * @{
+ */
+
+/**
+ * @brief Size of the receive buffer of a loopback transport.
+ */
+#define TRANSPORT_LOOPBACK_BUFFER_SIZE	(4096)
+
+/**
+ * @brief In-process peer at the far end of a loopback transport.
+ *
+ * The peer answers through transport_loopback_respond(), stating when each
+ * response arrives on the virtual clock. All callbacks are optional; without
+ * a receive callback written data is echoed back instantly.
+ */
+typedef struct
+{
+	void	(*receive)(void * peer_p, transport_t * transport_p, const unsigned char * data, size_t size);	/**< Data written by the host.	*/
+	void	(*set_lines)(void * peer_p, transport_t * transport_p, unsigned int lines);						/**< New SERIAL_LINE_* state.	*/
+	void	(*set_baudrate)(void * peer_p, transport_t * transport_p, unsigned int baudrate);				/**< New line rate.				*/
+} transport_loopback_peer_t;
+
+transport_t * transport_loopback_construct(const transport_loopback_peer_t * peer, void * peer_p);
+int transport_loopback_respond(transport_t * transport_p, const unsigned char * data, size_t size, double delay);
+void transport_loopback_set_latency(transport_t * transport_p, double latency);
+
+/**
+ * @}
+ */
+
+#endif /* TRANSPORT_LOOPBACK_H_ */
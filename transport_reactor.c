@@ -0,0 +1,395 @@
+/**
+ * @file	transport_reactor.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the serial reactor transport.
+ *
+ * Runs the blocking BSL protocol on a port of a serial reactor, so a single
+ * thread can program a whole rack of targets. Every port runs its session on
+ * a stack of its own. A read, write or sleep of the session starts the
+ * operation on the reactor and switches back to the thread, and the reactor
+ * callback of the port switches to the session again when the operation
+ * completes. serial_reactor_run() thus drives all started sessions and
+ * returns once the last one has ended.
+ *
+ * Outside of a session the operations run the reactor themselves until they
+ * complete, which dispatches the events of all other ports as well.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "serial.h"
+#include "transport_reactor.h"
+
+/**
+ * @addtogroup transport
+ * @{
+ */
+
+/**
+ * @brief Reactor transport state.
+ */
+typedef struct
+{
+	serial_reactor_t *			reactor_p;			/**< The reactor the port is part of.		*/
+	int							fd;					/**< File descriptor for the serial port.	*/
+	transport_t *				transport_p;		/**< The owning transport.					*/
+	transport_reactor_session	session;			/**< Session function, NULL if none ran.	*/
+	void *						user_data;			/**< User data for the session.				*/
+	bool						running;			/**< TRUE while the session has not ended.	*/
+	int							result;				/**< Result of the ended session.			*/
+	bool						waiting;			/**< TRUE while an operation is pending.	*/
+	serial_reactor_event		event;				/**< Event that ended the operation.		*/
+	size_t						size;				/**< Data transferred by the operation.		*/
+	void *						stack;				/**< Stack of the session.					*/
+	ucontext_t					session_context;	/**< Suspended session.						*/
+	ucontext_t					thread_context;		/**< Suspended thread that resumed it.		*/
+} transport_reactor_t;
+
+static int transport_reactor_write(void * context_p, const unsigned char * data, size_t size);
+static int transport_reactor_read(void * context_p, unsigned char * data, size_t size, double timeout);
+static int transport_reactor_set_lines(void * context_p, unsigned int set_lines, unsigned int clear_lines);
+static int transport_reactor_set_baudrate(void * context_p, unsigned int baudrate);
+static int transport_reactor_set_low_latency(void * context_p, bool enabled);
+static void transport_reactor_sleep_until(void * context_p, double deadline);
+static void transport_reactor_destroy(void * context_p);
+static void transport_reactor_event(void * user_data, int fd, serial_reactor_event event, size_t size);
+static int transport_reactor_make_context(transport_reactor_t * reactor_transport_p);
+static void transport_reactor_entry(unsigned int low, unsigned int high);
+static void transport_reactor_resume(transport_reactor_t * reactor_transport_p);
+static int transport_reactor_wait(transport_reactor_t * reactor_transport_p);
+
+static const transport_operations_t transport_reactor_operations =
+{
+	transport_reactor_write,
+	NULL,
+	transport_reactor_read,
+	transport_reactor_set_lines,
+	transport_reactor_set_baudrate,
+	transport_reactor_set_low_latency,
+	NULL,
+	transport_reactor_sleep_until,
+	transport_reactor_destroy,
+	NULL
+};
+
+/**
+ * @brief	Construct a transport over an open serial port and add the port to a reactor.
+ *
+ * The port is switched to non-blocking mode. It stays owned by the caller and
+ * is not closed when the transport is destroyed, but it is removed from the
+ * reactor.
+ *
+ * @param	reactor_p		The reactor object.
+ * @param	fd				File descriptor for the serial port.
+ * @return	The transport object, or NULL on error.
+ */
+transport_t * transport_reactor_construct(serial_reactor_t * reactor_p, int fd)
+{
+	int error = 0;
+	transport_reactor_t * reactor_transport_p;
+	transport_t * transport_p = NULL;
+	int flags;
+
+	// Allocate memory for the reactor transport state.
+	reactor_transport_p = calloc(1, sizeof(transport_reactor_t));
+
+	if (reactor_transport_p == NULL) {
+		// Could not allocate memory.
+		fprintf(stderr, "Failed to allocate memory for the reactor transport.\n");
+		error = 1;
+	}
+	else {
+		reactor_transport_p->reactor_p = reactor_p;
+		reactor_transport_p->fd = fd;
+	}
+
+	if (!error) {
+		// The reactor must never block in a read or write.
+		flags = fcntl(fd, F_GETFL);
+		if ((flags == -1) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)) {
+			fprintf(stderr, "Failed to make port %d non-blocking: %s\n", fd, strerror(errno));
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		error = serial_reactor_add(reactor_p, fd, transport_reactor_event, reactor_transport_p);
+	}
+
+	if (!error) {
+		transport_p = transport_construct(&transport_reactor_operations, reactor_transport_p);
+		if (transport_p == NULL) {
+			serial_reactor_remove(reactor_p, fd);
+			error = 1;
+		}
+		else {
+			reactor_transport_p->transport_p = transport_p;
+		}
+	}
+
+	if (error) {
+		free(reactor_transport_p);
+	}
+
+	return transport_p;
+}
+
+/**
+ * @brief	Start a session on a reactor transport.
+ *
+ * The session runs right away, up to its first operation that has to wait.
+ * Destroy the transport only after the session has ended.
+ *
+ * @param	transport_p		The transport object.
+ * @param	session			Session function.
+ * @param	user_data		User data passed to the session.
+ * @return	0 on success, 1 on error.
+ */
+int transport_reactor_start(transport_t * transport_p, transport_reactor_session session, void * user_data)
+{
+	int error = 0;
+	transport_reactor_t * reactor_transport_p = transport_p->context_p;
+
+	if (reactor_transport_p->running) {
+		fprintf(stderr, "A session is already running on port %d.\n", reactor_transport_p->fd);
+		error = 1;
+	}
+
+	if (!error && (reactor_transport_p->stack == NULL)) {
+		reactor_transport_p->stack = malloc(TRANSPORT_REACTOR_STACK_SIZE);
+		if (reactor_transport_p->stack == NULL) {
+			fprintf(stderr, "Failed to allocate memory for the session stack.\n");
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		error = transport_reactor_make_context(reactor_transport_p);
+	}
+
+	if (!error) {
+		reactor_transport_p->session = session;
+		reactor_transport_p->user_data = user_data;
+		reactor_transport_p->running = true;
+		reactor_transport_p->result = 0;
+		transport_reactor_resume(reactor_transport_p);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Get the result of the ended session of a reactor transport.
+ * @param	transport_p		The transport object.
+ * @return	Value returned by the session, 1 if it is still running.
+ */
+int transport_reactor_get_result(transport_t * transport_p)
+{
+	transport_reactor_t * reactor_transport_p = transport_p->context_p;
+
+	return reactor_transport_p->running ? 1 : reactor_transport_p->result;
+}
+
+static int transport_reactor_write(void * context_p, const unsigned char * data, size_t size)
+{
+	transport_reactor_t * reactor_transport_p = context_p;
+	int written_size = 0;
+
+	if (!serial_reactor_write(reactor_transport_p->reactor_p, reactor_transport_p->fd, (const char *) data, size) &&
+		!transport_reactor_wait(reactor_transport_p))
+	{
+		written_size = (int) reactor_transport_p->size;
+	}
+
+	return written_size;
+}
+
+static int transport_reactor_read(void * context_p, unsigned char * data, size_t size, double timeout)
+{
+	transport_reactor_t * reactor_transport_p = context_p;
+	int read_size = 0;
+
+	// A zero timeout still takes the data that is already waiting.
+	if (timeout <= 0) {
+		timeout = 1e-9;
+	}
+
+	if ((size > 0) &&
+		!serial_reactor_read(reactor_transport_p->reactor_p, reactor_transport_p->fd, (char *) data, size, timeout))
+	{
+		transport_reactor_wait(reactor_transport_p);
+		read_size = (int) reactor_transport_p->size;
+	}
+
+	return read_size;
+}
+
+static int transport_reactor_set_lines(void * context_p, unsigned int set_lines, unsigned int clear_lines)
+{
+	transport_reactor_t * reactor_transport_p = context_p;
+
+	return serial_set_lines(reactor_transport_p->fd, set_lines, clear_lines);
+}
+
+static int transport_reactor_set_baudrate(void * context_p, unsigned int baudrate)
+{
+	transport_reactor_t * reactor_transport_p = context_p;
+
+	return serial_change_baudrate(reactor_transport_p->fd, (serial_baudrate) baudrate);
+}
+
+static int transport_reactor_set_low_latency(void * context_p, bool enabled)
+{
+	transport_reactor_t * reactor_transport_p = context_p;
+
+	return serial_set_low_latency(reactor_transport_p->fd, enabled);
+}
+
+static void transport_reactor_sleep_until(void * context_p, double deadline)
+{
+	transport_reactor_t * reactor_transport_p = context_p;
+	struct timespec now;
+	double timeout;
+
+	// The deadline is on the monotonic clock, the default of a transport.
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	timeout = deadline - (now.tv_sec + now.tv_nsec / 1e9);
+
+	if ((timeout > 0) && !serial_reactor_set_deadline(reactor_transport_p->reactor_p, reactor_transport_p->fd, timeout)) {
+		transport_reactor_wait(reactor_transport_p);
+	}
+}
+
+static void transport_reactor_destroy(void * context_p)
+{
+	transport_reactor_t * reactor_transport_p = context_p;
+
+	serial_reactor_remove(reactor_transport_p->reactor_p, reactor_transport_p->fd);
+	free(reactor_transport_p->stack);
+	free(reactor_transport_p);
+}
+
+/**
+ * @brief	Reactor callback of a port, resumes the operation that waits for the event.
+ * @param	user_data		The reactor transport state.
+ * @param	fd				File descriptor of the port.
+ * @param	event			The event that occurred.
+ * @param	size			Amount of data transferred.
+ * @return	None.
+ */
+static void transport_reactor_event(void * user_data, int fd, serial_reactor_event event, size_t size)
+{
+	transport_reactor_t * reactor_transport_p = user_data;
+
+	(void) fd;
+
+	// An error of an idle port shows in the next operation of the session.
+	if (!reactor_transport_p->waiting) {
+		return;
+	}
+
+	reactor_transport_p->waiting = false;
+	reactor_transport_p->event = event;
+	reactor_transport_p->size = size;
+
+	if (reactor_transport_p->running) {
+		transport_reactor_resume(reactor_transport_p);
+	}
+}
+
+/**
+ * @brief	Prepare the session context of a port to run from the start.
+ * @param	reactor_transport_p		The reactor transport state.
+ * @return	0 on success, 1 on error.
+ */
+static int transport_reactor_make_context(transport_reactor_t * reactor_transport_p)
+{
+	int error = 0;
+	uintptr_t pointer = (uintptr_t) reactor_transport_p;
+
+	if (getcontext(&reactor_transport_p->session_context) == -1) {
+		fprintf(stderr, "Failed to create the session context: %s\n", strerror(errno));
+		error = 1;
+	}
+	else {
+		// An ended session returns to whatever resumed it last.
+		reactor_transport_p->session_context.uc_stack.ss_sp = reactor_transport_p->stack;
+		reactor_transport_p->session_context.uc_stack.ss_size = TRANSPORT_REACTOR_STACK_SIZE;
+		reactor_transport_p->session_context.uc_link = &reactor_transport_p->thread_context;
+
+		// Context arguments are ints, the state pointer is passed in two halves.
+		makecontext(&reactor_transport_p->session_context, (void (*)(void)) transport_reactor_entry, 2,
+				(unsigned int) pointer, (unsigned int) ((uint64_t) pointer >> 32));
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Entry point of a session context.
+ * @param	low				Low half of the reactor transport state pointer.
+ * @param	high			High half of the reactor transport state pointer.
+ * @return	None.
+ */
+static void transport_reactor_entry(unsigned int low, unsigned int high)
+{
+	transport_reactor_t * reactor_transport_p = (transport_reactor_t *) (uintptr_t) (((uint64_t) high << 32) | low);
+
+	reactor_transport_p->result = reactor_transport_p->session(reactor_transport_p->transport_p,
+			reactor_transport_p->user_data);
+	reactor_transport_p->running = false;
+}
+
+/**
+ * @brief	Run the session of a port until it waits or ends.
+ * @param	reactor_transport_p		The reactor transport state.
+ * @return	None.
+ */
+static void transport_reactor_resume(transport_reactor_t * reactor_transport_p)
+{
+	swapcontext(&reactor_transport_p->thread_context, &reactor_transport_p->session_context);
+}
+
+/**
+ * @brief	Wait for the pending operation of a port to end.
+ * @param	reactor_transport_p		The reactor transport state.
+ * @return	0 when the operation completed, 1 on a timeout or error.
+ */
+static int transport_reactor_wait(transport_reactor_t * reactor_transport_p)
+{
+	int error = 0;
+
+	reactor_transport_p->waiting = true;
+
+	if (reactor_transport_p->running) {
+		// Let the thread run the reactor, the event callback comes back here.
+		swapcontext(&reactor_transport_p->session_context, &reactor_transport_p->thread_context);
+	}
+	else {
+		while (reactor_transport_p->waiting && !error) {
+			error = serial_reactor_run_once(reactor_transport_p->reactor_p, -1);
+		}
+	}
+
+	if (error || reactor_transport_p->waiting ||
+		(reactor_transport_p->event == serial_reactor_timeout) || (reactor_transport_p->event == serial_reactor_error))
+	{
+		reactor_transport_p->waiting = false;
+		error = 1;
+	}
+
+	return error;
+}
+
+/**
+ * @}
+ */
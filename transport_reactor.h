@@ -0,0 +1,41 @@
+/**
+ * @file	transport_reactor.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the serial reactor transport.
+ */
+
+#ifndef TRANSPORT_REACTOR_H_
+#define TRANSPORT_REACTOR_H_
+
+#include "serial_reactor.h"
+#include "transport.h"
+
+/**
+ * @addtogroup transport
+ * @{
+ */
+
+/**
+ * @brief Stack size of a session.
+ */
+#define TRANSPORT_REACTOR_STACK_SIZE	(256 * 1024)
+
+/**
+ * @brief	Session run on a reactor transport.
+ * @param	transport_p		The transport of the session.
+ * @param	user_data		User data passed to transport_reactor_start().
+ * @return	0 on success, any other value on error.
+ */
+typedef int (*transport_reactor_session)(transport_t * transport_p, void * user_data);
+
+transport_t * transport_reactor_construct(serial_reactor_t * reactor_p, int fd);
+int transport_reactor_start(transport_t * transport_p, transport_reactor_session session, void * user_data);
+int transport_reactor_get_result(transport_t * transport_p);
+
+/**
+ * @}
+ */
+
+#endif /* TRANSPORT_REACTOR_H_ */
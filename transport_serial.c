@@ -0,0 +1,103 @@
+/**
+ * @file	transport_serial.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the serial port transport.
+ */
+
+#include <stdint.h>
+
+#include "serial.h"
+#include "transport_serial.h"
+
+/**
+ * @addtogroup transport
+ * @{
+ */
+
+static int transport_serial_write(void * context_p, const unsigned char * data, size_t size);
+static int transport_serial_writev(void * context_p, const struct iovec * vectors, int count);
+static int transport_serial_read(void * context_p, unsigned char * data, size_t size, double timeout);
+static int transport_serial_set_lines(void * context_p, unsigned int set_lines, unsigned int clear_lines);
+static int transport_serial_set_baudrate(void * context_p, unsigned int baudrate);
+static int transport_serial_set_low_latency(void * context_p, bool enabled);
+
+static const transport_operations_t transport_serial_operations =
+{
+	transport_serial_write,
+	transport_serial_writev,
+	transport_serial_read,
+	transport_serial_set_lines,
+	transport_serial_set_baudrate,
+	transport_serial_set_low_latency,
+	NULL,
+	NULL,
+	NULL,
+	NULL
+};
+
+/**
+ * @brief	Construct a transport over an open serial port.
+ *
+ * The port stays owned by the caller and is not closed when the transport is
+ * destroyed.
+ *
+ * @param	fd				File descriptor for the serial port.
+ * @return	The transport object, or NULL on error.
+ */
+transport_t * transport_serial_construct(int fd)
+{
+	// The file descriptor is stored in the context pointer itself.
+	return transport_construct(&transport_serial_operations, (void *) (intptr_t) fd);
+}
+
+/**
+ * @brief	Get the serial port of a serial transport.
+ * @param	transport_p		The transport object.
+ * @return	File descriptor for the serial port, -1 if this is not a serial transport.
+ */
+int transport_serial_get_fd(transport_t * transport_p)
+{
+	int fd = -1;
+
+	if (transport_p->operations == &transport_serial_operations) {
+		fd = (int) (intptr_t) transport_p->context_p;
+	}
+
+	return fd;
+}
+
+static int transport_serial_write(void * context_p, const unsigned char * data, size_t size)
+{
+	return serial_write((int) (intptr_t) context_p, (const char *) data, size);
+}
+
+static int transport_serial_writev(void * context_p, const struct iovec * vectors, int count)
+{
+	return serial_writev((int) (intptr_t) context_p, vectors, count);
+}
+
+static int transport_serial_read(void * context_p, unsigned char * data, size_t size, double timeout)
+{
+	return serial_read((int) (intptr_t) context_p, (char *) data, size, timeout);
+}
+
+static int transport_serial_set_lines(void * context_p, unsigned int set_lines, unsigned int clear_lines)
+{
+	return serial_set_lines((int) (intptr_t) context_p, set_lines, clear_lines);
+}
+
+static int transport_serial_set_baudrate(void * context_p, unsigned int baudrate)
+{
+	return serial_change_baudrate((int) (intptr_t) context_p, (serial_baudrate) baudrate);
+}
+
+static int transport_serial_set_low_latency(void * context_p, bool enabled)
+{
+	return serial_set_low_latency((int) (intptr_t) context_p, enabled);
+}
+
+/**
+ * @}
+ */
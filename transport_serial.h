@@ -0,0 +1,26 @@
+/**
+ * @file	transport_serial.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the serial port transport.
+ */
+
+#ifndef TRANSPORT_SERIAL_H_
+#define TRANSPORT_SERIAL_H_
+
+#include "transport.h"
+
+/**
+ * @addtogroup transport
+ * @{
+ */
+
+transport_t * transport_serial_construct(int fd);
+int transport_serial_get_fd(transport_t * transport_p);
+
+/**
+ * @}
+ */
+
+#endif /* TRANSPORT_SERIAL_H_ */
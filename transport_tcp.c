@@ -0,0 +1,554 @@
+/**
+ * @file	transport_tcp.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the network serial port transport.
+ *
+ * Connects to a serial device server, either as a raw TCP stream or with
+ * Telnet COM port control (RFC 2217), which adds line rate and DTR/RTS
+ * control so the BSL entry sequence works remotely.
+ *
+ * Every request is a single short round trip, so the transport is tuned for
+ * latency: Nagle's algorithm is disabled, every write (a complete frame, with
+ * its escaping and any line commands) goes out as one segment, and the round
+ * trip time the kernel measured for the connection is reported as a latency
+ * margin, which the protocol adds once to each command deadline, so a slow
+ * network does not turn into protocol timeouts.
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rfc2217.h"
+#include "serial.h"
+#include "transport_tcp.h"
+#include "wire_capture.h"
+
+/**
+ * @addtogroup transport
+ * @{
+ */
+
+/**
+ * @brief Round trip time variations added to the latency margin.
+ */
+#define TRANSPORT_TCP_RTT_VARIATIONS	(4)
+
+/**
+ * @brief Data written in one encoding step, the encoded data is at most twice as large.
+ */
+#define TRANSPORT_TCP_WRITE_CHUNK_SIZE	(512)
+
+/**
+ * @brief TCP transport state.
+ */
+typedef struct
+{
+	int					fd;									/**< The connected socket.				*/
+	bool				rfc2217;							/**< TRUE = RFC 2217, FALSE = raw.		*/
+	rfc2217_decoder_t	decoder;							/**< Decoder for the received stream.	*/
+	unsigned char		buffer[TRANSPORT_TCP_BUFFER_SIZE];	/**< Received data not yet read.		*/
+	size_t				head;								/**< Oldest unread byte.				*/
+	size_t				count;								/**< Number of unread bytes.			*/
+} transport_tcp_t;
+
+static int transport_tcp_write(void * context_p, const unsigned char * data, size_t size);
+static int transport_tcp_writev(void * context_p, const struct iovec * vectors, int count);
+static int transport_tcp_read(void * context_p, unsigned char * data, size_t size, double timeout);
+static int transport_tcp_set_lines(void * context_p, unsigned int set_lines, unsigned int clear_lines);
+static int transport_tcp_set_baudrate(void * context_p, unsigned int baudrate);
+static int transport_tcp_set_low_latency(void * context_p, bool enabled);
+static void transport_tcp_destroy(void * context_p);
+static int transport_tcp_send(transport_tcp_t * tcp_p, const unsigned char * data, size_t size);
+static double transport_tcp_get_rtt_margin(void * context_p);
+static void transport_tcp_option(void * user_data, unsigned char command, unsigned char option);
+
+static const transport_operations_t transport_tcp_operations =
+{
+	transport_tcp_write,
+	transport_tcp_writev,
+	transport_tcp_read,
+	transport_tcp_set_lines,
+	transport_tcp_set_baudrate,
+	transport_tcp_set_low_latency,
+	NULL,
+	NULL,
+	transport_tcp_destroy,
+	transport_tcp_get_rtt_margin
+};
+
+static const rfc2217_handler_t transport_tcp_handler =
+{
+	transport_tcp_option,
+	NULL
+};
+
+/**
+ * @brief	Connect to a serial device server.
+ *
+ * With RFC 2217 the port is configured for the BSL: 9600 baud, 8 data bits,
+ * even parity and 1 stop bit.
+ *
+ * @param	host			Host name or address of the server.
+ * @param	port			TCP port or service name.
+ * @param	rfc2217			TRUE to use RFC 2217, FALSE for a raw TCP stream.
+ * @return	The transport object, or NULL on error.
+ */
+transport_t * transport_tcp_construct(const char * host, const char * port, bool rfc2217)
+{
+	int error = 0;
+	transport_tcp_t * tcp_p;
+	transport_t * transport_p = NULL;
+	struct addrinfo hints;
+	struct addrinfo * addresses = NULL;
+	struct addrinfo * address_p;
+	int result;
+
+	// Allocate memory for the TCP state.
+	tcp_p = malloc(sizeof(transport_tcp_t));
+
+	if (tcp_p == NULL) {
+		// Could not allocate memory.
+		fprintf(stderr, "Failed to allocate memory for the TCP transport.\n");
+		error = 1;
+	}
+	else {
+		tcp_p->fd = -1;
+		tcp_p->rfc2217 = rfc2217;
+		tcp_p->head = 0;
+		tcp_p->count = 0;
+		rfc2217_decoder_init(&tcp_p->decoder);
+	}
+
+	if (!error) {
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+
+		result = getaddrinfo(host, port, &hints, &addresses);
+		if (result != 0) {
+			fprintf(stderr, "Could not resolve %s:%s: %s\n", host, port, gai_strerror(result));
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		// Use the first address that accepts the connection.
+		for (address_p = addresses; (address_p != NULL) && (tcp_p->fd == -1); address_p = address_p->ai_next) {
+			tcp_p->fd = socket(address_p->ai_family, address_p->ai_socktype, address_p->ai_protocol);
+			if ((tcp_p->fd != -1) && (connect(tcp_p->fd, address_p->ai_addr, address_p->ai_addrlen) == -1)) {
+				close(tcp_p->fd);
+				tcp_p->fd = -1;
+			}
+		}
+
+		if (tcp_p->fd == -1) {
+			fprintf(stderr, "Could not connect to %s:%s: %s\n", host, port, strerror(errno));
+			error = 1;
+		}
+	}
+
+	if (!error) {
+		error = transport_tcp_set_low_latency(tcp_p, true);
+	}
+
+	if (!error && rfc2217) {
+		unsigned char request[4 * 3 + 4 * RFC2217_COMMAND_SIZE];
+		size_t request_size = 0;
+
+		// Negotiate a binary stream with COM port control and set the BSL format, in one segment.
+		request_size += rfc2217_encode_option(RFC2217_WILL, RFC2217_OPTION_BINARY, &request[request_size]);
+		request_size += rfc2217_encode_option(RFC2217_DO, RFC2217_OPTION_BINARY, &request[request_size]);
+		request_size += rfc2217_encode_option(RFC2217_DO, RFC2217_OPTION_SUPPRESS_GO_AHEAD, &request[request_size]);
+		request_size += rfc2217_encode_option(RFC2217_WILL, RFC2217_OPTION_COM_PORT, &request[request_size]);
+		request_size += rfc2217_encode_command(RFC2217_SET_BAUDRATE, baudrate_9600, 4, &request[request_size]);
+		request_size += rfc2217_encode_command(RFC2217_SET_DATASIZE, 8, 1, &request[request_size]);
+		request_size += rfc2217_encode_command(RFC2217_SET_PARITY, RFC2217_PARITY_EVEN, 1, &request[request_size]);
+		request_size += rfc2217_encode_command(RFC2217_SET_STOPSIZE, RFC2217_STOPSIZE_1, 1, &request[request_size]);
+
+		error = transport_tcp_send(tcp_p, request, request_size);
+	}
+
+	if (!error) {
+		transport_p = transport_construct(&transport_tcp_operations, tcp_p);
+		if (transport_p == NULL) {
+			error = 1;
+		}
+	}
+
+	if (error && (tcp_p != NULL)) {
+		transport_tcp_destroy(tcp_p);
+	}
+
+	if (addresses != NULL) {
+		freeaddrinfo(addresses);
+	}
+
+	return transport_p;
+}
+
+/**
+ * @brief	Connect to a serial device server given as tcp://host:port or rfc2217://host:port.
+ * @param	url				The server URL.
+ * @return	The transport object, or NULL on error.
+ */
+transport_t * transport_tcp_construct_from_url(const char * url)
+{
+	transport_t * transport_p = NULL;
+	bool rfc2217;
+	const char * host;
+	const char * separator;
+	char host_name[256];
+
+	if (strncmp(url, "tcp://", 6) == 0) {
+		rfc2217 = false;
+		host = &url[6];
+	}
+	else if (strncmp(url, "rfc2217://", 10) == 0) {
+		rfc2217 = true;
+		host = &url[10];
+	}
+	else {
+		host = NULL;
+	}
+
+	// The port follows the last colon, so bracketed IPv6 addresses keep theirs.
+	separator = (host != NULL) ? strrchr(host, ':') : NULL;
+
+	if ((separator == NULL) || ((size_t) (separator - host) >= sizeof(host_name))) {
+		fprintf(stderr, "Invalid network port %s, expected tcp://host:port or rfc2217://host:port.\n", url);
+	}
+	else {
+		if ((host[0] == '[') && (separator[-1] == ']')) {
+			host++;
+			memcpy(host_name, host, separator - host - 1);
+			host_name[separator - host - 1] = '\0';
+		}
+		else {
+			memcpy(host_name, host, separator - host);
+			host_name[separator - host] = '\0';
+		}
+
+		transport_p = transport_tcp_construct(host_name, separator + 1, rfc2217);
+	}
+
+	return transport_p;
+}
+
+/**
+ * @brief	Get the socket of a TCP transport.
+ * @param	transport_p		The transport object.
+ * @return	File descriptor for the socket, -1 if this is not a TCP transport.
+ */
+int transport_tcp_get_fd(transport_t * transport_p)
+{
+	int fd = -1;
+
+	if (transport_p->operations == &transport_tcp_operations) {
+		fd = ((transport_tcp_t *) transport_p->context_p)->fd;
+	}
+
+	return fd;
+}
+
+static int transport_tcp_write(void * context_p, const unsigned char * data, size_t size)
+{
+	transport_tcp_t * tcp_p = context_p;
+	int written_size = 0;
+
+	WIRE_CAPTURE(tcp_p->fd, wire_capture_tx, data, size);
+
+	if (!tcp_p->rfc2217) {
+		if (!transport_tcp_send(tcp_p, data, size)) {
+			written_size = (int) size;
+		}
+	}
+	else {
+		unsigned char encoded[2 * TRANSPORT_TCP_WRITE_CHUNK_SIZE];
+		size_t chunk_size;
+		int error = 0;
+
+		// A BSL frame fits in a single chunk, so it is sent as one segment.
+		while ((written_size < (int) size) && !error) {
+			chunk_size = size - written_size;
+			if (chunk_size > TRANSPORT_TCP_WRITE_CHUNK_SIZE) {
+				chunk_size = TRANSPORT_TCP_WRITE_CHUNK_SIZE;
+			}
+
+			error = transport_tcp_send(tcp_p, encoded, rfc2217_encode_data(&data[written_size], chunk_size, encoded));
+			if (!error) {
+				written_size += (int) chunk_size;
+			}
+		}
+	}
+
+	return written_size;
+}
+
+static int transport_tcp_writev(void * context_p, const struct iovec * vectors, int count)
+{
+	transport_tcp_t * tcp_p = context_p;
+	unsigned char encoded[2 * TRANSPORT_TCP_WRITE_CHUNK_SIZE];
+	size_t encoded_size = 0;
+	int written_size = 0;
+	int error = 0;
+	int gathered;
+	int i;
+
+	// Gather and escape the parts so the frame still goes out as one segment.
+	for (gathered = 0; gathered < count; gathered++) {
+		if (encoded_size + 2 * vectors[gathered].iov_len > sizeof(encoded)) {
+			break;
+		}
+
+		if (tcp_p->rfc2217) {
+			encoded_size += rfc2217_encode_data(vectors[gathered].iov_base, vectors[gathered].iov_len, &encoded[encoded_size]);
+		}
+		else {
+			memcpy(&encoded[encoded_size], vectors[gathered].iov_base, vectors[gathered].iov_len);
+			encoded_size += vectors[gathered].iov_len;
+		}
+		written_size += (int) vectors[gathered].iov_len;
+	}
+	WIRE_CAPTURE_VECTORS(tcp_p->fd, wire_capture_tx, vectors, gathered, (size_t) written_size);
+
+	if ((encoded_size > 0) && transport_tcp_send(tcp_p, encoded, encoded_size)) {
+		written_size = 0;
+		error = 1;
+	}
+
+	// Parts beyond the gather buffer follow separately, the first one may not fit at all.
+	for (i = gathered; (i < count) && !error; i++) {
+		int part_size = transport_tcp_write(tcp_p, vectors[i].iov_base, vectors[i].iov_len);
+
+		written_size += part_size;
+		error = (part_size != (int) vectors[i].iov_len);
+	}
+
+	return written_size;
+}
+
+static int transport_tcp_read(void * context_p, unsigned char * data, size_t size, double timeout)
+{
+	transport_tcp_t * tcp_p = context_p;
+	size_t read_size = 0;
+	struct timespec now;
+	double deadline;
+	int error = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	deadline = now.tv_sec + now.tv_nsec / 1e9 + timeout;
+
+	while ((read_size < size) && !error) {
+		if (tcp_p->count > 0) {
+			// Copy from the buffer, at most two contiguous parts because of the wrap around.
+			size_t copy_size = size - read_size;
+			size_t contiguous_size = TRANSPORT_TCP_BUFFER_SIZE - tcp_p->head;
+
+			if (copy_size > tcp_p->count) {
+				copy_size = tcp_p->count;
+			}
+			if (copy_size > contiguous_size) {
+				copy_size = contiguous_size;
+			}
+
+			memcpy(&data[read_size], &tcp_p->buffer[tcp_p->head], copy_size);
+			tcp_p->head = (tcp_p->head + copy_size) % TRANSPORT_TCP_BUFFER_SIZE;
+			tcp_p->count -= copy_size;
+			read_size += copy_size;
+		}
+		else {
+			struct pollfd poll_fd = {tcp_p->fd, POLLIN, 0};
+			ssize_t received_size;
+			size_t data_size;
+			int remaining;
+			int poll_result = 0;
+
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			remaining = (int) ((deadline - (now.tv_sec + now.tv_nsec / 1e9)) * 1e3 + 0.5);
+
+			if (remaining > 0) {
+				poll_result = poll(&poll_fd, 1, remaining);
+			}
+
+			// An interrupted poll is repeated for the time that is left.
+			if ((poll_result < 0) && (errno != EINTR)) {
+				fprintf(stderr, "Failed to wait for the network port: %s.\n", strerror(errno));
+				error = 1;
+			}
+			else if (poll_result == 0) {
+				fprintf(stderr, "A timeout occurred.\n");
+				error = 1;
+			}
+			else if (poll_result > 0) {
+				// The buffer is empty here, so receive into it and decode in place.
+				received_size = recv(tcp_p->fd, tcp_p->buffer, TRANSPORT_TCP_BUFFER_SIZE, 0);
+
+				if (received_size < 0) {
+					if (errno != EINTR) {
+						fprintf(stderr, "Failed to receive from the network port: %s.\n", strerror(errno));
+						error = 1;
+					}
+				}
+				else if (received_size == 0) {
+					fprintf(stderr, "The network port closed the connection.\n");
+					error = 1;
+				}
+				else {
+					data_size = (size_t) received_size;
+					if (tcp_p->rfc2217) {
+						data_size = rfc2217_decode(&tcp_p->decoder, &transport_tcp_handler, tcp_p, tcp_p->buffer, data_size);
+					}
+
+					WIRE_CAPTURE(tcp_p->fd, wire_capture_rx, tcp_p->buffer, data_size);
+
+					tcp_p->head = 0;
+					tcp_p->count = data_size;
+				}
+			}
+		}
+	}
+
+	return (int) read_size;
+}
+
+static int transport_tcp_set_lines(void * context_p, unsigned int set_lines, unsigned int clear_lines)
+{
+	transport_tcp_t * tcp_p = context_p;
+	unsigned char request[4 * RFC2217_COMMAND_SIZE];
+	size_t request_size = 0;
+	int error = 0;
+
+	// A raw stream has no modem lines, like a pseudo-terminal.
+	if (tcp_p->rfc2217) {
+		if (set_lines & SERIAL_LINE_DTR) {
+			request_size += rfc2217_encode_command(RFC2217_SET_CONTROL, RFC2217_CONTROL_DTR_ON, 1, &request[request_size]);
+		}
+		if (clear_lines & SERIAL_LINE_DTR) {
+			request_size += rfc2217_encode_command(RFC2217_SET_CONTROL, RFC2217_CONTROL_DTR_OFF, 1, &request[request_size]);
+		}
+		if (set_lines & SERIAL_LINE_RTS) {
+			request_size += rfc2217_encode_command(RFC2217_SET_CONTROL, RFC2217_CONTROL_RTS_ON, 1, &request[request_size]);
+		}
+		if (clear_lines & SERIAL_LINE_RTS) {
+			request_size += rfc2217_encode_command(RFC2217_SET_CONTROL, RFC2217_CONTROL_RTS_OFF, 1, &request[request_size]);
+		}
+
+		// Both lines change in the same segment.
+		if (request_size > 0) {
+			error = transport_tcp_send(tcp_p, request, request_size);
+		}
+	}
+
+	return error;
+}
+
+static int transport_tcp_set_baudrate(void * context_p, unsigned int baudrate)
+{
+	transport_tcp_t * tcp_p = context_p;
+	unsigned char request[RFC2217_COMMAND_SIZE];
+	int error = 0;
+
+	if (!tcp_p->rfc2217) {
+		fprintf(stderr, "The line rate of a raw TCP port cannot be changed, use RFC 2217.\n");
+		error = 1;
+	}
+	else {
+		error = transport_tcp_send(tcp_p, request, rfc2217_encode_command(RFC2217_SET_BAUDRATE, baudrate, 4, request));
+	}
+
+	return error;
+}
+
+static int transport_tcp_set_low_latency(void * context_p, bool enabled)
+{
+	transport_tcp_t * tcp_p = context_p;
+	int error = 0;
+	int value = enabled ? 1 : 0;
+
+	// Without Nagle's algorithm small frames are sent immediately.
+	if (setsockopt(tcp_p->fd, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value)) == -1) {
+		fprintf(stderr, "Could not configure the network port: %s.\n", strerror(errno));
+		error = 1;
+	}
+
+	return error;
+}
+
+static void transport_tcp_destroy(void * context_p)
+{
+	transport_tcp_t * tcp_p = context_p;
+
+	if (tcp_p->fd != -1) {
+		close(tcp_p->fd);
+	}
+
+	free(tcp_p);
+}
+
+static int transport_tcp_send(transport_tcp_t * tcp_p, const unsigned char * data, size_t size)
+{
+	int error = 0;
+	size_t sent_size = 0;
+	ssize_t result;
+
+	while ((sent_size < size) && !error) {
+		result = send(tcp_p->fd, &data[sent_size], size - sent_size, MSG_NOSIGNAL);
+
+		if (result >= 0) {
+			sent_size += (size_t) result;
+		}
+		else if (errno != EINTR) {
+			fprintf(stderr, "Failed to send to the network port: %s.\n", strerror(errno));
+			error = 1;
+		}
+	}
+
+	return error;
+}
+
+static double transport_tcp_get_rtt_margin(void * context_p)
+{
+	transport_tcp_t * tcp_p = context_p;
+	struct tcp_info info;
+	socklen_t info_size = sizeof(info);
+	double margin = 0;
+
+	// The kernel keeps a smoothed round trip time and its variation, in microseconds.
+	if (getsockopt(tcp_p->fd, IPPROTO_TCP, TCP_INFO, &info, &info_size) == 0) {
+		margin = (info.tcpi_rtt + TRANSPORT_TCP_RTT_VARIATIONS * info.tcpi_rttvar) / 1e6;
+	}
+
+	return margin;
+}
+
+static void transport_tcp_option(void * user_data, unsigned char command, unsigned char option)
+{
+	transport_tcp_t * tcp_p = user_data;
+	unsigned char reply[3];
+
+	// Refuse everything the server offers or asks for beyond what was requested.
+	if ((option != RFC2217_OPTION_BINARY) && (option != RFC2217_OPTION_SUPPRESS_GO_AHEAD)
+			&& (option != RFC2217_OPTION_COM_PORT)) {
+		if (command == RFC2217_DO) {
+			transport_tcp_send(tcp_p, reply, rfc2217_encode_option(RFC2217_WONT, option, reply));
+		}
+		else if (command == RFC2217_WILL) {
+			transport_tcp_send(tcp_p, reply, rfc2217_encode_option(RFC2217_DONT, option, reply));
+		}
+	}
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,34 @@
+/**
+ * @file	transport_tcp.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the network serial port transport.
+ */
+
+#ifndef TRANSPORT_TCP_H_
+#define TRANSPORT_TCP_H_
+
+#include <stdbool.h>
+
+#include "transport.h"
+
+/**
+ * @addtogroup transport
+ * @{
+ */
+
+/**
+ * @brief Size of the receive buffer of a TCP transport.
+ */
+#define TRANSPORT_TCP_BUFFER_SIZE	(4096)
+
+transport_t * transport_tcp_construct(const char * host, const char * port, bool rfc2217);
+transport_t * transport_tcp_construct_from_url(const char * url);
+int transport_tcp_get_fd(transport_t * transport_p);
+
+/**
+ * @}
+ */
+
+#endif /* TRANSPORT_TCP_H_ */
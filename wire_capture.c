@@ -0,0 +1,771 @@
+/**
+ * @file	wire_capture.c
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Source file for the serial wire capture library.
+ *
+ * Traffic is recorded in a preallocated ring of fixed size slots. Writers
+ * reserve a slot with a single atomic increment and publish it through the
+ * slot sequence number, so recording never blocks and never allocates. When
+ * the ring wraps the oldest slots are overwritten.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "checksum.h"
+#include "wire_capture.h"
+
+/**
+ * @defgroup wire_capture Wire Capture
+ * @brief Library functions for capturing and decoding serial traffic.
+ * @{
+ */
+
+#define WIRE_CAPTURE_SLOT_COUNT			(4096)
+#define WIRE_CAPTURE_SLOT_DATA_SIZE		(48)
+#define WIRE_CAPTURE_FLAG_CONTINUATION	(0x01)
+#define WIRE_CAPTURE_FILE_MAGIC			"BSLWCAP"
+#define WIRE_CAPTURE_FILE_VERSION		(1)
+#define WIRE_CAPTURE_DECODE_PORTS		(16)
+#define WIRE_CAPTURE_DECODE_FRAME_SIZE	(3 + 1 + 5 + 256 + 2)
+
+/**
+ * @brief A single captured chunk.
+ */
+typedef struct
+{
+	atomic_uint_fast64_t	sequence;	/**< Reservation index + 1 when published, 0 while written.	*/
+	uint64_t				timestamp;	/**< Monotonic time in nanoseconds.							*/
+	int						fd;			/**< File descriptor of the port.							*/
+	unsigned char			direction;	/**< A wire_capture_direction value.						*/
+	unsigned char			flags;		/**< WIRE_CAPTURE_FLAG_* bits.								*/
+	unsigned short			size;		/**< Number of valid bytes in data.							*/
+	unsigned char			data[WIRE_CAPTURE_SLOT_DATA_SIZE];
+} wire_capture_slot_t;
+
+/**
+ * @brief Decoder state for a single port.
+ */
+typedef struct
+{
+	int				fd;
+	bool			used;
+	unsigned char	tx_data[WIRE_CAPTURE_DECODE_FRAME_SIZE];
+	size_t			tx_size;
+	uint64_t		tx_timestamp;
+	bool			tx_pending;
+	unsigned char	rx_data[WIRE_CAPTURE_DECODE_FRAME_SIZE];
+	size_t			rx_size;
+	size_t			rx_expected;
+	uint64_t		rx_timestamp;
+	bool			core;
+} wire_capture_port_t;
+
+atomic_bool wire_capture_enabled = false;
+
+static wire_capture_slot_t wire_capture_slots[WIRE_CAPTURE_SLOT_COUNT];
+static atomic_uint_fast64_t wire_capture_head = 0;
+
+static void wire_capture_store(int fd, wire_capture_direction direction, uint64_t timestamp, const unsigned char * data, size_t size, unsigned char flags);
+static uint64_t wire_capture_get_time(void);
+static void wire_capture_put(FILE * file, uint64_t value, size_t size);
+static int wire_capture_get(FILE * file, uint64_t * value_p, size_t size);
+static wire_capture_port_t * wire_capture_get_port(wire_capture_port_t * ports, int fd);
+static void wire_capture_decode_tx(FILE * output, wire_capture_port_t * port_p, uint64_t start);
+static void wire_capture_decode_rx(FILE * output, wire_capture_port_t * port_p, uint64_t start, uint64_t timestamp, unsigned char data);
+static void wire_capture_print_frame(FILE * output, const unsigned char * data, size_t size);
+static bool wire_capture_is_frame(const unsigned char * data, size_t size);
+static bool wire_capture_is_core_packet(const unsigned char * data, size_t size);
+static const char * wire_capture_command_name(unsigned char command);
+static const char * wire_capture_core_command_name(unsigned char command, bool * address_p);
+static bool wire_capture_checksum_valid(const unsigned char * data, size_t size);
+static bool wire_capture_crc_valid(const unsigned char * data, size_t size);
+
+/**
+ * @brief	Enable or disable capturing at runtime.
+ * @param	enabled		TRUE = capture traffic, FALSE = do not capture.
+ * @return	None.
+ */
+void wire_capture_enable(bool enabled)
+{
+	atomic_store(&wire_capture_enabled, enabled);
+}
+
+/**
+ * @brief	Discard all captured traffic.
+ * @return	None.
+ */
+void wire_capture_clear(void)
+{
+	size_t i;
+
+	for (i = 0; i < WIRE_CAPTURE_SLOT_COUNT; i++) {
+		atomic_store(&wire_capture_slots[i].sequence, 0);
+	}
+	atomic_store(&wire_capture_head, 0);
+}
+
+/**
+ * @brief	Record a chunk of traffic, use the WIRE_CAPTURE() macro instead of calling this directly.
+ * @param	fd				File descriptor of the port.
+ * @param	direction		Direction of the traffic.
+ * @param	data			Data on the wire.
+ * @param	size			Amount of data.
+ * @return	None.
+ */
+void wire_capture_record(int fd, wire_capture_direction direction, const void * data, size_t size)
+{
+	wire_capture_store(fd, direction, wire_capture_get_time(), data, size, 0);
+}
+
+/**
+ * @brief	Record scattered data as a single chunk, use the WIRE_CAPTURE_VECTORS() macro instead of calling this directly.
+ * @param	fd				File descriptor of the port.
+ * @param	direction		Direction of the traffic.
+ * @param	vectors			Parts of the data, in order.
+ * @param	count			Number of parts.
+ * @param	size			Amount of data that went out, the parts are cut off after it.
+ * @return	None.
+ */
+void wire_capture_record_vectors(int fd, wire_capture_direction direction, const struct iovec * vectors, int count, size_t size)
+{
+	uint64_t timestamp = wire_capture_get_time();
+	unsigned char flags = 0;
+	int i;
+
+	// The parts after the first continue its chunk, so the decoder sees a single write call.
+	for (i = 0; (i < count) && (size > 0); i++) {
+		size_t part_size = (vectors[i].iov_len > size) ? size : vectors[i].iov_len;
+
+		if (part_size > 0) {
+			wire_capture_store(fd, direction, timestamp, vectors[i].iov_base, part_size, flags);
+			flags = WIRE_CAPTURE_FLAG_CONTINUATION;
+			size -= part_size;
+		}
+	}
+}
+
+/**
+ * @brief	Write the captured traffic to a binary capture file.
+ * @param	filename		Name of the capture file.
+ * @return	0 on success, 1 on error.
+ */
+int wire_capture_dump(const char * filename)
+{
+	int error = 0;
+	FILE * file;
+	uint64_t head;
+	uint64_t index;
+	uint64_t count = 0;
+	long count_position = 0;
+
+	file = fopen(filename, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Failed to open capture file %s: %s\n", filename, strerror(errno));
+		error = 1;
+	}
+
+	if (!error) {
+		// Write the header, the record count is patched afterwards.
+		fwrite(WIRE_CAPTURE_FILE_MAGIC, 1, sizeof(WIRE_CAPTURE_FILE_MAGIC), file);
+		wire_capture_put(file, WIRE_CAPTURE_FILE_VERSION, 4);
+		count_position = ftell(file);
+		wire_capture_put(file, 0, 4);
+
+		head = atomic_load(&wire_capture_head);
+		index = (head > WIRE_CAPTURE_SLOT_COUNT) ? (head - WIRE_CAPTURE_SLOT_COUNT) : 0;
+
+		for (; index < head; index++) {
+			wire_capture_slot_t * slot_p = &wire_capture_slots[index % WIRE_CAPTURE_SLOT_COUNT];
+			wire_capture_slot_t slot;
+
+			// Copy the slot and skip it when it was overwritten while copying.
+			if (atomic_load_explicit(&slot_p->sequence, memory_order_acquire) != index + 1) {
+				continue;
+			}
+			slot.timestamp = slot_p->timestamp;
+			slot.fd = slot_p->fd;
+			slot.direction = slot_p->direction;
+			slot.flags = slot_p->flags;
+			slot.size = slot_p->size;
+			memcpy(slot.data, slot_p->data, sizeof(slot.data));
+			atomic_thread_fence(memory_order_acquire);
+			if (atomic_load_explicit(&slot_p->sequence, memory_order_relaxed) != index + 1) {
+				continue;
+			}
+
+			wire_capture_put(file, slot.timestamp, 8);
+			wire_capture_put(file, (uint32_t) slot.fd, 4);
+			wire_capture_put(file, slot.direction, 1);
+			wire_capture_put(file, slot.flags, 1);
+			wire_capture_put(file, slot.size, 2);
+			fwrite(slot.data, 1, slot.size, file);
+			count++;
+		}
+
+		// Patch the record count.
+		fseek(file, count_position, SEEK_SET);
+		wire_capture_put(file, count, 4);
+
+		if (ferror(file)) {
+			fprintf(stderr, "Failed to write capture file %s.\n", filename);
+			error = 1;
+		}
+		fclose(file);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Render a capture file as annotated BSL frames.
+ * @param	filename		Name of the capture file.
+ * @param	output			Stream to render the frames to.
+ * @return	0 on success, 1 on error.
+ */
+int wire_capture_decode(const char * filename, FILE * output)
+{
+	int error = 0;
+	FILE * file;
+	char magic[sizeof(WIRE_CAPTURE_FILE_MAGIC)];
+	uint64_t version;
+	uint64_t count = 0;
+	uint64_t record;
+	uint64_t start = 0;
+	wire_capture_port_t ports[WIRE_CAPTURE_DECODE_PORTS];
+	size_t i;
+
+	memset(ports, 0, sizeof(ports));
+
+	file = fopen(filename, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Failed to open capture file %s: %s\n", filename, strerror(errno));
+		error = 1;
+	}
+
+	if (!error) {
+		// Check the header.
+		if ((fread(magic, 1, sizeof(magic), file) != sizeof(magic)) ||
+			(memcmp(magic, WIRE_CAPTURE_FILE_MAGIC, sizeof(magic)) != 0) ||
+			wire_capture_get(file, &version, 4) || (version != WIRE_CAPTURE_FILE_VERSION) ||
+			wire_capture_get(file, &count, 4))
+		{
+			fprintf(stderr, "File %s is not a wire capture file.\n", filename);
+			error = 1;
+		}
+	}
+
+	for (record = 0; (record < count) && !error; record++) {
+		uint64_t timestamp;
+		uint64_t fd;
+		uint64_t direction;
+		uint64_t flags;
+		uint64_t size;
+		unsigned char data[WIRE_CAPTURE_SLOT_DATA_SIZE];
+		wire_capture_port_t * port_p;
+
+		if (wire_capture_get(file, &timestamp, 8) || wire_capture_get(file, &fd, 4) ||
+			wire_capture_get(file, &direction, 1) || wire_capture_get(file, &flags, 1) ||
+			wire_capture_get(file, &size, 2) || (size > sizeof(data)) ||
+			(fread(data, 1, size, file) != size))
+		{
+			fprintf(stderr, "Capture file %s is truncated.\n", filename);
+			error = 1;
+			break;
+		}
+
+		if (record == 0) {
+			start = timestamp;
+		}
+
+		port_p = wire_capture_get_port(ports, (int) fd);
+		if (port_p == NULL) {
+			continue;
+		}
+
+		if (direction == wire_capture_tx) {
+			// A new write call ends the previous one.
+			if (!(flags & WIRE_CAPTURE_FLAG_CONTINUATION)) {
+				wire_capture_decode_tx(output, port_p, start);
+				port_p->tx_pending = true;
+				port_p->tx_timestamp = timestamp;
+			}
+			for (i = 0; (i < size) && (port_p->tx_size < sizeof(port_p->tx_data)); i++) {
+				port_p->tx_data[port_p->tx_size++] = data[i];
+			}
+		}
+		else {
+			// A response always follows the complete request.
+			wire_capture_decode_tx(output, port_p, start);
+			for (i = 0; i < size; i++) {
+				wire_capture_decode_rx(output, port_p, start, timestamp, data[i]);
+			}
+		}
+	}
+
+	// Flush everything that is still pending.
+	for (i = 0; i < WIRE_CAPTURE_DECODE_PORTS; i++) {
+		if (ports[i].used) {
+			wire_capture_decode_tx(output, &ports[i], start);
+			if (ports[i].rx_size > 0) {
+				fprintf(output, "%12.3f ms  fd %-3d RX  INCOMPLETE     ",
+						(ports[i].rx_timestamp - start) / 1e6, ports[i].fd);
+				wire_capture_print_frame(output, ports[i].rx_data, ports[i].rx_size);
+			}
+		}
+	}
+
+	if (file != NULL) {
+		fclose(file);
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Store a chunk of traffic in the ring.
+ * @param	fd				File descriptor of the port.
+ * @param	direction		Direction of the traffic.
+ * @param	timestamp		Time of the traffic.
+ * @param	data			Data on the wire.
+ * @param	size			Amount of data.
+ * @param	flags			WIRE_CAPTURE_FLAG_* bits of the first slot.
+ * @return	None.
+ */
+static void wire_capture_store(int fd, wire_capture_direction direction, uint64_t timestamp, const unsigned char * data, size_t size, unsigned char flags)
+{
+	const unsigned char * bytes = data;
+
+	// Chunks larger than a slot are split over consecutive slots.
+	do {
+		uint64_t index = atomic_fetch_add_explicit(&wire_capture_head, 1, memory_order_relaxed);
+		wire_capture_slot_t * slot_p = &wire_capture_slots[index % WIRE_CAPTURE_SLOT_COUNT];
+		size_t chunk_size = (size > WIRE_CAPTURE_SLOT_DATA_SIZE) ? WIRE_CAPTURE_SLOT_DATA_SIZE : size;
+
+		// Mark the slot as being written.
+		atomic_store_explicit(&slot_p->sequence, 0, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+
+		slot_p->timestamp = timestamp;
+		slot_p->fd = fd;
+		slot_p->direction = (unsigned char) direction;
+		slot_p->flags = flags;
+		slot_p->size = (unsigned short) chunk_size;
+		memcpy(slot_p->data, bytes, chunk_size);
+
+		// Publish the slot.
+		atomic_store_explicit(&slot_p->sequence, index + 1, memory_order_release);
+
+		bytes += chunk_size;
+		size -= chunk_size;
+		flags = WIRE_CAPTURE_FLAG_CONTINUATION;
+	} while (size > 0);
+}
+
+/**
+ * @brief	Get the monotonic time.
+ * @return	Time in nanoseconds.
+ */
+static uint64_t wire_capture_get_time(void)
+{
+	struct timespec time;
+
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return (uint64_t) time.tv_sec * 1000000000ull + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * @brief	Write a little endian value.
+ * @param	file			File to write to.
+ * @param	value			Value to write.
+ * @param	size			Number of bytes to write.
+ * @return	None.
+ */
+static void wire_capture_put(FILE * file, uint64_t value, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		fputc((int) ((value >> (8 * i)) & 0xFF), file);
+	}
+}
+
+/**
+ * @brief	Read a little endian value.
+ * @param	file			File to read from.
+ * @param	value_p			Location to store the value.
+ * @param	size			Number of bytes to read.
+ * @return	0 on success, 1 on end of file.
+ */
+static int wire_capture_get(FILE * file, uint64_t * value_p, size_t size)
+{
+	int error = 0;
+	size_t i;
+	int byte;
+
+	*value_p = 0;
+	for (i = 0; (i < size) && !error; i++) {
+		byte = fgetc(file);
+		if (byte == EOF) {
+			error = 1;
+		}
+		else {
+			*value_p |= (uint64_t) byte << (8 * i);
+		}
+	}
+
+	return error;
+}
+
+/**
+ * @brief	Find or allocate the decoder state of a port.
+ * @param	ports			Decoder state table.
+ * @param	fd				File descriptor of the port.
+ * @return	Decoder state, or NULL when the table is full.
+ */
+static wire_capture_port_t * wire_capture_get_port(wire_capture_port_t * ports, int fd)
+{
+	wire_capture_port_t * port_p = NULL;
+	size_t i;
+
+	for (i = 0; (i < WIRE_CAPTURE_DECODE_PORTS) && (port_p == NULL); i++) {
+		if (ports[i].used && (ports[i].fd == fd)) {
+			port_p = &ports[i];
+		}
+	}
+
+	for (i = 0; (i < WIRE_CAPTURE_DECODE_PORTS) && (port_p == NULL); i++) {
+		if (!ports[i].used) {
+			port_p = &ports[i];
+			port_p->used = true;
+			port_p->fd = fd;
+		}
+	}
+
+	return port_p;
+}
+
+/**
+ * @brief	Render the pending write call of a port.
+ * @param	output			Stream to render to.
+ * @param	port_p			Decoder state of the port.
+ * @param	start			Timestamp of the first record.
+ * @return	None.
+ */
+static void wire_capture_decode_tx(FILE * output, wire_capture_port_t * port_p, uint64_t start)
+{
+	const unsigned char * data = port_p->tx_data;
+	size_t size = port_p->tx_size;
+
+	if (port_p->tx_pending) {
+		fprintf(output, "%12.3f ms  fd %-3d TX  ", (port_p->tx_timestamp - start) / 1e6, port_p->fd);
+
+		if ((size > 1) && (data[0] == 0x80) && !wire_capture_is_core_packet(data, size) &&
+			wire_capture_is_frame(&data[1], size - 1))
+		{
+			// A synchronization character merged with the frame, show them as they are handled.
+			fprintf(output, "SYNC           ");
+			wire_capture_print_frame(output, data, 1);
+			fprintf(output, "%12.3f ms  fd %-3d TX  ", (port_p->tx_timestamp - start) / 1e6, port_p->fd);
+			data++;
+			size--;
+		}
+
+		if ((size == 1) && (data[0] == 0x80)) {
+			// Only the ROM BSL synchronizes, so a probe for the core command BSL has been answered.
+			port_p->core = false;
+			fprintf(output, "SYNC           ");
+		}
+		else if (wire_capture_is_frame(data, size)) {
+			port_p->core = false;
+			fprintf(output, "%-15s addr=0x%04x len=%u %s ",
+					wire_capture_command_name(data[1]), data[4] + data[5] * 256, data[2],
+					wire_capture_checksum_valid(data, size) ? "checksum ok" : "BAD CHECKSUM");
+		}
+		else if (wire_capture_is_core_packet(data, size)) {
+			bool address;
+			const char * name = wire_capture_core_command_name(data[3], &address);
+
+			// Core packets carry a 24 bit address, if any.
+			port_p->core = true;
+			if (address && (size >= 3 + 4 + 2)) {
+				fprintf(output, "%-15s addr=0x%06lx len=%u %s ", name,
+						data[4] + data[5] * 256UL + data[6] * 65536UL, data[1] + data[2] * 256,
+						wire_capture_crc_valid(data, size) ? "checksum ok" : "BAD CHECKSUM");
+			}
+			else {
+				fprintf(output, "%-15s len=%u %s ", name, data[1] + data[2] * 256,
+						wire_capture_crc_valid(data, size) ? "checksum ok" : "BAD CHECKSUM");
+			}
+		}
+		else {
+			fprintf(output, "DATA           ");
+		}
+		wire_capture_print_frame(output, data, size);
+
+		port_p->tx_pending = false;
+		port_p->tx_size = 0;
+	}
+}
+
+/**
+ * @brief	Feed a received byte to the response parser of a port.
+ * @param	output			Stream to render to.
+ * @param	port_p			Decoder state of the port.
+ * @param	start			Timestamp of the first record.
+ * @param	timestamp		Timestamp of the byte.
+ * @param	data			The received byte.
+ * @return	None.
+ */
+static void wire_capture_decode_rx(FILE * output, wire_capture_port_t * port_p, uint64_t start, uint64_t timestamp, unsigned char data)
+{
+	if (port_p->rx_size == 0) {
+		port_p->rx_timestamp = timestamp;
+
+		if (port_p->core && (data != 0x80)) {
+			// The core BSL acknowledges every packet with a single byte, zero when it was accepted.
+			fprintf(output, "%12.3f ms  fd %-3d RX  %-15s", (timestamp - start) / 1e6, port_p->fd,
+					(data == 0x00) ? "ACK" : "NAK");
+			wire_capture_print_frame(output, &data, 1);
+			return;
+		}
+		if ((data == 0x90) || (data == 0xA0)) {
+			// Single byte responses.
+			fprintf(output, "%12.3f ms  fd %-3d RX  %-15s", (timestamp - start) / 1e6, port_p->fd,
+					(data == 0x90) ? "ACK" : "NAK");
+			wire_capture_print_frame(output, &data, 1);
+			return;
+		}
+		if (data != 0x80) {
+			fprintf(output, "%12.3f ms  fd %-3d RX  %-15s", (timestamp - start) / 1e6, port_p->fd, "UNEXPECTED");
+			wire_capture_print_frame(output, &data, 1);
+			return;
+		}
+		port_p->rx_expected = port_p->core ? 3 : 4;
+	}
+
+	port_p->rx_data[port_p->rx_size++] = data;
+
+	// The length field determines the size of the data response.
+	if (port_p->core && (port_p->rx_size == 3)) {
+		port_p->rx_expected = 3 + port_p->rx_data[1] + port_p->rx_data[2] * 256 + 2;
+		if (port_p->rx_expected > sizeof(port_p->rx_data)) {
+			port_p->rx_expected = sizeof(port_p->rx_data);
+		}
+	}
+	else if (!port_p->core && (port_p->rx_size == 4)) {
+		port_p->rx_expected = 4 + port_p->rx_data[2] + 2;
+	}
+
+	if (port_p->rx_size == port_p->rx_expected) {
+		if (port_p->core) {
+			fprintf(output, "%12.3f ms  fd %-3d RX  %-15slen=%u %s ",
+					(port_p->rx_timestamp - start) / 1e6, port_p->fd,
+					(port_p->rx_data[3] == 0x3B) ? "MESSAGE" : "DATA",
+					port_p->rx_data[1] + port_p->rx_data[2] * 256,
+					wire_capture_crc_valid(port_p->rx_data, port_p->rx_size) ? "checksum ok" : "BAD CHECKSUM");
+		}
+		else {
+			fprintf(output, "%12.3f ms  fd %-3d RX  DATA           len=%u %s ",
+					(port_p->rx_timestamp - start) / 1e6, port_p->fd, port_p->rx_data[2],
+					wire_capture_checksum_valid(port_p->rx_data, port_p->rx_size) ? "checksum ok" : "BAD CHECKSUM");
+		}
+		wire_capture_print_frame(output, port_p->rx_data, port_p->rx_size);
+		port_p->rx_size = 0;
+	}
+}
+
+/**
+ * @brief	Print the raw bytes of a frame.
+ * @param	output			Stream to print to.
+ * @param	data			Frame data.
+ * @param	size			Size of the frame.
+ * @return	None.
+ */
+static void wire_capture_print_frame(FILE * output, const unsigned char * data, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		fprintf(output, "%02x ", data[i]);
+	}
+	fprintf(output, "\n");
+}
+
+/**
+ * @brief	Check whether data is a complete 1xx/2xx/4xx BSL frame.
+ * @param	data			Frame data.
+ * @param	size			Size of the data.
+ * @return	TRUE when the header and both length fields match the size.
+ */
+static bool wire_capture_is_frame(const unsigned char * data, size_t size)
+{
+	return (size >= 8) && (data[0] == 0x80) && (data[2] == data[3]) && (size == 4 + (size_t) data[2] + 2);
+}
+
+/**
+ * @brief	Check whether data is a complete 5xx/6xx/FRxx core command packet.
+ * @param	data			Packet data.
+ * @param	size			Size of the data.
+ * @return	TRUE when the header and the length field match the size.
+ */
+static bool wire_capture_is_core_packet(const unsigned char * data, size_t size)
+{
+	return (size >= 6) && (data[0] == 0x80) && (size == 3 + data[1] + data[2] * 256U + 2);
+}
+
+/**
+ * @brief	Get the name of a BSL command.
+ * @param	command			Command byte.
+ * @return	Name of the command.
+ */
+static const char * wire_capture_command_name(unsigned char command)
+{
+	const char * name;
+
+	switch (command)
+	{
+	case 0x10:
+		name = "RX_PASSWORD";
+		break;
+	case 0x12:
+		name = "RX_DATA_BLOCK";
+		break;
+	case 0x14:
+		name = "TX_DATA_BLOCK";
+		break;
+	case 0x16:
+		name = "ERASE_SEGMENT";
+		break;
+	case 0x18:
+		name = "MASS_ERASE";
+		break;
+	case 0x1A:
+		name = "LOAD_PC";
+		break;
+	case 0x1C:
+		name = "ERASE_CHECK";
+		break;
+	case 0x20:
+		name = "CHANGE_BAUDRATE";
+		break;
+	case 0x21:
+		name = "SET_MEM_OFFSET";
+		break;
+	default:
+		name = "UNKNOWN_COMMAND";
+		break;
+	}
+
+	return name;
+}
+
+/**
+ * @brief	Get the name of a core BSL command.
+ * @param	command			Command byte.
+ * @param	address_p		Location to store whether the command has an address argument.
+ * @return	Name of the command.
+ */
+static const char * wire_capture_core_command_name(unsigned char command, bool * address_p)
+{
+	const char * name;
+
+	*address_p = true;
+
+	switch (command)
+	{
+	case 0x10:
+		name = "RX_DATA_BLOCK";
+		break;
+	case 0x11:
+		name = "RX_PASSWORD";
+		*address_p = false;
+		break;
+	case 0x12:
+		name = "ERASE_SEGMENT";
+		break;
+	case 0x13:
+		name = "TOGGLE_INFO";
+		*address_p = false;
+		break;
+	case 0x15:
+		name = "MASS_ERASE";
+		*address_p = false;
+		break;
+	case 0x16:
+		name = "CRC_CHECK";
+		break;
+	case 0x17:
+		name = "LOAD_PC";
+		break;
+	case 0x18:
+		name = "TX_DATA_BLOCK";
+		break;
+	case 0x19:
+		name = "TX_BSL_VERSION";
+		*address_p = false;
+		break;
+	case 0x1B:
+		name = "RX_DATA_FAST";
+		break;
+	case 0x52:
+		name = "CHANGE_BAUDRATE";
+		*address_p = false;
+		break;
+	default:
+		name = "UNKNOWN_COMMAND";
+		*address_p = false;
+		break;
+	}
+
+	return name;
+}
+
+/**
+ * @brief	Validate the checksum of a BSL frame.
+ * @param	data			Frame data, including the checksum.
+ * @param	size			Size of the frame.
+ * @return	TRUE when the checksum is valid.
+ */
+static bool wire_capture_checksum_valid(const unsigned char * data, size_t size)
+{
+	unsigned short checksum;
+
+	if ((size < 4) || (size % 2)) {
+		return false;
+	}
+
+	checksum = ~checksum_xor16(0, data, size - 2);
+
+	return ((checksum % 256) == data[size - 2]) && ((checksum / 256) == data[size - 1]);
+}
+
+/**
+ * @brief	Validate the CRC of a core BSL packet.
+ * @param	data			Packet data, including the CRC.
+ * @param	size			Size of the packet.
+ * @return	TRUE when the CRC is valid.
+ */
+static bool wire_capture_crc_valid(const unsigned char * data, size_t size)
+{
+	unsigned short checksum;
+
+	if (size < 3 + 1 + 2) {
+		return false;
+	}
+
+	// The CRC covers the core command, not the wrapper.
+	checksum = checksum_crc16(0xFFFF, &data[3], size - 3 - 2);
+
+	return ((checksum % 256) == data[size - 2]) && ((checksum / 256) == data[size - 1]);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,76 @@
+/**
+ * @file	wire_capture.h
+ *
+ * @date	17 oct. 2026
+ * @author	enjschreuder
+ * @brief	Header file for the serial wire capture library.
+ */
+
+#ifndef WIRE_CAPTURE_H_
+#define WIRE_CAPTURE_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/uio.h>
+
+/**
+ * @addtogroup wire_capture
+ * @{
+ */
+
+/**
+ * @brief Direction of a captured chunk.
+ */
+typedef enum
+{
+	wire_capture_tx,	/**< Data written to the port.	*/
+	wire_capture_rx		/**< Data read from the port.	*/
+} wire_capture_direction;
+
+/**
+ * @brief Runtime capture switch, use wire_capture_enable() to change it.
+ */
+extern atomic_bool wire_capture_enabled;
+
+void wire_capture_enable(bool enabled);
+void wire_capture_clear(void);
+void wire_capture_record(int fd, wire_capture_direction direction, const void * data, size_t size);
+void wire_capture_record_vectors(int fd, wire_capture_direction direction, const struct iovec * vectors, int count, size_t size);
+int wire_capture_dump(const char * filename);
+int wire_capture_decode(const char * filename, FILE * output);
+
+/**
+ * @brief	Record a chunk of wire traffic.
+ *
+ * Compiles to nothing when WIRE_CAPTURE_DISABLED is defined, and costs a single
+ * relaxed load when capturing is disabled at runtime.
+ */
+#ifdef WIRE_CAPTURE_DISABLED
+#define WIRE_CAPTURE(fd, direction, data, size)	((void) 0)
+#define WIRE_CAPTURE_VECTORS(fd, direction, vectors, count, size)	((void) 0)
+#else
+#define WIRE_CAPTURE(fd, direction, data, size)											\
+	do {																				\
+		if (atomic_load_explicit(&wire_capture_enabled, memory_order_relaxed)) {		\
+			wire_capture_record((fd), (direction), (data), (size));						\
+		}																				\
+	} while (0)
+
+/**
+ * @brief	Record scattered data that went out in a single system call, such as a writev().
+ */
+#define WIRE_CAPTURE_VECTORS(fd, direction, vectors, count, size)								\
+	do {																						\
+		if (atomic_load_explicit(&wire_capture_enabled, memory_order_relaxed)) {				\
+			wire_capture_record_vectors((fd), (direction), (vectors), (count), (size));		\
+		}																						\
+	} while (0)
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* WIRE_CAPTURE_H_ */